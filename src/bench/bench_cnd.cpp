@@ -0,0 +1,185 @@
+#include <algorithm>
+#include <benchmark/benchmark.h>
+#include <string>
+#include <vector>
+
+#include "fixtures.h"
+#include "libim/cnd.h"
+#include "libim/io/filestream.h"
+#include "libim/io/mappedfilestream.h"
+#include "libim/probe.h"
+
+using namespace libim;
+
+namespace {
+    constexpr uint32_t kMatDim = 64;
+
+    int64_t CndPixelDataSize(const std::vector<Material>& materials)
+    {
+        int64_t size = 0;
+        for(const auto& mat : materials)
+        {
+            for(const auto& mipmap : mat.mipmaps())
+            {
+                for(const auto& tex : mipmap) {
+                    size += int64_t(tex.bitmap()->size());
+                }
+            }
+        }
+        return size;
+    }
+
+    /* Loads and decodes all materials of CND file with range(0) * scale materials */
+    void BM_CndLoadMaterials(benchmark::State& state)
+    {
+        const std::size_t nMaterials = std::size_t(state.range(0)) * bench::GetScale();
+        MappedFileStream ifs(bench::GetCndFixture(nMaterials, kMatDim));
+
+        int64_t nBytes = 0;
+        for(auto _ : state)
+        {
+            ifs.seekBegin();
+            auto materials = CND::LoadMaterials(ifs);
+            if(materials.size() != nMaterials)
+            {
+                state.SkipWithError("CND::LoadMaterials failed");
+                break;
+            }
+            nBytes += CndPixelDataSize(materials);
+        }
+        state.SetBytesProcessed(nBytes);
+        state.SetItemsProcessed(int64_t(state.iterations()) * int64_t(nMaterials));
+    }
+    BENCHMARK(BM_CndLoadMaterials)->Arg(50)->Arg(200)->Unit(benchmark::kMillisecond);
+
+    /* Finds kMatDim x kMatDim ARGB_4444 materials of CND file with range(0) * scale materials sorted by name.
+       Metadata is read either by decoding all materials (range(1) = 0) or into CndMaterialTable (range(1) = 1). */
+    void BM_CndQueryMaterials(benchmark::State& state)
+    {
+        const std::size_t nMaterials = std::size_t(state.range(0)) * bench::GetScale();
+        const bool bTable = state.range(1) != 0;
+        MappedFileStream ifs(bench::GetCndFixture(nMaterials, kMatDim));
+
+        for(auto _ : state)
+        {
+            std::size_t nFound = 0;
+            if(bTable)
+            {
+                CND::CndMaterialTable table(ifs);
+                auto rows = table.filter(kMatDim, kMatDim, ARGB_4444);
+                table.sort(rows, CND::CndMaterialTable::Column::Name);
+                nFound = rows.size();
+            }
+            else
+            {
+                ifs.seekBegin();
+                auto materials = CND::LoadMaterials(ifs);
+                std::vector<const Material*> found;
+                for(const auto& mat : materials)
+                {
+                    if(mat.width() == kMatDim && mat.height() == kMatDim && mat.colorFormat() == ARGB_4444) {
+                        found.push_back(&mat);
+                    }
+                }
+                std::stable_sort(found.begin(), found.end(), [](const Material* lhs, const Material* rhs) {
+                    return lhs->name() < rhs->name();
+                });
+                nFound = found.size();
+            }
+
+            if(nFound == 0)
+            {
+                state.SkipWithError("No material found");
+                break;
+            }
+            benchmark::DoNotOptimize(nFound);
+        }
+        state.SetItemsProcessed(int64_t(state.iterations()) * int64_t(nMaterials));
+    }
+    BENCHMARK(BM_CndQueryMaterials)->Args({200, 0})->Args({200, 1})->Unit(benchmark::kMicrosecond);
+
+    /* Identifies and validates CND file either by opening it and reading CND header (range(0) = 0) or with ProbeFile (range(0) = 1) */
+    void BM_CndProbeFile(benchmark::State& state)
+    {
+        const auto path = bench::GetCndFixture(50, kMatDim);
+        const bool bProbe = state.range(0) != 0;
+        for(auto _ : state)
+        {
+            if(bProbe)
+            {
+                const auto probe = ProbeFile(path);
+                if(probe.type != FileType::Cnd || !probe.valid())
+                {
+                    state.SkipWithError("ProbeFile failed");
+                    break;
+                }
+                benchmark::DoNotOptimize(probe.cnd.numMaterials);
+            }
+            else
+            {
+                InputFileStream ifs(path);
+                const auto header = CND::LoadHeader(ifs);
+                benchmark::DoNotOptimize(header.numMaterials);
+            }
+        }
+        state.SetItemsProcessed(int64_t(state.iterations()));
+    }
+    BENCHMARK(BM_CndProbeFile)->Arg(0)->Arg(1)->Unit(benchmark::kMicrosecond);
+
+    /* Hashes content of 200 * scale materials on range(0) threads (0 = all hardware threads) */
+    void BM_CndHashMaterials(benchmark::State& state)
+    {
+        const std::size_t nMaterials = 200 * bench::GetScale();
+        const std::size_t nThreads = std::size_t(state.range(0));
+        CND::CndMaterialIndex index(MakeStreamPtr<InputFileStream>(bench::GetCndFixture(nMaterials, kMatDim)));
+        for(auto _ : state)
+        {
+            auto hashes = CND::HashMaterials(index, nThreads);
+            benchmark::DoNotOptimize(hashes.data());
+        }
+        state.SetBytesProcessed(int64_t(state.iterations()) * int64_t(index.pixelDataSize()));
+    }
+    BENCHMARK(BM_CndHashMaterials)->Arg(1)->Arg(0)->Unit(benchmark::kMicrosecond)->UseRealTime();
+
+    /* Replaces range(1) materials in CND file with range(0) * scale materials with async I/O queue depth range(2),
+       in place if range(3) is 1. Materials are replaced with materials of the same size so the file can be patched repeatedly. */
+    void BM_CndReplaceMaterials(benchmark::State& state)
+    {
+        const std::size_t nMaterials = std::size_t(state.range(0)) * bench::GetScale();
+        const std::size_t nReplace   = std::min<std::size_t>(nMaterials, std::size_t(state.range(1)));
+        const std::size_t nAsyncDepth = std::size_t(state.range(2));
+        const auto mode = state.range(3) ? CND::CndPatchMode::InPlace : CND::CndPatchMode::Rewrite;
+
+        const auto fixture = bench::GetCndFixture(nMaterials, kMatDim);
+        const auto path = bench::GetFixturePath("cnd_replace.cnd");
+        bench::CopyFixture(fixture, path);
+
+        std::vector<Material> mats;
+        for(std::size_t i = 0; i < nReplace; i++)
+        {
+            const std::size_t idx = i * nMaterials / nReplace;
+            const uint32_t dim    = kMatDim >> (idx % 2);
+            const auto& format    = (idx % 3 == 0) ? RGB_565 : ARGB_4444;
+            mats.push_back(bench::MakeMaterial(bench::GetCndFixtureMaterialName(idx), dim, format));
+        }
+
+        for(auto _ : state)
+        {
+            const bool bReplaced = nReplace == 1 && nAsyncDepth == 0 ? CND::ReplaceMaterial(mats.front(), path, mode)
+                                                                     : CND::ReplaceMaterials(mats, path, nAsyncDepth, mode);
+            if(!bReplaced)
+            {
+                state.SkipWithError("CND::ReplaceMaterials failed");
+                break;
+            }
+        }
+        state.SetItemsProcessed(int64_t(state.iterations()) * int64_t(nReplace));
+    }
+    BENCHMARK(BM_CndReplaceMaterials)
+        ->Args({200, 1, 0, 0})
+        ->Args({200, 20, 0, 0})
+        ->Args({200, 20, 32, 0})
+        ->Args({200, 1, 0, 1})
+        ->Args({200, 20, 0, 1})
+        ->Unit(benchmark::kMillisecond);
+}
@@ -0,0 +1,233 @@
+#include <benchmark/benchmark.h>
+#include <random>
+#include <string>
+
+#include "fixtures.h"
+#include "libim/gob.h"
+#include "libim/io/asyncio.h"
+#include "libim/io/compressedstream.h"
+#include "libim/vfs.h"
+
+namespace {
+    constexpr std::size_t kEntrySize = 16 * 1024;
+
+    /* Parses GOB header and directory of range(0) * scale entries */
+    void BM_LoadGobFromFile(benchmark::State& state)
+    {
+        const std::size_t nEntries = std::size_t(state.range(0)) * bench::GetScale();
+        const auto path = bench::GetGobFixture(nEntries, 64);
+        for(auto _ : state)
+        {
+            auto dir = LoadGobFromFile(path);
+            if(!dir) {
+                state.SkipWithError("LoadGobFromFile failed");
+                break;
+            }
+            benchmark::DoNotOptimize(dir->entries.data());
+        }
+        state.SetItemsProcessed(int64_t(state.iterations()) * int64_t(nEntries));
+    }
+    BENCHMARK(BM_LoadGobFromFile)->Arg(1000)->Arg(10000)->Unit(benchmark::kMicrosecond);
+
+    /* Parses GOB directory and builds GobArchive lookup index */
+    void BM_GobArchiveOpen(benchmark::State& state)
+    {
+        const std::size_t nEntries = std::size_t(state.range(0)) * bench::GetScale();
+        const auto path = bench::GetGobFixture(nEntries, 64);
+        for(auto _ : state)
+        {
+            GobArchive gob(path);
+            benchmark::DoNotOptimize(gob.entries().data());
+        }
+        state.SetItemsProcessed(int64_t(state.iterations()) * int64_t(nEntries));
+    }
+    BENCHMARK(BM_GobArchiveOpen)->Arg(1000)->Arg(10000)->Unit(benchmark::kMicrosecond);
+
+    /* Extracts all entries of GOB file to the fixture directory, files are not synced on close */
+    void BM_GobExtract(benchmark::State& state)
+    {
+        const std::size_t nEntries = std::size_t(state.range(0)) * bench::GetScale();
+        GobArchive gob(bench::GetGobFixture(nEntries, kEntrySize));
+
+        const auto outDir = bench::GetFixturePath("gob_extract");
+        if(!DirExists(outDir) && !MakePath(outDir))
+        {
+            state.SkipWithError("Failed to create output directory");
+            return;
+        }
+
+        std::size_t nBytes = 0;
+        for(auto _ : state)
+        {
+            std::size_t idx = 0;
+            for(const auto& entry : gob.entries())
+            {
+                OutputFileStream ofs(outDir + "/" + std::to_string(idx++) + ".bin");
+                ofs.setSyncOnClose(false);
+                ofs.write(gob.entryData(entry), entry.size);
+                nBytes += entry.size;
+            }
+        }
+        state.SetBytesProcessed(int64_t(nBytes));
+        state.SetItemsProcessed(int64_t(state.iterations()) * int64_t(nEntries));
+    }
+    BENCHMARK(BM_GobExtract)->Arg(256)->Unit(benchmark::kMillisecond);
+
+    /* Same as BM_GobExtract but entries are copied with AsyncCopyPipeline with queue depth range(1) */
+    void BM_GobExtractAsync(benchmark::State& state)
+    {
+        const std::size_t nEntries = std::size_t(state.range(0)) * bench::GetScale();
+        const auto gobPath = bench::GetGobFixture(nEntries, kEntrySize);
+        GobArchive gob(gobPath);
+
+        const auto outDir = bench::GetFixturePath("gob_extract_async");
+        if(!DirExists(outDir) && !MakePath(outDir))
+        {
+            state.SkipWithError("Failed to create output directory");
+            return;
+        }
+
+        AsyncIO aio(std::size_t(state.range(1)));
+        AsyncFile src(gobPath, FileStream::Read);
+        state.SetLabel(AsyncIO::GetBackendName(aio.backend()));
+
+        std::size_t nBytes = 0;
+        for(auto _ : state)
+        {
+            AsyncCopyPipeline pipeline(aio);
+            std::size_t idx = 0;
+            for(const auto& entry : gob.entries())
+            {
+                auto dst = std::make_shared<AsyncFile>(outDir + "/" + std::to_string(idx++) + ".bin", FileStream::Write);
+                dst->setSyncOnClose(false);
+                pipeline.copy(src, entry.offset, *dst, 0, entry.size, [dst]() mutable { dst.reset(); });
+                nBytes += entry.size;
+            }
+            pipeline.finish();
+        }
+        state.SetBytesProcessed(int64_t(nBytes));
+        state.SetItemsProcessed(int64_t(state.iterations()) * int64_t(nEntries));
+    }
+    BENCHMARK(BM_GobExtractAsync)->Args({256, 32})->Unit(benchmark::kMillisecond);
+
+    /* Replaces one entry of GOB file with range(0) * scale entries and commits the directory without sync.
+       Each iteration appends entry data and a new directory to the archive. */
+    void BM_GobWriterReplace(benchmark::State& state)
+    {
+        const std::size_t nEntries = std::size_t(state.range(0)) * bench::GetScale();
+        const auto path = bench::GetFixturePath("gob_writer.gob");
+        bench::CopyFixture(bench::GetGobFixture(nEntries, kEntrySize), path);
+
+        ByteArray data(kEntrySize);
+        bench::FillRandom(data.data(), data.size(), 19);
+
+        GobWriter gob(path);
+        const std::string name = GetGobEntryName(gob.entries().at(nEntries / 2));
+        for(auto _ : state)
+        {
+            gob.addEntry(name, data.data(), data.size());
+            gob.commit(false);
+        }
+        state.SetItemsProcessed(int64_t(state.iterations()));
+    }
+    BENCHMARK(BM_GobWriterReplace)->Arg(10000)->Iterations(20)->Unit(benchmark::kMicrosecond); // bounded, archive grows every iteration
+
+    /* Looks up every entry name in VFS with range(1) GOB mounts of range(0) * scale entries each */
+    void BM_VfsLookup(benchmark::State& state)
+    {
+        const std::size_t nEntries = std::size_t(state.range(0)) * bench::GetScale();
+        auto gob = std::make_shared<GobArchive>(bench::GetGobFixture(nEntries, 64));
+
+        VirtualFileSystem vfs;
+        for(int64_t i = 0; i < state.range(1); i++) {
+            vfs.mount(gob, "mount" + std::to_string(i), int(i));
+        }
+
+        std::vector<std::string> names;
+        for(const auto& entry : gob->entries()) {
+            names.push_back(GetGobEntryName(entry));
+        }
+
+        for(auto _ : state)
+        {
+            for(const auto& name : names) {
+                benchmark::DoNotOptimize(vfs.exists(name));
+            }
+        }
+        state.SetItemsProcessed(int64_t(state.iterations()) * int64_t(names.size()));
+    }
+    BENCHMARK(BM_VfsLookup)->Args({10000, 4})->Unit(benchmark::kMicrosecond);
+
+    /* Reads range(1) bytes at random offsets of compressible GOB file packed with codec range(0) */
+    void BM_CompressedStreamRead(benchmark::State& state)
+    {
+        const auto codec = CompressionCodec(state.range(0));
+        if(!IsCodecSupported(codec))
+        {
+            state.SkipWithError("Codec is not supported by this build");
+            return;
+        }
+
+        /* Entries are runs of repeated random bytes, so chunks compress */
+        const auto path = bench::GetFixturePath(std::string("gob_packed.") + GetCodecName(codec));
+        if(!FileExists(path))
+        {
+            const auto gobPath = bench::GetGobFixture(256 * bench::GetScale(), kEntrySize);
+            auto istream = OpenInputStream(gobPath);
+            ByteArray data(istream->size());
+            istream->read(data.data(), data.size());
+            for(std::size_t i = 0; i < data.size(); i++) {
+                data[i] = data[i - i % 16];
+            }
+
+            const auto rawPath = path + ".raw";
+            {
+                RemoveFile(rawPath);
+                OutputFileStream ofs(rawPath);
+                ofs.setSyncOnClose(false);
+                ofs.write(data.data(), data.size());
+            }
+
+            MappedFileStream raw(rawPath);
+            OutputFileStream ofs(path);
+            ofs.setSyncOnClose(false);
+            CompressStream(raw, 0, raw.size(), ofs, codec);
+        }
+
+        CompressedStream cs(MakeStreamPtr<MappedFileStream>(path));
+        const std::size_t nRead = std::size_t(state.range(1));
+        ByteArray buffer(nRead);
+        std::mt19937 rng(23);
+        for(auto _ : state)
+        {
+            cs.seek(rng() % (cs.size() - nRead));
+            benchmark::DoNotOptimize(cs.read(buffer.data(), nRead));
+        }
+        state.SetBytesProcessed(int64_t(state.iterations()) * int64_t(nRead));
+        state.counters["ratio"] = double(cs.compressedSize()) / double(cs.size());
+    }
+    BENCHMARK(BM_CompressedStreamRead)
+        ->Args({int64_t(CompressionCodec::Store), 4096})
+        ->Args({int64_t(CompressionCodec::Zlib),  4096})
+        ->Args({int64_t(CompressionCodec::Zstd),  4096})
+        ->Args({int64_t(CompressionCodec::Lz4),   4096})
+        ->Unit(benchmark::kMicrosecond);
+
+    /* Reads entries of GOB file at random with readAt of one FileStream shared by all benchmark threads */
+    void BM_FileStreamReadAt(benchmark::State& state)
+    {
+        static const auto path = bench::GetGobFixture(256 * bench::GetScale(), kEntrySize);
+        static const InputFileStream ifs(path);
+        static const GobArchive gob(path);
+
+        ByteArray buffer(kEntrySize);
+        std::mt19937 rng(uint32_t(state.thread_index()));
+        for(auto _ : state)
+        {
+            const auto& entry = gob.entries()[rng() % gob.entries().size()];
+            benchmark::DoNotOptimize(ifs.readAt(entry.offset, buffer.data(), entry.size));
+        }
+        state.SetBytesProcessed(int64_t(state.iterations()) * int64_t(kEntrySize));
+    }
+    BENCHMARK(BM_FileStreamReadAt)->Threads(1)->Threads(4)->UseRealTime()->Unit(benchmark::kMicrosecond);
+}
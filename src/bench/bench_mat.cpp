@@ -0,0 +1,183 @@
+#include <benchmark/benchmark.h>
+#include <string>
+#include <vector>
+
+#include "fixtures.h"
+#include "libim/material/bmp.h"
+#include "libim/material/bmpreader.h"
+#include "libim/material/mat.h"
+#include "libim/material/mipmapgen.h"
+#include "libim/material/pixelconv.h"
+
+namespace {
+    int64_t MaterialPixelDataSize(const Material& mat)
+    {
+        int64_t size = 0;
+        for(const auto& mipmap : mat.mipmaps())
+        {
+            for(const auto& tex : mipmap) {
+                size += int64_t(tex.bitmap()->size());
+            }
+        }
+        return size;
+    }
+
+    std::string GetMatFixture(const Material& mat)
+    {
+        const auto path = bench::GetFixturePath(mat.name());
+        if(!FileExists(path) && !SaveMaterialToFile(path, mat)) {
+            throw std::runtime_error("Failed to write MAT fixture: " + path);
+        }
+        return path;
+    }
+
+    std::string MatName(uint32_t dim)
+    {
+        return "mat_" + std::to_string(dim) + ".mat";
+    }
+
+    uint32_t ScaledDim(const benchmark::State& state)
+    {
+        return uint32_t(state.range(0)) * uint32_t(bench::GetScale());
+    }
+
+    void BM_LoadMaterialFromFile(benchmark::State& state)
+    {
+        const uint32_t dim = ScaledDim(state);
+        const auto mat  = bench::MakeMaterial(MatName(dim), dim, RGB_565);
+        const auto path = GetMatFixture(mat);
+        for(auto _ : state)
+        {
+            auto loaded = LoadMaterialFromFile(path);
+            if(!loaded)
+            {
+                state.SkipWithError("LoadMaterialFromFile failed");
+                break;
+            }
+            benchmark::DoNotOptimize(loaded.get());
+        }
+        state.SetBytesProcessed(int64_t(state.iterations()) * MaterialPixelDataSize(mat));
+    }
+    BENCHMARK(BM_LoadMaterialFromFile)->Arg(64)->Arg(512)->Unit(benchmark::kMicrosecond);
+
+    void BM_SaveMaterialToFile(benchmark::State& state)
+    {
+        const uint32_t dim = ScaledDim(state);
+        const auto mat  = bench::MakeMaterial(MatName(dim), dim, RGB_565);
+        const auto path = bench::GetFixturePath("save_" + mat.name());
+        for(auto _ : state)
+        {
+            if(!SaveMaterialToFile(path, mat))
+            {
+                state.SkipWithError("SaveMaterialToFile failed");
+                break;
+            }
+        }
+        state.SetBytesProcessed(int64_t(state.iterations()) * MaterialPixelDataSize(mat));
+    }
+    BENCHMARK(BM_SaveMaterialToFile)->Arg(64)->Arg(512)->Unit(benchmark::kMicrosecond);
+
+    /* Converts texture to BMP in its own format (range(1) == 0) or to 32 bit BGRA_8888 (range(1) == 1) */
+    void BM_TextureToBmp(benchmark::State& state)
+    {
+        const uint32_t dim = ScaledDim(state);
+        const bool bmp32 = state.range(1) != 0;
+        const auto mat = bench::MakeMaterial(MatName(dim), dim, RGB_565, 1, 1);
+        const auto& tex = mat.mipmaps().at(0).at(0);
+        for(auto _ : state)
+        {
+            auto bmp = bmp32 ? tex.toBmp(BGRA_8888) : tex.toBmp();
+            benchmark::DoNotOptimize(bmp.pixelData->data());
+        }
+        state.SetBytesProcessed(int64_t(state.iterations()) * int64_t(tex.bitmap()->size()));
+    }
+    BENCHMARK(BM_TextureToBmp)->Args({512, 0})->Args({512, 1})->Unit(benchmark::kMicrosecond);
+
+    void BM_SaveBmpToFile(benchmark::State& state)
+    {
+        const uint32_t dim = ScaledDim(state);
+        const auto mat = bench::MakeMaterial(MatName(dim), dim, RGB_565, 1, 1);
+        const auto bmp = mat.mipmaps().at(0).at(0).toBmp();
+        const auto path = bench::GetFixturePath("save_" + std::to_string(dim) + ".bmp");
+        for(auto _ : state)
+        {
+            if(!SaveBmpToFile(path, bmp))
+            {
+                state.SkipWithError("SaveBmpToFile failed");
+                break;
+            }
+        }
+        state.SetBytesProcessed(int64_t(state.iterations()) * int64_t(bmp.pixelData->size()));
+    }
+    BENCHMARK(BM_SaveBmpToFile)->Arg(512)->Unit(benchmark::kMicrosecond);
+
+    /* Imports RGB_565 material from BMP in the same format (range(1) == 0) or from 32 bit BGRA_8888 BMP (range(1) == 1) */
+    void BM_LoadMaterialFromBmpFile(benchmark::State& state)
+    {
+        const uint32_t dim = ScaledDim(state);
+        const bool bmp32 = state.range(1) != 0;
+        const auto mat = bench::MakeMaterial(MatName(dim), dim, RGB_565, 1, 1);
+        const auto& tex = mat.mipmaps().at(0).at(0);
+        const auto path = bench::GetFixturePath("import_" + std::to_string(dim) + (bmp32 ? "_32" : "") + ".bmp");
+        if(!FileExists(path) && !SaveBmpToFile(path, bmp32 ? tex.toBmp(BGRA_8888) : tex.toBmp()))
+        {
+            state.SkipWithError("Failed to write BMP fixture");
+            return;
+        }
+
+        for(auto _ : state)
+        {
+            auto loaded = LoadMaterialFromBmpFile(path, RGB_565);
+            if(!loaded)
+            {
+                state.SkipWithError("LoadMaterialFromBmpFile failed");
+                break;
+            }
+            benchmark::DoNotOptimize(loaded.get());
+        }
+        state.SetBytesProcessed(int64_t(state.iterations()) * int64_t(tex.bitmap()->size()));
+    }
+    BENCHMARK(BM_LoadMaterialFromBmpFile)->Args({512, 0})->Args({512, 1})->Unit(benchmark::kMicrosecond);
+
+    /* Converts RGB_565 pixels to BGRA_8888 with ISA range(1), see PixelConvIsa */
+    void BM_ConvertPixels(benchmark::State& state)
+    {
+        const std::size_t nPixels = std::size_t(state.range(0)) * bench::GetScale();
+        const auto isa = static_cast<PixelConvIsa>(state.range(1));
+        if(isa != PixelConvIsa::Scalar && isa != GetPixelConvIsa())
+        {
+            state.SkipWithError("ISA not supported");
+            return;
+        }
+
+        std::vector<byte_t> src(nPixels * 2);
+        std::vector<byte_t> dst(nPixels * 4);
+        bench::FillRandom(src.data(), src.size(), 0);
+
+        state.SetLabel(GetPixelConvIsaName(isa));
+        for(auto _ : state)
+        {
+            ConvertPixels(src.data(), RGB_565, dst.data(), BGRA_8888, nPixels, isa);
+            benchmark::DoNotOptimize(dst.data());
+        }
+        state.SetBytesProcessed(int64_t(state.iterations()) * int64_t(src.size()));
+    }
+    BENCHMARK(BM_ConvertPixels)
+        ->Args({1 << 20, int(PixelConvIsa::Scalar)})
+        ->Args({1 << 20, int(GetPixelConvIsa())})
+        ->Unit(benchmark::kMicrosecond);
+
+    void BM_MakeMipmap(benchmark::State& state)
+    {
+        const uint32_t dim = ScaledDim(state);
+        const auto mat = bench::MakeMaterial(MatName(dim), dim, RGB_565, 1, 1);
+        const auto& tex = mat.mipmaps().at(0).at(0);
+        for(auto _ : state)
+        {
+            auto mipmap = MakeMipmap(tex, 4);
+            benchmark::DoNotOptimize(mipmap.data());
+        }
+        state.SetBytesProcessed(int64_t(state.iterations()) * int64_t(tex.bitmap()->size()));
+    }
+    BENCHMARK(BM_MakeMipmap)->Arg(512)->Unit(benchmark::kMicrosecond);
+}
@@ -0,0 +1,203 @@
+#include "fixtures.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <random>
+#include <stdexcept>
+#include <vector>
+
+#include "libim/cnd.h"
+#include "libim/common.h"
+#include "libim/gob.h"
+#include "libim/io/filestream.h"
+
+using namespace libim::CND;
+
+namespace {
+    std::string g_fixtureDir = "libim_bench_fixtures";
+    std::size_t g_scale = 1;
+}
+
+void bench::SetFixtureDir(std::string dir)
+{
+    g_fixtureDir = std::move(dir);
+}
+
+const std::string& bench::GetFixtureDir()
+{
+    return g_fixtureDir;
+}
+
+void bench::SetScale(std::size_t scale)
+{
+    g_scale = std::max<std::size_t>(scale, 1);
+}
+
+std::size_t bench::GetScale()
+{
+    return g_scale;
+}
+
+std::string bench::GetFixturePath(const std::string& name)
+{
+    if(!DirExists(g_fixtureDir) && !MakePath(g_fixtureDir)) {
+        throw std::runtime_error("Failed to create fixture directory: " + g_fixtureDir);
+    }
+    return g_fixtureDir + "/" + name;
+}
+
+void bench::CopyFixture(const std::string& from, const std::string& to)
+{
+    InputFileStream ifs(from);
+    OutputFileStream ofs(to);
+    ofs.setSyncOnClose(false);
+
+    ByteArray buffer;
+    ofs.write(ifs, 0, ifs.size(), buffer);
+}
+
+void bench::FillRandom(byte_t* data, std::size_t size, uint32_t seed)
+{
+    std::mt19937 rng(seed);
+    std::size_t i = 0;
+    for(; i + 4 <= size; i += 4)
+    {
+        const uint32_t v = rng();
+        std::copy(reinterpret_cast<const byte_t*>(&v), reinterpret_cast<const byte_t*>(&v) + 4, data + i);
+    }
+
+    for(; i < size; i++) {
+        data[i] = static_cast<byte_t>(rng());
+    }
+}
+
+std::string bench::GetGobFixture(std::size_t numEntries, std::size_t entrySize)
+{
+    const auto path = GetFixturePath("gob_" + std::to_string(numEntries) + "x" + std::to_string(entrySize) + ".gob");
+    if(FileExists(path)) {
+        return path;
+    }
+
+    const char* dirs[] = { "mat", "3do", "cog", "key", "ndy" };
+    {
+        OutputFileStream ofs(path + ".tmp");
+        ofs.setSyncOnClose(false);
+
+        GobFileHeader header {};
+        header.signature = GOB_FILE_SIGNATURE;
+        header.version   = GOB_FILE_VERSION;
+        ofs.write(reinterpret_cast<const byte_t*>(&header), sizeof(header));
+
+        std::vector<GobFileEntry> entries(numEntries);
+        ByteArray data(entrySize);
+        for(std::size_t i = 0; i < numEntries; i++)
+        {
+            auto& entry  = entries[i];
+            entry.offset = static_cast<uint32_t>(ofs.tell());
+            entry.size   = static_cast<uint32_t>(entrySize);
+            std::snprintf(entry.name, sizeof(entry.name), "%s\\file_%06zu.%s", dirs[i % 5], i, dirs[i % 5]);
+
+            FillRandom(data.data(), data.size(), uint32_t(i));
+            ofs.write(data.data(), data.size());
+        }
+
+        header.directoryOffset = static_cast<uint32_t>(ofs.tell());
+        ofs.write(static_cast<uint32_t>(entries.size()));
+        ofs.write(reinterpret_cast<const byte_t*>(entries.data()), entries.size() * sizeof(GobFileEntry));
+
+        ofs.seek(0);
+        ofs.write(reinterpret_cast<const byte_t*>(&header), sizeof(header));
+    }
+
+    RenameFile(path + ".tmp", path);
+    return path;
+}
+
+std::string bench::GetCndFixtureMaterialName(std::size_t idx)
+{
+    char name[64];
+    std::snprintf(name, sizeof(name), "mat_%05zu.mat", idx);
+    return name;
+}
+
+std::string bench::GetCndFixture(std::size_t numMaterials, uint32_t dim)
+{
+    const auto path = GetFixturePath("cnd_" + std::to_string(numMaterials) + "x" + std::to_string(dim) + ".cnd");
+    if(FileExists(path)) {
+        return path;
+    }
+
+    {
+        OutputFileStream ofs(path + ".tmp");
+        ofs.setSyncOnClose(false);
+
+        CndHeader header {};
+        header.copyright    = GetCopyrightNotice();
+        header.version      = GetFileVersion();
+        header.numMaterials = static_cast<uint32_t>(numMaterials);
+        ofs.write(reinterpret_cast<const byte_t*>(&header), sizeof(header));
+        ofs.write(uint32_t(0)); // unknown 4 bytes before material section
+
+        /* Material headers, material sizes alternate between dim and dim / 2 */
+        std::vector<CndMatHeader> matHeaders(numMaterials);
+        uint32_t nPixelDataSize = 0;
+        for(std::size_t i = 0; i < numMaterials; i++)
+        {
+            auto& mh = matHeaders[i];
+            std::snprintf(mh.name, sizeof(mh.name), "%s", GetCndFixtureMaterialName(i).c_str());
+            mh.width  = std::max<int>(int(dim >> (i % 2)), 1);
+            mh.height = mh.width;
+            mh.mipmapCount       = 1;
+            mh.texturesPerMipmap = 4;
+            mh.colorInfo = (i % 3 == 0) ? RGB_565 : ARGB_4444;
+            nPixelDataSize += GetMaterialPixelDataSize(mh);
+        }
+
+        ofs.write(nPixelDataSize);
+        ofs.write(reinterpret_cast<const byte_t*>(matHeaders.data()), matHeaders.size() * sizeof(CndMatHeader));
+
+        ByteArray pixelData(nPixelDataSize);
+        FillRandom(pixelData.data(), pixelData.size(), 1);
+        ofs.write(pixelData.data(), pixelData.size());
+
+        /* Rest of the level data */
+        ByteArray rest(64 * 1024, 0x5A);
+        ofs.write(rest.data(), rest.size());
+
+        ofs.seek(0);
+        ofs.write(static_cast<uint32_t>(ofs.size()));
+    }
+
+    RenameFile(path + ".tmp", path);
+    return path;
+}
+
+Material bench::MakeMaterial(const std::string& name, uint32_t dim, const ColorFormat& format, uint32_t numMipmaps, uint32_t numTextures)
+{
+    Material mat(name);
+    mat.setSize(dim, dim);
+    mat.setColorFormat(format);
+
+    uint32_t seed = 0;
+    for(uint32_t mmIdx = 0; mmIdx < numMipmaps; mmIdx++)
+    {
+        Mipmap mipmap;
+        for(uint32_t texIdx = 0; texIdx < numTextures && (dim >> texIdx) > 0; texIdx++)
+        {
+            const uint32_t texDim = dim >> texIdx;
+            auto bitmap = MakeBitmapPtr(GetBitmapSize(texDim, texDim, format.bpp));
+            FillRandom(bitmap->data(), bitmap->size(), seed++);
+
+            Texture tex;
+            tex.setWidth(texDim)
+               .setHeight(texDim)
+               .setColorInfo(format)
+               .setRowSize(GetRowSize(texDim, format.bpp))
+               .setBitmap(std::move(bitmap));
+            mipmap.push_back(std::move(tex));
+        }
+        mat.addMipmap(std::move(mipmap));
+    }
+
+    return mat;
+}
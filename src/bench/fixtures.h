@@ -0,0 +1,42 @@
+#ifndef LIBIM_BENCH_FIXTURES_H
+#define LIBIM_BENCH_FIXTURES_H
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include "libim/common.h"
+#include "libim/material/colorformat.h"
+#include "libim/material/material.h"
+
+/* Synthetic GOB, CND and MAT files with deterministic random content.
+   Fixture files are written to the fixture directory once and reused on following calls. */
+namespace bench {
+
+    void SetFixtureDir(std::string dir);
+    const std::string& GetFixtureDir();
+
+    /* Multiplier of the default fixture sizes (--libim_scale), at least 1 */
+    void SetScale(std::size_t scale);
+    std::size_t GetScale();
+
+    /* Returns path of file name in fixture directory. Fixture directory is created if it doesn't exist. */
+    std::string GetFixturePath(const std::string& name);
+    void CopyFixture(const std::string& from, const std::string& to);
+
+    /* Fills data with deterministic pseudo random bytes */
+    void FillRandom(byte_t* data, std::size_t size, uint32_t seed);
+
+    /* Returns path to GOB file with numEntries entries of entrySize bytes in 5 sub directories */
+    std::string GetGobFixture(std::size_t numEntries, std::size_t entrySize);
+
+    /* Returns path to CND file with numMaterials materials of size dim x dim with 4 textures per mipmap */
+    std::string GetCndFixture(std::size_t numMaterials, uint32_t dim);
+
+    /* Makes material with numMipmaps mipmaps of numTextures textures */
+    Material MakeMaterial(const std::string& name, uint32_t dim, const ColorFormat& format, uint32_t numMipmaps = 1, uint32_t numTextures = 4);
+
+    /* Returns name of material at index idx in CND fixture */
+    std::string GetCndFixtureMaterialName(std::size_t idx);
+}
+
+#endif // LIBIM_BENCH_FIXTURES_H
@@ -0,0 +1,53 @@
+#include <benchmark/benchmark.h>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "fixtures.h"
+
+static constexpr const char* OPT_SCALE       = "--libim_scale=";
+static constexpr const char* OPT_FIXTURE_DIR = "--libim_fixture_dir=";
+
+static bool StartsWith(const char* str, const char* prefix)
+{
+    return std::strncmp(str, prefix, std::strlen(prefix)) == 0;
+}
+
+int main(int argc, char** argv)
+{
+    /* Strip libim options before passing arguments to benchmark library */
+    std::vector<char*> args;
+    for(int i = 0; i < argc; i++)
+    {
+        if(StartsWith(argv[i], OPT_SCALE))
+        {
+            const long scale = std::strtol(argv[i] + std::strlen(OPT_SCALE), nullptr, 10);
+            if(scale < 1)
+            {
+                std::cerr << "Invalid scale: " << argv[i] << std::endl;
+                return 1;
+            }
+            bench::SetScale(std::size_t(scale));
+        }
+        else if(StartsWith(argv[i], OPT_FIXTURE_DIR)) {
+            bench::SetFixtureDir(argv[i] + std::strlen(OPT_FIXTURE_DIR));
+        }
+        else {
+            args.push_back(argv[i]);
+        }
+    }
+
+    int nArgs = int(args.size());
+    benchmark::Initialize(&nArgs, args.data());
+    if(benchmark::ReportUnrecognizedArguments(nArgs, args.data())) {
+        return 1;
+    }
+
+    benchmark::AddCustomContext("libim_scale", std::to_string(bench::GetScale()));
+    benchmark::AddCustomContext("libim_fixture_dir", bench::GetFixtureDir());
+    benchmark::RunSpecifiedBenchmarks();
+    benchmark::Shutdown();
+    return 0;
+}
@@ -0,0 +1,157 @@
+#ifndef CMDUTILS_ASYNCLOG_H
+#define CMDUTILS_ASYNCLOG_H
+#include <condition_variable>
+#include <cstddef>
+#include <iostream>
+#include <mutex>
+#include <streambuf>
+#include <string>
+#include <thread>
+
+/* Buffered asynchronous console log. Text written to stream() is collected in a buffer which is handed
+   to a background thread writing it to the destination stream, so the writing thread doesn't wait on console I/O.
+   Flush (std::endl, std::flush) only hands the buffer off; flush() waits until everything written so far
+   has been written and flushed to the destination. Like std::ostream, stream() must not be written from
+   several threads at the same time. Pending text is written when log is destroyed. */
+class AsyncLog
+{
+public:
+    explicit AsyncLog(std::ostream& dst, std::size_t bufferSize = 64 * 1024) :
+        m_buf(*this, bufferSize),
+        m_stream(&m_buf),
+        m_dst(dst),
+        m_writer([this]{ run(); })
+    {}
+
+    ~AsyncLog()
+    {
+        m_stream.flush();
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_stop = true;
+        }
+        m_cvPending.notify_one();
+        m_writer.join();
+        m_dst.flush();
+    }
+
+    AsyncLog(const AsyncLog&) = delete;
+    AsyncLog& operator = (const AsyncLog&) = delete;
+
+    std::ostream& stream()
+    {
+        return m_stream;
+    }
+
+    /* Blocks until all text written so far has been written to destination stream */
+    void flush()
+    {
+        m_stream.flush();
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_cvWritten.wait(lock, [&]{ return m_pending.empty() && !m_writing; });
+        m_dst.flush();
+    }
+
+private:
+    /* Stream buffer which collects text and hands it to log when full or on sync */
+    class Buffer : public std::streambuf
+    {
+    public:
+        Buffer(AsyncLog& log, std::size_t size) : m_log(log), m_size(size)
+        {
+            m_data.reserve(size);
+        }
+
+    protected:
+        int_type overflow(int_type ch) override
+        {
+            if(!traits_type::eq_int_type(ch, traits_type::eof()))
+            {
+                m_data.push_back(traits_type::to_char_type(ch));
+                if(m_data.size() >= m_size) {
+                    handOff();
+                }
+            }
+            return traits_type::not_eof(ch);
+        }
+
+        std::streamsize xsputn(const char* s, std::streamsize n) override
+        {
+            m_data.append(s, std::size_t(n));
+            if(m_data.size() >= m_size) {
+                handOff();
+            }
+            return n;
+        }
+
+        int sync() override
+        {
+            handOff();
+            return 0;
+        }
+
+    private:
+        void handOff()
+        {
+            if(!m_data.empty())
+            {
+                m_log.push(m_data);
+                m_data.clear();
+            }
+        }
+
+    private:
+        AsyncLog& m_log;
+        std::size_t m_size;
+        std::string m_data;
+    };
+
+    void push(const std::string& text)
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_pending += text;
+        }
+        m_cvPending.notify_one();
+    }
+
+    void run()
+    {
+        std::string text;
+        std::unique_lock<std::mutex> lock(m_mutex);
+        while(true)
+        {
+            m_cvPending.wait(lock, [&]{ return m_stop || !m_pending.empty(); });
+            if(m_pending.empty()) {
+                break; // stopped
+            }
+
+            std::swap(text, m_pending);
+            m_writing = true;
+            lock.unlock();
+
+            m_dst.write(text.data(), std::streamsize(text.size()));
+            m_dst.flush();
+            text.clear();
+
+            lock.lock();
+            m_writing = false;
+            m_cvWritten.notify_all();
+        }
+    }
+
+private:
+    Buffer m_buf;
+    std::ostream m_stream;
+    std::ostream& m_dst;
+
+    std::mutex m_mutex;
+    std::condition_variable m_cvPending;
+    std::condition_variable m_cvWritten;
+    std::string m_pending;
+    bool m_writing = false;
+    bool m_stop    = false;
+    std::thread m_writer; // started last, after all members it uses have been constructed
+};
+
+#endif // CMDUTILS_ASYNCLOG_H
@@ -0,0 +1,277 @@
+#ifndef CMDUTILS_BATCH_H
+#define CMDUTILS_BATCH_H
+#include <algorithm>
+#include <condition_variable>
+#include <cstddef>
+#include <exception>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <sys/stat.h>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "libim/common.h"
+#include "libim/utils/threadpool.h"
+#include "json.h"
+#include "orderedoutput.h"
+
+#ifdef OS_WINDOWS
+#  include <windows.h>
+#else
+#  include <glob.h>
+#endif
+
+/* Default memory budget of files processed in parallel in batch mode */
+static constexpr std::size_t BATCH_DEFAULT_MEMORY_MB = 1024;
+
+inline bool HasWildcard(const std::string& pattern)
+{
+    return pattern.find_first_of("*?[") != std::string::npos;
+}
+
+/* Appends files matching wildcard pattern to files, in sorted order */
+inline bool GlobFiles(const std::string& pattern, std::vector<std::string>& files)
+{
+#ifdef OS_WINDOWS
+    /* FindFirstFile matches only the file name part */
+    const auto sep = pattern.find_last_of("/\\");
+    const std::string dir = sep != std::string::npos ? pattern.substr(0, sep + 1) : "";
+
+    WIN32_FIND_DATAA fd;
+    HANDLE hFind = FindFirstFileA(pattern.c_str(), &fd);
+    if(hFind == INVALID_HANDLE_VALUE) {
+        return false;
+    }
+
+    std::vector<std::string> matches;
+    do
+    {
+        if(!(fd.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY)) {
+            matches.push_back(dir + fd.cFileName);
+        }
+    }
+    while(FindNextFileA(hFind, &fd));
+    FindClose(hFind);
+
+    std::sort(matches.begin(), matches.end());
+    files.insert(files.end(), matches.begin(), matches.end());
+    return !matches.empty();
+#else
+    glob_t g;
+    if(glob(pattern.c_str(), 0, nullptr, &g) != 0)
+    {
+        globfree(&g);
+        return false;
+    }
+
+    for(std::size_t i = 0; i < g.gl_pathc; i++) {
+        files.emplace_back(g.gl_pathv[i]);
+    }
+    globfree(&g);
+    return true;
+#endif
+}
+
+/* Expands input arguments of batch mode into list of files.
+   Argument with wildcards (*, ? or [) is expanded to matching files, argument @<file> is replaced with
+   arguments listed in file, one per line (empty lines and lines starting with # are skipped).
+   Duplicated files are removed. Returns false and prints error if pattern matches no file or list file can't be read. */
+inline bool ExpandInputs(const std::vector<std::string>& args, std::vector<std::string>& files, std::ostream& err = std::cerr)
+{
+    std::vector<std::string> expanded;
+    for(const auto& arg : args)
+    {
+        if(arg.size() > 1 && arg.front() == '@')
+        {
+            std::ifstream ifs(arg.substr(1));
+            if(!ifs)
+            {
+                err << "Error: Could not open input list file \"" << arg.substr(1) << "\"!\n";
+                return false;
+            }
+
+            std::vector<std::string> listed;
+            std::string line;
+            while(std::getline(ifs, line))
+            {
+                line.erase(line.find_last_not_of(" \t\r") + 1);
+                line.erase(0, line.find_first_not_of(" \t"));
+                if(!line.empty() && line.front() != '#') {
+                    listed.push_back(std::move(line));
+                }
+            }
+
+            if(!ExpandInputs(listed, expanded, err)) {
+                return false;
+            }
+        }
+        else if(HasWildcard(arg))
+        {
+            if(!GlobFiles(arg, expanded))
+            {
+                err << "Error: No file matches \"" << arg << "\"!\n";
+                return false;
+            }
+        }
+        else {
+            expanded.push_back(arg);
+        }
+    }
+
+    std::unordered_set<std::string> seen(files.begin(), files.end());
+    for(auto& file : expanded)
+    {
+        if(seen.insert(file).second) {
+            files.push_back(std::move(file));
+        }
+    }
+    return true;
+}
+
+/* Operation of batch on one file, writes its console output to out and err */
+using BatchOp = std::function<bool(std::ostream& out, std::ostream& err)>;
+
+/* Batch of operations on many files run in one process on one shared pool of worker threads.
+   Operations on the same file run in the order they were added and stop at the first failed operation,
+   files are processed in parallel. Each file is charged its size of the memory budget while being processed,
+   file is started only when its size fits into budget left by files in flight, so memory use stays bounded
+   (file bigger than the whole budget is processed alone). Console output of each file is buffered and printed in file order. */
+class Batch
+{
+public:
+    void add(const std::string& file, BatchOp op)
+    {
+        auto it = m_index.find(file);
+        if(it == m_index.end())
+        {
+            it = m_index.emplace(file, m_files.size()).first;
+            m_files.push_back({ file, {} });
+        }
+        m_files.at(it->second).ops.push_back(std::move(op));
+    }
+
+    bool empty() const
+    {
+        return m_files.empty();
+    }
+
+    std::size_t size() const
+    {
+        return m_files.size();
+    }
+
+    /* Runs batch on numThreads workers (0 = all hardware threads) with memoryBudget bytes (0 = unlimited).
+       Returns number of files which failed. */
+    std::size_t run(std::size_t numThreads, std::size_t memoryBudget, std::ostream& out = std::cout, std::ostream& err = std::cerr)
+    {
+        libim::ThreadPool pool(numThreads);
+        OrderedOutput output(m_files.size(), out, err);
+
+        std::mutex mutex;
+        std::condition_variable cvDone;
+        std::size_t nInFlight = 0; // bytes charged by files in flight
+        std::size_t nFailed   = 0;
+
+        for(std::size_t i = 0; i < m_files.size(); i++)
+        {
+            std::size_t cost = GetFileSize(m_files[i].path);
+            if(memoryBudget == 0) {
+                cost = 0;
+            }
+            else
+            {
+                cost = std::min(cost, memoryBudget);
+                std::unique_lock<std::mutex> lock(mutex);
+                cvDone.wait(lock, [&]{ return nInFlight + cost <= memoryBudget; });
+                nInFlight += cost;
+            }
+
+            pool.submit([&, i, cost]{
+                std::ostringstream fout;
+                std::ostringstream ferr;
+                bool bSuccess = true;
+                for(const auto& op : m_files[i].ops)
+                {
+                    try {
+                        bSuccess = op(fout, ferr);
+                    }
+                    catch(const std::exception& e)
+                    {
+                        ferr << "Error: " << m_files[i].path << ": " << e.what() << "!\n";
+                        bSuccess = false;
+                    }
+
+                    if(!bSuccess) {
+                        break;
+                    }
+                }
+
+                output.commit(i, fout.str(), ferr.str());
+
+                std::lock_guard<std::mutex> lock(mutex);
+                nInFlight -= cost;
+                nFailed   += bSuccess ? 0 : 1;
+                cvDone.notify_all();
+            });
+        }
+
+        pool.wait();
+
+        out << "=========================================\nBatch files processed: " << m_files.size() << std::endl;
+        if(nFailed > 0) {
+            err << "Batch files failed: " << nFailed << std::endl;
+        }
+        return nFailed;
+    }
+
+private:
+    static std::size_t GetFileSize(const std::string& path)
+    {
+        struct stat st;
+        return stat(path.c_str(), &st) == 0 ? std::size_t(st.st_size) : 0;
+    }
+
+private:
+    struct FileOps
+    {
+        std::string path;
+        std::vector<BatchOp> ops;
+    };
+
+    std::vector<FileOps> m_files;
+    std::unordered_map<std::string, std::size_t> m_index;
+};
+
+/* Loads jobs of JSON job file. Job file is an array of job objects or object with member "jobs" holding the array.
+   Throws JsonError on error. */
+inline std::vector<JsonValue> LoadBatchJobs(const std::string& file)
+{
+    const auto doc = LoadJsonFile(file);
+    const JsonValue* jobs = &doc;
+    if(doc.isObject())
+    {
+        jobs = doc.find("jobs");
+        if(!jobs) {
+            throw JsonError(file + ": missing \"jobs\" array");
+        }
+    }
+
+    if(!jobs->isArray()) {
+        throw JsonError(file + ": jobs is not an array");
+    }
+
+    for(const auto& job : jobs->items())
+    {
+        if(!job.isObject()) {
+            throw JsonError(file + ": job is not an object");
+        }
+    }
+    return jobs->items();
+}
+
+#endif // CMDUTILS_BATCH_H
@@ -0,0 +1,487 @@
+#ifndef CMDUTILS_JSON_H
+#define CMDUTILS_JSON_H
+#include <cctype>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+struct JsonError : public std::runtime_error {
+    using std::runtime_error::runtime_error;
+};
+
+/* Minimal JSON document value, enough for reading job files of command line tools.
+   Object members keep the order they were parsed in, lookup is linear. */
+class JsonValue
+{
+public:
+    enum class Type
+    {
+        Null,
+        Bool,
+        Number,
+        String,
+        Array,
+        Object
+    };
+
+    JsonValue() = default;
+    explicit JsonValue(Type type) : m_type(type) {}
+
+    Type type() const { return m_type; }
+    bool isNull()   const { return m_type == Type::Null;   }
+    bool isBool()   const { return m_type == Type::Bool;   }
+    bool isNumber() const { return m_type == Type::Number; }
+    bool isString() const { return m_type == Type::String; }
+    bool isArray()  const { return m_type == Type::Array;  }
+    bool isObject() const { return m_type == Type::Object; }
+
+    /* Value accessors throw JsonError if value is not of requested type */
+    bool asBool() const
+    {
+        check(Type::Bool, "boolean");
+        return m_bool;
+    }
+
+    double asNumber() const
+    {
+        check(Type::Number, "number");
+        return m_number;
+    }
+
+    const std::string& asString() const
+    {
+        check(Type::String, "string");
+        return m_string;
+    }
+
+    /* Array elements or object member values */
+    const std::vector<JsonValue>& items() const
+    {
+        if(!isArray() && !isObject()) {
+            throw JsonError("JSON value is not an array or object");
+        }
+        return m_items;
+    }
+
+    /* Object member names, in the same order as items() */
+    const std::vector<std::string>& keys() const
+    {
+        check(Type::Object, "object");
+        return m_keys;
+    }
+
+    /* Returns object member or nullptr if object has no member key */
+    const JsonValue* find(const std::string& key) const
+    {
+        check(Type::Object, "object");
+        for(std::size_t i = 0; i < m_keys.size(); i++)
+        {
+            if(m_keys[i] == key) {
+                return &m_items[i];
+            }
+        }
+        return nullptr;
+    }
+
+    /* Returns value of optional object member or def if member doesn't exist */
+    bool getBool(const std::string& key, bool def) const
+    {
+        auto v = find(key);
+        return v ? v->asBool() : def;
+    }
+
+    double getNumber(const std::string& key, double def) const
+    {
+        auto v = find(key);
+        return v ? v->asNumber() : def;
+    }
+
+    std::string getString(const std::string& key, const std::string& def = "") const
+    {
+        auto v = find(key);
+        return v ? v->asString() : def;
+    }
+
+    /* Returns string or array of strings member as vector */
+    std::vector<std::string> getStrings(const std::string& key) const
+    {
+        std::vector<std::string> strings;
+        if(auto v = find(key))
+        {
+            if(v->isString()) {
+                strings.push_back(v->asString());
+            }
+            else
+            {
+                check(*v, Type::Array, "\"" + key + "\" is not a string or array of strings");
+                for(const auto& item : v->items()) {
+                    strings.push_back(item.asString());
+                }
+            }
+        }
+        return strings;
+    }
+
+private:
+    void check(Type type, const char* name) const
+    {
+        check(*this, type, std::string("JSON value is not ") + (type == Type::Array || type == Type::Object ? "an " : "a ") + name);
+    }
+
+    static void check(const JsonValue& v, Type type, const std::string& msg)
+    {
+        if(v.m_type != type) {
+            throw JsonError(msg);
+        }
+    }
+
+private:
+    friend class JsonParser;
+    Type m_type = Type::Null;
+    bool m_bool = false;
+    double m_number = 0.0;
+    std::string m_string;
+    std::vector<std::string> m_keys;
+    std::vector<JsonValue> m_items;
+};
+
+/* Recursive descent parser of RFC 8259 JSON text. Errors are reported as JsonError with line and column. */
+class JsonParser
+{
+public:
+    explicit JsonParser(const std::string& text) : m_text(text) {}
+
+    JsonValue parse()
+    {
+        skipSpace();
+        auto value = parseValue(0);
+        skipSpace();
+        if(m_pos != m_text.size()) {
+            error("unexpected character after JSON value");
+        }
+        return value;
+    }
+
+private:
+    static constexpr std::size_t kMaxDepth = 256;
+
+    JsonValue parseValue(std::size_t depth)
+    {
+        if(depth > kMaxDepth) {
+            error("JSON value is nested too deep");
+        }
+
+        if(m_pos >= m_text.size()) {
+            error("unexpected end of JSON text");
+        }
+
+        switch(m_text[m_pos])
+        {
+        case '{': return parseObject(depth);
+        case '[': return parseArray(depth);
+        case '"':
+        {
+            JsonValue v(JsonValue::Type::String);
+            v.m_string = parseString();
+            return v;
+        }
+        case 't':
+        case 'f':
+        {
+            JsonValue v(JsonValue::Type::Bool);
+            v.m_bool = m_text[m_pos] == 't';
+            expectWord(v.m_bool ? "true" : "false");
+            return v;
+        }
+        case 'n':
+            expectWord("null");
+            return JsonValue();
+        default:
+            return parseNumber();
+        }
+    }
+
+    JsonValue parseObject(std::size_t depth)
+    {
+        JsonValue obj(JsonValue::Type::Object);
+        m_pos++; // '{'
+        skipSpace();
+        if(consume('}')) {
+            return obj;
+        }
+
+        do
+        {
+            skipSpace();
+            if(m_pos >= m_text.size() || m_text[m_pos] != '"') {
+                error("expected object member name");
+            }
+            obj.m_keys.push_back(parseString());
+
+            skipSpace();
+            if(!consume(':')) {
+                error("expected ':' after object member name");
+            }
+
+            skipSpace();
+            obj.m_items.push_back(parseValue(depth + 1));
+            skipSpace();
+        }
+        while(consume(','));
+
+        if(!consume('}')) {
+            error("expected ',' or '}' in object");
+        }
+        return obj;
+    }
+
+    JsonValue parseArray(std::size_t depth)
+    {
+        JsonValue arr(JsonValue::Type::Array);
+        m_pos++; // '['
+        skipSpace();
+        if(consume(']')) {
+            return arr;
+        }
+
+        do
+        {
+            skipSpace();
+            arr.m_items.push_back(parseValue(depth + 1));
+            skipSpace();
+        }
+        while(consume(','));
+
+        if(!consume(']')) {
+            error("expected ',' or ']' in array");
+        }
+        return arr;
+    }
+
+    std::string parseString()
+    {
+        std::string str;
+        m_pos++; // '"'
+        while(true)
+        {
+            if(m_pos >= m_text.size()) {
+                error("unterminated string");
+            }
+
+            const char ch = m_text[m_pos++];
+            if(ch == '"') {
+                break;
+            }
+            else if(static_cast<unsigned char>(ch) < 0x20) {
+                error("control character in string");
+            }
+            else if(ch != '\\')
+            {
+                str.push_back(ch);
+                continue;
+            }
+
+            if(m_pos >= m_text.size()) {
+                error("unterminated string");
+            }
+
+            switch(m_text[m_pos++])
+            {
+            case '"':  str.push_back('"');  break;
+            case '\\': str.push_back('\\'); break;
+            case '/':  str.push_back('/');  break;
+            case 'b':  str.push_back('\b'); break;
+            case 'f':  str.push_back('\f'); break;
+            case 'n':  str.push_back('\n'); break;
+            case 'r':  str.push_back('\r'); break;
+            case 't':  str.push_back('\t'); break;
+            case 'u':
+            {
+                uint32_t cp = parseHex4();
+                if(cp >= 0xD800 && cp <= 0xDBFF)
+                {
+                    /* UTF-16 surrogate pair */
+                    if(m_text.compare(m_pos, 2, "\\u") != 0) {
+                        error("invalid unicode surrogate pair");
+                    }
+                    m_pos += 2;
+                    const uint32_t low = parseHex4();
+                    if(low < 0xDC00 || low > 0xDFFF) {
+                        error("invalid unicode surrogate pair");
+                    }
+                    cp = 0x10000 + ((cp - 0xD800) << 10) + (low - 0xDC00);
+                }
+                else if(cp >= 0xDC00 && cp <= 0xDFFF) {
+                    error("invalid unicode surrogate pair");
+                }
+                appendUtf8(str, cp);
+                break;
+            }
+            default:
+                m_pos--;
+                error("invalid escape sequence in string");
+            }
+        }
+        return str;
+    }
+
+    uint32_t parseHex4()
+    {
+        if(m_pos + 4 > m_text.size()) {
+            error("invalid unicode escape sequence");
+        }
+
+        uint32_t cp = 0;
+        for(std::size_t i = 0; i < 4; i++)
+        {
+            const char ch = m_text[m_pos++];
+            cp <<= 4;
+            if(ch >= '0' && ch <= '9')      cp |= uint32_t(ch - '0');
+            else if(ch >= 'a' && ch <= 'f') cp |= uint32_t(ch - 'a' + 10);
+            else if(ch >= 'A' && ch <= 'F') cp |= uint32_t(ch - 'A' + 10);
+            else error("invalid unicode escape sequence");
+        }
+        return cp;
+    }
+
+    static void appendUtf8(std::string& str, uint32_t cp)
+    {
+        if(cp < 0x80) {
+            str.push_back(char(cp));
+        }
+        else if(cp < 0x800)
+        {
+            str.push_back(char(0xC0 | (cp >> 6)));
+            str.push_back(char(0x80 | (cp & 0x3F)));
+        }
+        else if(cp < 0x10000)
+        {
+            str.push_back(char(0xE0 | (cp >> 12)));
+            str.push_back(char(0x80 | ((cp >> 6) & 0x3F)));
+            str.push_back(char(0x80 | (cp & 0x3F)));
+        }
+        else
+        {
+            str.push_back(char(0xF0 | (cp >> 18)));
+            str.push_back(char(0x80 | ((cp >> 12) & 0x3F)));
+            str.push_back(char(0x80 | ((cp >> 6) & 0x3F)));
+            str.push_back(char(0x80 | (cp & 0x3F)));
+        }
+    }
+
+    JsonValue parseNumber()
+    {
+        /* Validate number grammar, conversion is done by strtod */
+        const std::size_t start = m_pos;
+        consume('-');
+        if(consume('0')) {}
+        else if(!digits()) {
+            error("invalid JSON value");
+        }
+
+        if(consume('.') && !digits()) {
+            error("invalid number");
+        }
+
+        if(consume('e') || consume('E'))
+        {
+            if(!consume('+')) consume('-');
+            if(!digits()) {
+                error("invalid number");
+            }
+        }
+
+        JsonValue v(JsonValue::Type::Number);
+        v.m_number = std::strtod(m_text.substr(start, m_pos - start).c_str(), nullptr);
+        return v;
+    }
+
+    bool digits()
+    {
+        const std::size_t start = m_pos;
+        while(m_pos < m_text.size() && std::isdigit(static_cast<unsigned char>(m_text[m_pos]))) {
+            m_pos++;
+        }
+        return m_pos > start;
+    }
+
+    void expectWord(const char* word)
+    {
+        const std::string w(word);
+        if(m_text.compare(m_pos, w.size(), w) != 0) {
+            error("invalid JSON value");
+        }
+        m_pos += w.size();
+    }
+
+    bool consume(char ch)
+    {
+        if(m_pos < m_text.size() && m_text[m_pos] == ch)
+        {
+            m_pos++;
+            return true;
+        }
+        return false;
+    }
+
+    void skipSpace()
+    {
+        while(m_pos < m_text.size() &&
+             (m_text[m_pos] == ' ' || m_text[m_pos] == '\t' || m_text[m_pos] == '\n' || m_text[m_pos] == '\r')) {
+            m_pos++;
+        }
+    }
+
+    [[noreturn]] void error(const std::string& msg) const
+    {
+        std::size_t line = 1;
+        std::size_t col  = 1;
+        for(std::size_t i = 0; i < m_pos && i < m_text.size(); i++)
+        {
+            if(m_text[i] == '\n')
+            {
+                line++;
+                col = 1;
+            }
+            else {
+                col++;
+            }
+        }
+        throw JsonError(msg + " at line " + std::to_string(line) + ", column " + std::to_string(col));
+    }
+
+private:
+    const std::string& m_text;
+    std::size_t m_pos = 0;
+};
+
+inline JsonValue ParseJson(const std::string& text)
+{
+    return JsonParser(text).parse();
+}
+
+/* Parses JSON file. Throws JsonError if file can't be read or is not valid JSON. */
+inline JsonValue LoadJsonFile(const std::string& file)
+{
+    std::ifstream ifs(file, std::ios::in | std::ios::binary);
+    if(!ifs) {
+        throw JsonError("could not open file \"" + file + "\"");
+    }
+
+    std::ostringstream ss;
+    ss << ifs.rdbuf();
+    try {
+        return ParseJson(ss.str());
+    }
+    catch(const JsonError& e) {
+        throw JsonError(file + ": " + e.what());
+    }
+}
+
+#endif // CMDUTILS_JSON_H
@@ -1,6 +1,10 @@
 #ifndef OPTIONS_H
 #define OPTIONS_H
+#include <cctype>
+#include <cerrno>
 #include <cstdint>
+#include <cstdlib>
+#include <cstring>
 #include <string>
 #include <unordered_map>
 #include <string>
@@ -91,4 +95,23 @@ private:
         std::vector<std::string>> m_options;
 };
 
+/* Parses decimal unsigned number of option argument into value.
+   Returns false if str is empty, is not a number or is out of range, value is left unchanged then. */
+inline bool ParseUnsigned(const std::string& str, std::size_t& value)
+{
+    if(str.empty() || !std::isdigit(static_cast<unsigned char>(str.front()))) {
+        return false;
+    }
+
+    errno = 0;
+    char* end = nullptr;
+    const unsigned long long n = std::strtoull(str.c_str(), &end, 10);
+    if(errno == ERANGE || *end != '\0' || n > SIZE_MAX) {
+        return false;
+    }
+
+    value = static_cast<std::size_t>(n);
+    return true;
+}
+
 #endif // OPTIONS_H
@@ -0,0 +1,54 @@
+#ifndef CMDUTILS_ORDEREDOUTPUT_H
+#define CMDUTILS_ORDEREDOUTPUT_H
+#include <cstddef>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <vector>
+
+/* Prints console output of parallel jobs in job order.
+   Output of job is buffered until output of all previous jobs has been printed. */
+class OrderedOutput
+{
+public:
+    explicit OrderedOutput(std::size_t numJobs, std::ostream& out = std::cout, std::ostream& err = std::cerr) :
+        m_jobs(numJobs),
+        m_out(out),
+        m_err(err)
+    {}
+
+    /* Sets output of finished job and prints all pending output which is in order */
+    void commit(std::size_t job, std::string out, std::string err)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto& entry = m_jobs.at(job);
+        entry.out  = std::move(out);
+        entry.err  = std::move(err);
+        entry.done = true;
+
+        for(; m_next < m_jobs.size() && m_jobs[m_next].done; m_next++)
+        {
+            auto& next = m_jobs[m_next];
+            m_out << next.out;
+            m_err << next.err;
+            next.out = std::string();
+            next.err = std::string();
+        }
+    }
+
+private:
+    struct JobOutput
+    {
+        std::string out;
+        std::string err;
+        bool done = false;
+    };
+
+    std::vector<JobOutput> m_jobs;
+    std::size_t m_next = 0;
+    std::ostream& m_out;
+    std::ostream& m_err;
+    std::mutex m_mutex;
+};
+
+#endif // CMDUTILS_ORDEREDOUTPUT_H
@@ -0,0 +1,120 @@
+#ifndef CMDUTILS_PROGRESS_H
+#define CMDUTILS_PROGRESS_H
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+
+#include "libim/common.h"
+#include "libim/utils/progress.h"
+
+#ifdef OS_WINDOWS
+#  include <io.h>
+#else
+#  include <unistd.h>
+#endif
+
+/* Returns true if stderr is a terminal, i.e. it is safe to redraw status line on it */
+inline bool IsStderrTerminal()
+{
+#ifdef OS_WINDOWS
+    return _isatty(_fileno(stderr)) != 0;
+#else
+    return isatty(fileno(stderr)) != 0;
+#endif
+}
+
+/* Returns progress of meter as "<done>/<total> <label>, <N> <label>/s, <N> MB/s, ETA <m:ss>" */
+inline std::string FormatProgress(const libim::ProgressMeter& meter, const char* label)
+{
+    std::ostringstream ss;
+    ss << std::fixed << std::setprecision(1)
+       << meter.doneItems() << "/" << meter.totalItems() << " " << label << ", "
+       << meter.itemsPerSecond() << " " << label << "/s, "
+       << meter.bytesPerSecond() / (1024.0 * 1024.0) << " MB/s";
+
+    const double eta = meter.eta();
+    if(eta >= 0.0)
+    {
+        const auto secs = static_cast<unsigned long>(eta + 0.5);
+        ss << ", ETA " << secs / 60 << ":" << std::setw(2) << std::setfill('0') << secs % 60;
+    }
+    return ss.str();
+}
+
+/* Returns summary of finished work as "<N> <label> (<N> MB) in <N> s, <N> <label>/s, <N> MB/s" */
+inline std::string FormatThroughput(const libim::ProgressMeter& meter, const char* label)
+{
+    std::ostringstream ss;
+    ss << std::fixed << std::setprecision(1)
+       << meter.doneItems() << " " << label << " (" << meter.doneBytes() / (1024.0 * 1024.0) << " MB) in "
+       << std::setprecision(2) << meter.elapsed() << " s, " << std::setprecision(1)
+       << meter.itemsPerSecond() << " " << label << "/s, "
+       << meter.bytesPerSecond() / (1024.0 * 1024.0) << " MB/s";
+    return ss.str();
+}
+
+/* Redraws status line with progress of meter on stderr every interval, while it is alive.
+   Nothing is drawn when stderr is not a terminal, so redirected output contains no status lines. */
+class ProgressPrinter
+{
+public:
+    ProgressPrinter(const libim::ProgressMeter& meter, const char* label, std::chrono::milliseconds interval = std::chrono::milliseconds(250)) :
+        m_meter(meter),
+        m_label(label),
+        m_interval(interval)
+    {
+        if(IsStderrTerminal()) {
+            m_thread = std::thread([this]{ run(); });
+        }
+    }
+
+    ~ProgressPrinter()
+    {
+        stop();
+    }
+
+    ProgressPrinter(const ProgressPrinter&) = delete;
+    ProgressPrinter& operator = (const ProgressPrinter&) = delete;
+
+    /* Stops redrawing and clears status line */
+    void stop()
+    {
+        if(!m_thread.joinable()) {
+            return;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_stop = true;
+        }
+        m_cv.notify_one();
+        m_thread.join();
+        std::cerr << "\r\033[K" << std::flush;
+    }
+
+private:
+    void run()
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        while(!m_cv.wait_for(lock, m_interval, [&]{ return m_stop; })) {
+            std::cerr << "\r\033[K" << FormatProgress(m_meter, m_label) << std::flush;
+        }
+    }
+
+private:
+    const libim::ProgressMeter& m_meter;
+    const char* m_label;
+    std::chrono::milliseconds m_interval;
+    std::mutex m_mutex;
+    std::condition_variable m_cv;
+    bool m_stop = false;
+    std::thread m_thread;
+};
+
+#endif // CMDUTILS_PROGRESS_H
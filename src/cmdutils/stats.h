@@ -0,0 +1,35 @@
+#ifndef CMDUTILS_STATS_H
+#define CMDUTILS_STATS_H
+#include <fstream>
+#include <iostream>
+#include <string>
+
+#include "libim/utils/stats.h"
+
+/* Writes libim stats as JSON to file or to stdout if file is empty */
+inline bool DumpStats(const std::string& file)
+{
+#ifdef LIBIM_ENABLE_STATS
+    const auto json = libim::stats::ToJson();
+    if(file.empty())
+    {
+        std::cout << json;
+        return true;
+    }
+
+    std::ofstream ofs(file, std::ios::out | std::ios::trunc);
+    if(!ofs || !(ofs << json))
+    {
+        std::cerr << "Error: Failed to write stats to file \"" << file << "\"!\n";
+        return false;
+    }
+
+    return true;
+#else
+    (void)file;
+    std::cerr << "Warning: Stats are not available, tool was built without LIBIM_ENABLE_STATS!\n";
+    return false;
+#endif
+}
+
+#endif // CMDUTILS_STATS_H
@@ -1,52 +1,222 @@
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <condition_variable>
+#include <cstring>
 #include <iomanip>
 #include <iostream>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <unordered_map>
 
 #include "libim/common.h"
 #include "libim/material/bmp.h"
+#include "libim/material/bmpreader.h"
 #include "libim/material/mat.h"
+#include "libim/material/matcache.h"
+#include "libim/material/mipmapgen.h"
 #include "libim/cnd.h"
+#include "libim/io/asyncio.h"
+#include "libim/io/compressedstream.h"
+#include "libim/utils/hash.h"
+#include "libim/utils/progress.h"
+#include "libim/utils/threadpool.h"
+#include "cmdutils/asynclog.h"
+#include "cmdutils/batch.h"
 #include "cmdutils/options.h"
+#include "cmdutils/orderedoutput.h"
+#include "cmdutils/progress.h"
+#include "cmdutils/stats.h"
 
 #define SETW(n, f)  std::right << std::setfill(f) << std::setw(n)
 #define SET_VINFO_LW(n) SETW(32 + n, '.')
 
 #define OPT_OTPUT_DIR         "--output-dir"
 #define OPT_OTPUT_DIR_SHORT   "-o"
+#define OPT_ASYNC             "--async"
+#define OPT_CACHE             "--cache"
 #define OPT_MAT_PATCH         "--mat-patch"
 #define OPT_MAT_PATCH_SHORT   "-mp"
 #define OPT_CONVERT_MAT       "--bmp"
 #define OPT_CONVERT_MAT_SHORT "-b"
+#define OPT_CONVERT_MAT32       "--bmp32"
+#define OPT_CONVERT_MAT32_SHORT "-b32"
+#define OPT_DUMP_SECTIONS     "--dump-sections"
+#define OPT_DEDUP             "--dedup"
+#define OPT_GEN_MIPMAPS       "--gen-mipmaps"
+#define OPT_GEN_MIPMAPS_SHORT "-gm"
+#define OPT_JOBS              "--jobs"
+#define OPT_JOBS_SHORT        "-j"
+#define OPT_JOBS_FILE         "--jobs-file"
+#define OPT_MAX_MEMORY        "--max-memory"
+#define OPT_NO_SYNC           "--no-sync"
+#define OPT_SECTIONS          "--sections"
+#define OPT_STATS             "--stats"
 #define OPT_VERBOSE           "--verbose"
 #define OPT_VERBOSE_SHORT     "-v"
+#define OPT_IN_PLACE          "--in-place"
+#define OPT_HASH              "--hash"
 #define OPT_HELP              "--help"
 #define OPT_HELP_SHORT        "-h"
 
+/* Registry of materials extracted in one run, shared by all extracted CND files.
+   Maps material content hash (CND::CndMaterialIndex::hashContent) to path of the extracted MAT file. */
+class MaterialDedup
+{
+public:
+    /* Registers matFile as copy of material with hash which is going to be extracted by the caller.
+       Returns empty string if matFile was registered, otherwise path of copy registered before,
+       which might not be extracted yet (see resolve). */
+    std::string claim(uint64_t hash, const std::string& matFile)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto it = m_copies.emplace(hash, Copy{ matFile, false });
+        return it.second ? std::string() : it.first->second.file;
+    }
+
+    /* Marks registered copy matFile of material with hash as extracted */
+    void confirm(uint64_t hash, const std::string& matFile)
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            auto it = m_copies.find(hash);
+            if(it != m_copies.end() && it->second.file == matFile) {
+                it->second.extracted = true;
+            }
+        }
+        m_cv.notify_all();
+    }
+
+    /* Unregisters copy matFile of material with hash if it was not extracted, so a duplicate can take over */
+    void release(uint64_t hash, const std::string& matFile)
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            auto it = m_copies.find(hash);
+            if(it != m_copies.end() && it->second.file == matFile && !it->second.extracted) {
+                m_copies.erase(it);
+            }
+        }
+        m_cv.notify_all();
+    }
+
+    /* Waits until registered copy of material with hash is extracted and returns its path.
+       If registered copy was released, matFile is registered instead and empty string is returned.
+       Caller must not hold unconfirmed claims of copies other callers can wait for, or resolve could deadlock. */
+    std::string resolve(uint64_t hash, const std::string& matFile)
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        while(true)
+        {
+            auto it = m_copies.find(hash);
+            if(it == m_copies.end())
+            {
+                m_copies.emplace(hash, Copy{ matFile, false });
+                return std::string();
+            }
+
+            if(it->second.extracted || it->second.file == matFile) {
+                return it->second.file == matFile ? std::string() : it->second.file;
+            }
+            m_cv.wait(lock);
+        }
+    }
+
+private:
+    struct Copy
+    {
+        std::string file;
+        bool extracted;
+    };
+
+    std::mutex m_mutex;
+    std::condition_variable m_cv;
+    std::unordered_map<uint64_t, Copy> m_copies;
+};
+
+/* Content hashes of materials of hashed CND files, reported across all files when the run is done */
+class HashReport
+{
+public:
+    struct Entry
+    {
+        std::string name;
+        uint64_t hash;
+        std::size_t size; // size of pixel data
+    };
+
+    /* Adds CND file to report and returns its slot. Files are reported in the order they were added. */
+    std::size_t add(const std::string& cndFile)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_files.push_back({ cndFile, {} });
+        return m_files.size() - 1;
+    }
+
+    void set(std::size_t slot, std::vector<Entry> entries)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_files.at(slot).entries = std::move(entries);
+    }
+
+    bool empty() const
+    {
+        return m_files.empty();
+    }
+
+    /* Prints groups of duplicated materials and totals */
+    void print(std::ostream& out) const;
+
+private:
+    struct File
+    {
+        std::string path;
+        std::vector<Entry> entries;
+    };
+
+    mutable std::mutex m_mutex;
+    std::vector<File> m_files;
+};
+
 void print_help();
-void PrintMaterialInfo(const Material& mat);
-void PrintMipmapInfo(const Mipmap& mipmap, uint32_t mmIdx);
+void PrintMaterialInfo(const Material& mat, std::ostream& out);
+void PrintMipmapInfo(const Mipmap& mipmap, uint32_t mmIdx, std::ostream& out);
 
-bool ReplaceMaterial(const std::string& cndFile, std::vector<std::string> matFiles);
-bool ExtractMaterials(const std::string& cndFile, std::string outDir, bool convert, bool verbose = false);
+bool RecoverCnd(const std::string& cndFile, std::ostream& out = std::cout, std::ostream& err = std::cerr);
+bool ReplaceMaterial(const std::string& cndFile, std::vector<std::string> matFiles, bool genMipmaps, uint32_t mipmapLevels, std::size_t asyncDepth, bool inPlace, std::size_t jobs = 0, std::ostream& out = std::cout, std::ostream& err = std::cerr);
+bool ListSections(const std::string& cndFile, bool dump, std::string outDir, bool sync, std::ostream& out = std::cout, std::ostream& err = std::cerr);
+bool ExtractMaterials(const std::string& cndFile, std::string outDir, bool convert, bool convert32, bool verbose = false, std::size_t jobs = 1, bool sync = true, const std::string& cacheDir = "", MaterialDedup* dedup = nullptr, libim::ProgressListener* progress = nullptr, std::ostream& out = std::cout, std::ostream& err = std::cerr);
+bool HashMaterials(const std::string& cndFile, std::size_t jobs, HashReport& report, std::size_t slot, libim::ProgressListener* progress = nullptr, std::ostream& out = std::cout, std::ostream& err = std::cerr);
+bool AddBatchJobs(Batch& batch, const std::string& jobsFile, const std::string& outDir, bool verbose, std::size_t asyncDepth, bool sync, const std::string& cacheDir, bool dedup, MaterialDedup& registry, HashReport& report, libim::ProgressListener* progress);
 
 int main(int argc, const char *argv[])
 {
     Options opt(argc, argv);
+    const bool bJobsFile = opt.hasOpt(OPT_JOBS_FILE);
 
     if(argc < 2 ||
        opt.hasOpt(OPT_HELP) ||
        opt.hasOpt(OPT_HELP_SHORT) ||
-       opt.unspecified().empty())
+       (opt.unspecified().empty() && !bJobsFile))
     {
         print_help();
         return 1;
     }
 
-    std::string inputFile = opt.unspecified().at(0);
-    if(!FileExists(inputFile)) 
-    {
-        std::cerr << "Error: File \"" << inputFile << "\" does not exists!"; 
+    std::vector<std::string> inputFiles;
+    if(!ExpandInputs(opt.unspecified(), inputFiles)) {
         return 1;
     }
+
+    for(const auto& inputFile : inputFiles)
+    {
+        if(!FileExists(inputFile)) 
+        {
+            std::cerr << "Error: File \"" << inputFile << "\" does not exists!"; 
+            return 1;
+        }
+    }
     
     std::string outDir;
     if(opt.hasOpt(OPT_OTPUT_DIR_SHORT)){
@@ -69,11 +239,84 @@ int main(int argc, const char *argv[])
         bConvertMatToBmp = true;
     }
 
+    bool bConvertMatToBmp32 = false;
+    if(opt.hasOpt(OPT_CONVERT_MAT32) || opt.hasOpt(OPT_CONVERT_MAT32_SHORT)){
+        bConvertMatToBmp   = true;
+        bConvertMatToBmp32 = true;
+    }
+
+    std::size_t nJobs = 1;
+    if(opt.hasOpt(OPT_JOBS_SHORT) || opt.hasOpt(OPT_JOBS))
+    {
+        auto jobs = opt.hasOpt(OPT_JOBS_SHORT) ? opt.arg(OPT_JOBS_SHORT) : opt.arg(OPT_JOBS);
+        nJobs = 0; // 0 = use all hardware threads
+        if(!jobs.empty() && !ParseUnsigned(jobs, nJobs))
+        {
+            std::cerr << "Error: Invalid number of jobs \"" << jobs << "\"!\n";
+            return 1;
+        }
+    }
+
+    /* Write patched file with async I/O */
+    std::size_t nAsyncDepth = 0;
+    if(opt.hasOpt(OPT_ASYNC))
+    {
+        auto depth  = opt.arg(OPT_ASYNC);
+        nAsyncDepth = AsyncIO::DEFAULT_QUEUE_DEPTH;
+        if(!depth.empty() && (!ParseUnsigned(depth, nAsyncDepth) || nAsyncDepth == 0))
+        {
+            std::cerr << "Error: Invalid async I/O queue depth \"" << depth << "\"!\n";
+            return 1;
+        }
+    }
+
+    const bool bSync = !opt.hasOpt(OPT_NO_SYNC);
+    const std::string cacheDir = opt.arg(OPT_CACHE);
+
+    /* Content hashes of materials are shared by all files of run */
+    const bool bDedup = opt.hasOpt(OPT_DEDUP);
+    MaterialDedup dedup;
+    HashReport hashReport;
+    MaterialDedup* pDedup  = bDedup ? &dedup : nullptr;
+    HashReport* pReport    = &hashReport;
+
+    /* Many input files or job file are processed in batch mode. Files are processed in parallel
+       on one pool of -j workers, each file by a single worker. */
+    const bool bBatch = bJobsFile || inputFiles.size() > 1;
+    const std::size_t nFileJobs = bBatch ? 1 : nJobs;
+
+    std::size_t nMaxMemoryMB = BATCH_DEFAULT_MEMORY_MB;
+    if(opt.hasOpt(OPT_MAX_MEMORY) && !ParseUnsigned(opt.arg(OPT_MAX_MEMORY), nMaxMemoryMB)) // 0 = unlimited
+    {
+        std::cerr << "Error: Invalid memory limit \"" << opt.arg(OPT_MAX_MEMORY) << "\"!\n";
+        return 1;
+    }
+
+    /* Console output is written by background thread, extraction and hashing progress is shown on one status line */
+    const bool bPatch  = opt.hasOpt(OPT_MAT_PATCH) || opt.hasOpt(OPT_MAT_PATCH_SHORT);
+    const bool bList   = opt.hasOpt(OPT_SECTIONS) || opt.hasOpt(OPT_DUMP_SECTIONS);
+    const bool bHash   = !bPatch && opt.hasOpt(OPT_HASH);
+    AsyncLog log(std::cout);
+    libim::ProgressMeter meter;
+    libim::ProgressListener* progress = &meter;
+    std::unique_ptr<ProgressPrinter> progressPrinter;
+    if(!bPatch && !bList) {
+        progressPrinter.reset(new ProgressPrinter(meter, "materials"));
+    }
 
     int result = 0;
+    Batch batch;
+    const auto addOp = [&](const std::string& file, BatchOp op) {
+        if(bBatch) {
+            batch.add(file, std::move(op));
+        }
+        else if(!op(log.stream(), std::cerr)) {
+            result = 1;
+        }
+    };
 
     /* Patch */
-    if(opt.hasOpt(OPT_MAT_PATCH) || opt.hasOpt(OPT_MAT_PATCH_SHORT))
+    if(bPatch)
     {
         auto matFiles  = opt.args(OPT_MAT_PATCH);
         auto matFiles2 = opt.args(OPT_MAT_PATCH_SHORT);
@@ -81,14 +324,86 @@ int main(int argc, const char *argv[])
                     std::make_move_iterator(matFiles2.begin()),
                     std::make_move_iterator(matFiles2.end()));
 
-        if(!ReplaceMaterial(inputFile, matFiles)) {
-            result = 1;
+        /* Regenerate mipmap chain of patched materials */
+        const bool bGenMipmaps = opt.hasOpt(OPT_GEN_MIPMAPS) || opt.hasOpt(OPT_GEN_MIPMAPS_SHORT);
+        const auto levels = opt.hasOpt(OPT_GEN_MIPMAPS_SHORT) ? opt.arg(OPT_GEN_MIPMAPS_SHORT) : opt.arg(OPT_GEN_MIPMAPS);
+        std::size_t nMipmapLevels = 0; // 0 = full chain
+        if(!levels.empty() && (!ParseUnsigned(levels, nMipmapLevels) || nMipmapLevels > UINT32_MAX))
+        {
+            std::cerr << "Error: Invalid number of mipmap levels \"" << levels << "\"!\n";
+            return 1;
+        }
+
+        /* Mipmaps are generated on -j threads */
+        const bool bInPlace = opt.hasOpt(OPT_IN_PLACE);
+        const std::size_t nMipmapJobs = nFileJobs;
+        for(const auto& inputFile : inputFiles)
+        {
+            addOp(inputFile, [=](std::ostream& out, std::ostream& err) {
+                return RecoverCnd(inputFile, out, err) &&
+                    ReplaceMaterial(inputFile, matFiles, bGenMipmaps, uint32_t(nMipmapLevels), nAsyncDepth, bInPlace, nMipmapJobs, out, err);
+            });
+        }
+    }
+    /* Report material content hashes and duplicated materials */
+    else if(bHash)
+    {
+        for(const auto& inputFile : inputFiles)
+        {
+            const std::size_t slot = hashReport.add(inputFile);
+            addOp(inputFile, [=](std::ostream& out, std::ostream& err) {
+                return RecoverCnd(inputFile, out, err) &&
+                    HashMaterials(inputFile, nFileJobs, *pReport, slot, progress, out, err);
+            });
+        }
+    }
+    /* List or dump file sections */
+    else if(bList)
+    {
+        const bool bDump = opt.hasOpt(OPT_DUMP_SECTIONS);
+        for(const auto& inputFile : inputFiles)
+        {
+            addOp(inputFile, [=](std::ostream& out, std::ostream& err) {
+                return RecoverCnd(inputFile, out, err) &&
+                    ListSections(inputFile, bDump, outDir, bSync, out, err);
+            });
         }
     }
     /* Extract materials */
-    else if(!ExtractMaterials(inputFile, std::move(outDir), bConvertMatToBmp, bVerboseOutput)) {
+    else
+    {
+        for(const auto& inputFile : inputFiles)
+        {
+            addOp(inputFile, [=](std::ostream& out, std::ostream& err) {
+                return RecoverCnd(inputFile, out, err) &&
+                    ExtractMaterials(inputFile, outDir, bConvertMatToBmp, bConvertMatToBmp32, bVerboseOutput, nFileJobs, bSync, cacheDir, pDedup, progress, out, err);
+            });
+        }
+    }
+
+    if(bJobsFile && !AddBatchJobs(batch, opt.arg(OPT_JOBS_FILE), outDir, bVerboseOutput, nAsyncDepth, bSync, cacheDir, bDedup, dedup, hashReport, progress)) {
         result = 1;
     }
+    else if(bBatch && batch.run(nJobs, nMaxMemoryMB * 1024 * 1024, log.stream(), std::cerr) > 0) {
+        result = 1;
+    }
+
+    if(progressPrinter)
+    {
+        progressPrinter->stop();
+        if(meter.doneItems() > 0) {
+            log.stream() << (bHash ? "Hashed " : "Processed ") << FormatThroughput(meter, "materials") << std::endl;
+        }
+    }
+
+    if(!hashReport.empty()) {
+        hashReport.print(log.stream());
+    }
+    log.flush();
+
+    if(opt.hasOpt(OPT_STATS)) {
+        DumpStats(opt.arg(OPT_STATS));
+    }
 
     return result;
 }
@@ -97,23 +412,39 @@ void print_help()
 {
     std::cout << "\nIndiana Jones and The Infernal Machine CND file extractor\n";
     std::cout << "Extracts or replaces material resources in CND file!\n";
-    std::cout << "  Usage: cndext <cnd file> [options] ..." << std::endl << std::endl;
+    std::cout << "  Usage: cndext <cnd file> [options] ..." << std::endl;
+    std::cout << "         cndext <cnd files, globs or @list file> [options] ..." << std::endl;
+    std::cout << "         cndext --jobs-file <file> [options]" << std::endl << std::endl;
 
     std::cout << "Option        Long option        Meaning\n";
+    std::cout << "  "                  << SETW(19, ' ') << OPT_ASYNC       << SETW(77, ' ') << "Patch with asynchronous I/O, [N] requests in flight (default 32)\n";
+    std::cout << "  "                  << SETW(19, ' ') << OPT_CACHE       << SETW(60, ' ') << "Reuse extracted materials stored in cache <dir>\n";
     std::cout << OPT_CONVERT_MAT_SHORT << SETW(17, ' ') << OPT_CONVERT_MAT << SETW(49, ' ') << "Convert extracted materials to bmp\n";
+    std::cout << OPT_CONVERT_MAT32_SHORT << SETW(17, ' ') << OPT_CONVERT_MAT32 << SETW(54, ' ') << "Convert extracted materials to 32 bit bmp\n";
+    std::cout << "  "                  << SETW(27, ' ') << OPT_DUMP_SECTIONS << SETW(62, ' ') << "Write raw data of every CND file section to output folder\n";
+    std::cout << "  "                  << SETW(19, ' ') << OPT_DEDUP       << SETW(94, ' ') << "Extract each material once, duplicates are listed in references.txt of mat folder\n";
+    std::cout << OPT_GEN_MIPMAPS_SHORT << SETW(24, ' ') << OPT_GEN_MIPMAPS << SETW(82, ' ') << "Generate mipmap chain of [N] textures for patched materials. 0 = full chain\n";
+    std::cout << "  "                  << SETW(18, ' ') << OPT_HASH        << SETW(82, ' ') << "Print content hash of every material and report duplicated materials\n";
     std::cout << OPT_HELP_SHORT        << SETW(18, ' ') << OPT_HELP        << SETW(31, ' ') << "Show this message\n";
-    std::cout << OPT_MAT_PATCH_SHORT   << SETW(22, ' ') << OPT_MAT_PATCH   << SETW(95, ' ') << "Replace materials in cnd file <material files>. No material is extracted from CND file\n";
+    std::cout << "  "                  << SETW(22, ' ') << OPT_IN_PLACE    << SETW(82, ' ') << "Patch materials of unchanged size in place instead of rewriting CND file\n";
+    std::cout << OPT_JOBS_SHORT        << SETW(18, ' ') << OPT_JOBS        << SETW(82, ' ') << "Number of parallel extraction and mipmap jobs <N>. 0 = all CPU cores\n";
+    std::cout << "  "                  << SETW(23, ' ') << OPT_JOBS_FILE    << SETW(78, ' ') << "Run extract, patch and sections jobs of JSON job <file> in batch mode\n";
+    std::cout << "  "                  << SETW(24, ' ') << OPT_MAX_MEMORY   << SETW(86, ' ') << "Memory budget <MB> of files processed in parallel in batch mode (default 1024)\n";
+    std::cout << OPT_MAT_PATCH_SHORT   << SETW(22, ' ') << OPT_MAT_PATCH   << SETW(97, ' ') << "Replace materials in cnd file <mat or bmp files>. No material is extracted from CND file\n";
+    std::cout << "  "                  << SETW(21, ' ') << OPT_NO_SYNC     << SETW(55, ' ') << "Don't flush extracted files to disk on close\n";
     std::cout << OPT_OTPUT_DIR_SHORT   << SETW(24, ' ') << OPT_OTPUT_DIR   << SETW(34, ' ') << "Output folder <output dir>\n";
+    std::cout << "  "                  << SETW(22, ' ') << OPT_SECTIONS    << SETW(32, ' ') << "List CND file sections\n";
+    std::cout << "  "                  << SETW(19, ' ') << OPT_STATS       << SETW(55, ' ') << "Dump I/O stats as JSON to stdout or [file]\n";
     std::cout << OPT_VERBOSE_SHORT     << SETW(21, ' ') << OPT_VERBOSE     << SETW(25, ' ') << "Verbose output\n";
 }
 
-void PrintMaterialInfo(const Material& mat)
+void PrintMaterialInfo(const Material& mat, std::ostream& out)
 {
     if(mat.mipmaps().empty()) return;
-    std::cout << "    Total mipmaps:" << SET_VINFO_LW(2) << mat.mipmaps().size() << std::endl << std::endl;
+    out << "    Total mipmaps:" << SET_VINFO_LW(2) << mat.mipmaps().size() << "\n\n";
 }
 
-void PrintMipmapInfo(const Mipmap& mipmap, uint32_t mmIdx)
+void PrintMipmapInfo(const Mipmap& mipmap, uint32_t mmIdx, std::ostream& out)
 {
     if(mipmap.empty()) return;
     const Texture& tex = mipmap.at(0);
@@ -132,49 +463,123 @@ void PrintMipmapInfo(const Mipmap& mipmap, uint32_t mmIdx)
         break;
     }
 
-    std::cout << "    ------------------ Mipmap Info -----------------\n";
-    std::cout << "    MIP num:" << SET_VINFO_LW(8)  << mmIdx << std::endl;
-    std::cout << "    Width:"   << SET_VINFO_LW(10) << tex.width() << std::endl;
-    std::cout << "    Height:"  << SET_VINFO_LW(9)  << tex.height() << std::endl;
-    std::cout << "    Mipmap textures:" << SET_VINFO_LW(0) << mipmap.size() << std::endl;
-    std::cout << "    Pixel data size:" << SET_VINFO_LW(0) << GetMipmapPixelDataSize(mipmap.size(), tex.width(), tex.height(), tex.colorInfo().bpp) << std::endl;
-    std::cout << "    Color info:\n";
+    out << "    ------------------ Mipmap Info -----------------\n";
+    out << "    MIP num:" << SET_VINFO_LW(8)  << mmIdx << '\n';
+    out << "    Width:"   << SET_VINFO_LW(10) << tex.width() << '\n';
+    out << "    Height:"  << SET_VINFO_LW(9)  << tex.height() << '\n';
+    out << "    Mipmap textures:" << SET_VINFO_LW(0) << mipmap.size() << '\n';
+    out << "    Pixel data size:" << SET_VINFO_LW(0) << GetMipmapPixelDataSize(mipmap.size(), tex.width(), tex.height(), tex.colorInfo().bpp) << '\n';
+    out << "    Color info:\n";
 
     auto cmLw = colorMode.size() /2;
     cmLw = (colorMode.size()  % 8 == 0 ? cmLw -1 : cmLw);
-    std::cout << "      Color mode:" << SET_VINFO_LW(cmLw) << colorMode << std::endl;
-    std::cout << "      Bit depth:"  << SET_VINFO_LW(4) << tex.colorInfo().bpp << std::endl;
-    std::cout << "      Bit depth per channel:" << std::endl;
-    std::cout << "        Red:"   << SET_VINFO_LW(8) << tex.colorInfo().redBPP   << std::endl;
-    std::cout << "        Green:" << SET_VINFO_LW(6) << tex.colorInfo().greenBPP << std::endl;
-    std::cout << "        Blue:"  << SET_VINFO_LW(7) << tex.colorInfo().blueBPP  << std::endl;
-    std::cout << "        Alpha:" << SET_VINFO_LW(6) << tex.colorInfo().alphaBPP << std::endl;
-    std::cout << "      Left shift per channel:" << std::endl;
-    std::cout << "        Red:"   << SET_VINFO_LW(8) << tex.colorInfo().RedShl   << std::endl;
-    std::cout << "        Green:" << SET_VINFO_LW(6) << tex.colorInfo().GreenShl << std::endl;
-    std::cout << "        Blue:"  << SET_VINFO_LW(7) << tex.colorInfo().BlueShl  << std::endl;
-    std::cout << "        Alpha:" << SET_VINFO_LW(6) << tex.colorInfo().AlphaShl << std::endl;
-    std::cout << "      Right shift per channel:" << std::endl;
-    std::cout << "        Red:"   << SET_VINFO_LW(8) << tex.colorInfo().RedShr   << std::endl;
-    std::cout << "        Green:" << SET_VINFO_LW(6) << tex.colorInfo().GreenShr << std::endl;
-    std::cout << "        Blue:"  << SET_VINFO_LW(7) << tex.colorInfo().BlueShr  << std::endl;
-    std::cout << "        Alpha:" << SET_VINFO_LW(6) << tex.colorInfo().AlphaShr << std::endl << std::endl;
+    out << "      Color mode:" << SET_VINFO_LW(cmLw) << colorMode << '\n';
+    out << "      Bit depth:"  << SET_VINFO_LW(4) << tex.colorInfo().bpp << '\n';
+    out << "      Bit depth per channel:" << '\n';
+    out << "        Red:"   << SET_VINFO_LW(8) << tex.colorInfo().redBPP   << '\n';
+    out << "        Green:" << SET_VINFO_LW(6) << tex.colorInfo().greenBPP << '\n';
+    out << "        Blue:"  << SET_VINFO_LW(7) << tex.colorInfo().blueBPP  << '\n';
+    out << "        Alpha:" << SET_VINFO_LW(6) << tex.colorInfo().alphaBPP << '\n';
+    out << "      Left shift per channel:" << '\n';
+    out << "        Red:"   << SET_VINFO_LW(8) << tex.colorInfo().RedShl   << '\n';
+    out << "        Green:" << SET_VINFO_LW(6) << tex.colorInfo().GreenShl << '\n';
+    out << "        Blue:"  << SET_VINFO_LW(7) << tex.colorInfo().BlueShl  << '\n';
+    out << "        Alpha:" << SET_VINFO_LW(6) << tex.colorInfo().AlphaShl << '\n';
+    out << "      Right shift per channel:" << '\n';
+    out << "        Red:"   << SET_VINFO_LW(8) << tex.colorInfo().RedShr   << '\n';
+    out << "        Green:" << SET_VINFO_LW(6) << tex.colorInfo().GreenShr << '\n';
+    out << "        Blue:"  << SET_VINFO_LW(7) << tex.colorInfo().BlueShr  << '\n';
+    out << "        Alpha:" << SET_VINFO_LW(6) << tex.colorInfo().AlphaShr << "\n\n";
+}
+
+bool RecoverCnd(const std::string& cndFile, std::ostream& out, std::ostream& err)
+{
+    /* Roll back in-place patch interrupted by crash, so half patched file is not read */
+    try
+    {
+        if(libim::CND::RecoverInPlacePatch(cndFile)) {
+            out << "Interrupted in-place patch of CND file was rolled back\n";
+        }
+        return true;
+    }
+    catch(const std::exception& e)
+    {
+        err << "Error: Failed to roll back interrupted in-place patch: " << e.what() << "!\n";
+        return false;
+    }
+}
+
+bool IsBmpFile(const std::string& file)
+{
+    auto ext = GetFileExtension(file);
+    std::transform(ext.begin(), ext.end(), ext.begin(), [](char c){ return char(std::tolower(static_cast<unsigned char>(c))); });
+    return ext == "bmp";
 }
 
-bool ReplaceMaterial(const std::string& cndFile, std::vector<std::string> matFiles)
+bool ReplaceMaterial(const std::string& cndFile, std::vector<std::string> matFiles, bool genMipmaps, uint32_t mipmapLevels, std::size_t asyncDepth, bool inPlace, std::size_t jobs, std::ostream& out, std::ostream& err)
 {
     bool bSuccess = false;
     if(!matFiles.empty())
     {
+         /* Load all materials first so the cnd file is rewritten only once */
+         std::vector<Material> mats;
+         mats.reserve(matFiles.size());
+         std::unique_ptr<libim::CND::CndMaterialTable> cndMats; // read on the first bmp file
          for(const auto& matFile : matFiles)
          {
-            auto mat = LoadMaterialFromFile(matFile);
-            if(!mat || !libim::CND::ReplaceMaterial(*mat, cndFile)) {
+            std::shared_ptr<Material> mat;
+            if(IsBmpFile(matFile))
+            {
+                /* BMP is decoded straight to color format of material it replaces */
+                try
+                {
+                    if(!cndMats) {
+                        cndMats.reset(new libim::CND::CndMaterialTable(InputFileStream(cndFile)));
+                    }
+                }
+                catch(const std::exception& e)
+                {
+                    err << "Error: Failed to read materials of CND file: " << e.what() << "!\n";
+                    return false;
+                }
+
+                const auto matName = GetBaseName(matFile) + ".mat";
+                const auto row = cndMats->find(matName);
+                if(row == libim::CND::CndMaterialTable::npos)
+                {
+                    err << "Error: Material " << matName << " of bmp file " << matFile << " was not found in CND file!\n";
+                    return false;
+                }
+                mat = LoadMaterialFromBmpFile(matFile, cndMats->format(libim::CND::CndMaterialTable::Row(row)), err);
+            }
+            else {
+                mat = LoadMaterialFromFile(matFile);
+            }
+
+            if(!mat) {
                 return false;
             }
+            mats.push_back(std::move(*mat));
+         }
+
+         if(genMipmaps)
+         {
+             try {
+                 GenerateMipmaps(mats, mipmapLevels, jobs);
+             }
+             catch(const std::exception& e)
+             {
+                 err << "Error: Failed to generate mipmaps: " << e.what() << "!\n";
+                 return false;
+             }
          }
 
-         std::cout << "CND file has been successfully patched!\n";
+         const auto mode = inPlace ? libim::CND::CndPatchMode::InPlace : libim::CND::CndPatchMode::Rewrite;
+         if(!libim::CND::ReplaceMaterials(mats, cndFile, asyncDepth, mode)) {
+             return false;
+         }
+
+         out << "CND file has been successfully patched!\n";
          bSuccess = true;
     }
     else {
@@ -184,16 +589,179 @@ bool ReplaceMaterial(const std::string& cndFile, std::vector<std::string> matFil
     return bSuccess;
 }
 
-bool ExtractMaterials(const std::string& cndFile, std::string outDir, bool convert, bool verbose)
+bool ExtractMaterial(const Material& mat, const std::string& matDir, const std::string& bmpDir, bool convert, bool convert32, bool verbose, bool sync, std::ostream& out, std::ostream& err, std::vector<std::string>* bmpFiles = nullptr)
+{
+    if(verbose) {
+        out << "Extracting material: " << mat.name() << '\n';
+    }
+
+    std::string matFilePath(matDir + "/" + mat.name());
+    if(!SaveMaterialToFile(std::move(matFilePath), mat, sync))
+    {
+        err << "Error: Failed to save material: " << mat.name() << "!\n";
+        return false;
+    }
+
+    if(verbose)
+    {
+        out << "  ================== Material Info ===================\n";
+        PrintMaterialInfo(mat, out);
+    }
+
+    /* Print material mipmaps info and convert to bmp */
+    if(convert || verbose)
+    {
+        uint32_t mmIdx = 0;
+        for(const auto& mipmap : mat.mipmaps())
+        {
+            if(verbose) {
+                PrintMipmapInfo(mipmap, mmIdx, out);
+            }
+
+            /* Save as bmp */
+            if(convert)
+            {
+                for(std::size_t texIdx = 0; texIdx < mipmap.size(); texIdx++)
+                {
+                    const std::string sufix = (mat.mipmaps().size() > 1 ? "_" + std::to_string(mmIdx) : "") + ".bmp";
+                    const std::string infix = mipmap.size() > 1 ? "_" + std::to_string(texIdx) : "";
+                    const std::string fileName = bmpDir + "/" + GetBaseName(mat.name()) + infix + sufix;
+
+                    const auto& tex = mipmap.at(texIdx);
+                    if(!SaveBmpToFile(fileName, convert32 ? tex.toBmp(BGRA_8888) : tex.toBmp(), sync)) {
+                        return false;
+                    }
+
+                    if(bmpFiles) {
+                        bmpFiles->push_back(fileName);
+                    }
+                }
+            }
+
+            mmIdx++;
+        }
+    }
+
+    if(verbose) {
+        out << "  =============== Material Info End =================\n\n\n";
+    }
+
+    return true;
+}
+
+/* Extracts material idx of CND file through material cache. Files of material with cached hash
+   are copied from the cache, otherwise the material is decoded, extracted and its files are stored to the cache.
+   Index stream is shared but read with readAt, so materials can be loaded from several threads. */
+bool ExtractCachedMaterial(const libim::CND::CndMaterialIndex& index, std::size_t idx, uint64_t hash, MaterialCache& cache,
+                           const std::string& matDir, const std::string& bmpDir, bool convert, bool convert32, bool verbose, bool sync, std::ostream& out, std::ostream& err, bool& cacheHit)
 {
-    InputFileStream ifstream(cndFile);
-    auto materials = libim::CND::LoadMaterials(ifstream);
+    const std::string bmpKind = convert32 ? "bmp32" : "bmp";
+
+    cacheHit = cache.fetch(hash, "mat", matDir, sync) && (!convert || cache.fetch(hash, bmpKind, bmpDir, sync));
+    if(cacheHit)
+    {
+        const std::string name(index.at(idx).header.name, strnlen(index.at(idx).header.name, sizeof(index.at(idx).header.name)));
+        if(verbose)
+        {
+            out << "Extracting material: " << name << " (cached)\n";
+
+            /* Material info needs decoded material */
+            const auto mat = index.loadMaterial(idx);
+            out << "  ================== Material Info ===================\n";
+            PrintMaterialInfo(mat, out);
+
+            uint32_t mmIdx = 0;
+            for(const auto& mipmap : mat.mipmaps()) {
+                PrintMipmapInfo(mipmap, mmIdx++, out);
+            }
+            out << "  =============== Material Info End =================\n\n\n";
+        }
+        return true;
+    }
+
+    const auto mat = index.loadMaterial(idx);
+    std::vector<std::string> bmpFiles;
+    if(!ExtractMaterial(mat, matDir, bmpDir, convert, convert32, verbose, sync, out, err, &bmpFiles)) {
+        return false;
+    }
+
+    /* Failing to store material to cache only makes the next run slower */
+    if(!cache.store(hash, "mat", { matDir + "/" + mat.name() }) ||
+       (convert && !cache.store(hash, bmpKind, bmpFiles))) {
+        err << "Warning: Failed to store material " << mat.name() << " to cache!\n";
+    }
+
+    return true;
+}
 
+/* Returns size of pixel data of all material's textures */
+std::size_t GetPixelDataSize(const Material& mat)
+{
+    std::size_t size = 0;
+    for(const auto& mipmap : mat.mipmaps()) {
+        for(const auto& tex : mipmap) {
+            size += tex.bitmap() ? tex.bitmap()->size() : 0;
+        }
+    }
+    return size;
+}
+
+bool ExtractMaterials(const std::string& cndFile, std::string outDir, bool convert, bool convert32, bool verbose, std::size_t jobs, bool sync, const std::string& cacheDir, MaterialDedup* dedup, libim::ProgressListener* progress, std::ostream& fout, std::ostream& ferr)
+{
+    /* Without cache and dedup all materials are decoded up front, otherwise only the material header table
+       is read and materials are decoded on cache miss or when not extracted before */
+    std::vector<Material> materials;
+    std::unique_ptr<libim::CND::CndMaterialIndex> index;
+    std::unique_ptr<MaterialCache> cache;
+    std::vector<uint64_t> hashes;
+    std::vector<uint64_t> contentHashes;
+    if(cacheDir.empty() && !dedup)
+    {
+        auto ifstream = OpenInputStream(cndFile);
+        materials = libim::CND::LoadMaterials(*ifstream);
+    }
+    else
+    {
+        try
+        {
+            index = std::make_unique<libim::CND::CndMaterialIndex>(OpenInputStream(cndFile));
+            if(dedup) {
+                contentHashes = libim::CND::HashMaterials(*index, jobs);
+            }
+
+            if(!cacheDir.empty())
+            {
+                cache = std::make_unique<MaterialCache>(cacheDir);
+
+                /* Hash materials only when CND file changed since the last run */
+                hashes = cache->loadManifest(cndFile);
+                if(hashes.size() != index->size())
+                {
+                    hashes.clear();
+                    hashes.reserve(index->size());
+                    for(std::size_t i = 0; i < index->size(); i++) {
+                        hashes.push_back(index->hashMaterial(i));
+                    }
+
+                    if(!index->empty() && !cache->storeManifest(cndFile, hashes)) {
+                        ferr << "Warning: Failed to store CND manifest to cache!\n";
+                    }
+                }
+            }
+        }
+        catch(const std::exception& e)
+        {
+            ferr << "Error: " << e.what() << "!\n";
+            return false;
+        }
+    }
+
+    const std::size_t nMaterials = index ? index->size() : materials.size();
     std::string matDir;
     std::string bmpDir;
-    if(!materials.empty())
+    if(nMaterials > 0)
     {
-        std::cout << "Found materials: " << materials.size()<< std::endl;
+        fout << "Found materials: " << nMaterials << '\n';
 
         outDir += (outDir.empty() ? "" : "/" ) + GetBaseName(cndFile);
         matDir = outDir + "/" + "mat";
@@ -206,56 +774,419 @@ bool ExtractMaterials(const std::string& cndFile, std::string outDir, bool conve
         }
     }
 
-    /* Save extracted materials to files */
-    for(const auto& mat : materials)
+    /* Duplicated materials are claimed in material order, so the first copy in file is extracted.
+       Claimed copies are confirmed once extracted, copies which were not extracted are released on return. */
+    std::vector<std::string> matFiles(dedup ? nMaterials : 0);
+    std::vector<std::string> extractedCopies(dedup ? nMaterials : 0);
+    std::size_t nDuplicates = 0;
+    for(std::size_t i = 0; i < extractedCopies.size(); i++)
     {
-        std::cout << "Extracting material: " << mat.name() << std::endl;
+        const auto& header = index->at(i).header;
+        matFiles[i] = matDir + "/" + std::string(header.name, strnlen(header.name, sizeof(header.name)));
+        extractedCopies[i] = dedup->claim(contentHashes[i], matFiles[i]);
+        nDuplicates += extractedCopies[i].empty() ? 0 : 1;
+    }
 
-        std::string matFilePath(matDir + "/" + mat.name());
-        if(!SaveMaterialToFile(std::move(matFilePath), mat)) {
-            return false;
+    struct ClaimGuard
+    {
+        ~ClaimGuard()
+        {
+            for(std::size_t i = 0; i < matFiles.size(); i++) {
+                dedup->release(hashes[i], matFiles[i]);
+            }
         }
+        MaterialDedup* dedup;
+        const std::vector<uint64_t>& hashes;
+        const std::vector<std::string>& matFiles;
+    } claimGuard { dedup, contentHashes, matFiles };
 
-        if(verbose)
+    if(progress)
+    {
+        std::size_t nBytes = 0;
+        for(std::size_t i = 0; i < nMaterials; i++) {
+            nBytes += index ? index->at(i).pixelDataSize : GetPixelDataSize(materials.at(i));
+        }
+        progress->onBegin(nMaterials, nBytes);
+    }
+
+    std::atomic<std::size_t> nCached(0);
+    const auto extractMaterial = [&](std::size_t i, std::ostream& out, std::ostream& err){
+        if(!index) {
+            return ExtractMaterial(materials.at(i), matDir, bmpDir, convert, convert32, verbose, sync, out, err);
+        }
+
+        try
+        {
+            bool bExtracted = false;
+            if(!cache) {
+                bExtracted = ExtractMaterial(index->loadMaterial(i), matDir, bmpDir, convert, convert32, verbose, sync, out, err);
+            }
+            else
+            {
+                bool bCacheHit = false;
+                bExtracted = ExtractCachedMaterial(*index, i, hashes.at(i), *cache, matDir, bmpDir, convert, convert32, verbose, sync, out, err, bCacheHit);
+                nCached += bCacheHit ? 1 : 0;
+            }
+
+            if(bExtracted && dedup) {
+                dedup->confirm(contentHashes.at(i), matFiles.at(i));
+            }
+            return bExtracted;
+        }
+        catch(const std::exception& e)
         {
-            std::cout << "  ================== Material Info ===================\n";
-            PrintMaterialInfo(mat);
+            err << "Error: Failed to extract material " << i << ": " << e.what() << "!\n";
+            return false;
         }
+    };
 
-        /* Print material mipmaps info and convert to bmp */
-        if(convert || verbose)
+    const auto extract = [&](std::size_t i, std::ostream& out, std::ostream& err){
+        if(dedup && !extractedCopies.at(i).empty()) {
+            return true; // duplicate is resolved after own copies are extracted
+        }
+
+        const bool bExtracted = extractMaterial(i, out, err);
+        if(bExtracted && progress)
         {
-            uint32_t mmIdx = 0;
-            for(const auto& mipmap : mat.mipmaps())
+            if(index)
             {
-                if(verbose) {
-                    PrintMipmapInfo(mipmap, mmIdx);
+                const auto& entry = index->at(i);
+                progress->onItem(std::string(entry.header.name, strnlen(entry.header.name, sizeof(entry.header.name))), entry.pixelDataSize);
+            }
+            else {
+                progress->onItem(materials.at(i).name(), GetPixelDataSize(materials.at(i)));
+            }
+        }
+        return bExtracted;
+    };
+
+    /* Save extracted materials to files */
+    if(jobs == 1 || nMaterials < 2)
+    {
+        for(std::size_t i = 0; i < nMaterials; i++)
+        {
+            if(!extract(i, fout, ferr)) {
+                return false;
+            }
+        }
+    }
+    else
+    {
+        /* Materials are encoded and written by pool workers, console output is printed in material order */
+        libim::ThreadPool pool(jobs);
+        OrderedOutput output(nMaterials, fout, ferr);
+        std::atomic<bool> bFailed(false);
+
+        for(std::size_t i = 0; i < nMaterials; i++)
+        {
+            pool.submit([&, i]{
+                std::ostringstream out;
+                std::ostringstream err;
+                if(!bFailed && !extract(i, out, err)) {
+                    bFailed = true;
                 }
+                output.commit(i, out.str(), err.str());
+            });
+        }
 
-                /* Save as bmp */
-                if(convert)
-                {
-                    for(std::size_t texIdx = 0; texIdx < mipmap.size(); texIdx++)
-                    {
-                        const std::string sufix = (mat.mipmaps().size() > 1 ? "_" + std::to_string(mmIdx) : "") + ".bmp";
-                        const std::string infix = mipmap.size() > 1 ? "_" + std::to_string(texIdx) : "";
-                        const std::string fileName = bmpDir + "/" + GetBaseName(mat.name()) + infix + sufix;
-
-                        if(!SaveBmpToFile(fileName, mipmap.at(texIdx).toBmp())) {
-                            return false;
-                        }
-                    }
+        pool.wait();
+        if(bFailed) {
+            return false;
+        }
+    }
+
+    /* Duplicates are resolved after all own copies were extracted, so files waiting for each other's copies can't deadlock.
+       Duplicate of copy which failed to extract is extracted in its place. */
+    if(dedup && nMaterials > 0)
+    {
+        std::ostringstream references;
+        for(std::size_t i = 0; i < nMaterials; i++)
+        {
+            if(extractedCopies[i].empty()) {
+                continue;
+            }
+
+            extractedCopies[i] = dedup->resolve(contentHashes[i], matFiles[i]);
+            if(extractedCopies[i].empty())
+            {
+                nDuplicates--;
+                if(!extract(i, fout, ferr)) {
+                    return false;
                 }
+                continue;
+            }
 
-                mmIdx++;
+            const auto& entry = index->at(i);
+            const std::string name(entry.header.name, strnlen(entry.header.name, sizeof(entry.header.name)));
+            if(verbose) {
+                fout << "Extracting material: " << name << " (duplicate of " << extractedCopies[i] << ")\n";
             }
+            if(progress) {
+                progress->onItem(name, entry.pixelDataSize);
+            }
+            references << name << '\t' << extractedCopies[i] << '\n';
         }
 
-        if(verbose) {
-            std::cout << "  =============== Material Info End =================\n\n\n";
+        const std::string refFile = matDir + "/references.txt";
+        RemoveFile(refFile); // OutputFileStream doesn't truncate existing file
+        if(nDuplicates > 0)
+        {
+            try
+            {
+                const auto data = references.str();
+                OutputFileStream ofs(refFile);
+                ofs.setSyncOnClose(sync);
+                ofs.write(reinterpret_cast<const byte_t*>(data.data()), data.size());
+            }
+            catch(const std::exception& e)
+            {
+                ferr << "Error: Failed to write material references file: " << e.what() << "!\n";
+                return false;
+            }
         }
     }
 
-    std::cout << (!verbose ? "\n" : "") << "-----------------------------------------\nTotal materials extracted: " << materials.size() << std::endl << std::endl;
+    fout << "-----------------------------------------\nTotal materials extracted: " << nMaterials - nDuplicates << '\n';
+    if(cache) {
+        fout << "Materials copied from cache: " << nCached << '\n';
+    }
+    if(dedup) {
+        fout << "Duplicate materials referenced: " << nDuplicates << '\n';
+    }
+    fout << std::endl;
     return true;
 }
+
+bool HashMaterials(const std::string& cndFile, std::size_t jobs, HashReport& report, std::size_t slot, libim::ProgressListener* progress, std::ostream& out, std::ostream& err)
+{
+    try
+    {
+        libim::CND::CndMaterialIndex index(OpenInputStream(cndFile));
+        const auto hashes = libim::CND::HashMaterials(index, jobs, progress);
+
+        std::vector<HashReport::Entry> entries;
+        entries.reserve(index.size());
+        out << "Materials of " << cndFile << ": " << index.size() << '\n';
+        for(std::size_t i = 0; i < index.size(); i++)
+        {
+            const auto& entry = index.at(i);
+            std::string name(entry.header.name, strnlen(entry.header.name, sizeof(entry.header.name)));
+            out << "  " << libim::HashToHex(hashes[i]) << "  " << SETW(10, ' ') << entry.pixelDataSize << "  " << name << '\n';
+            entries.push_back({ std::move(name), hashes[i], entry.pixelDataSize });
+        }
+        out << std::endl;
+
+        report.set(slot, std::move(entries));
+        return true;
+    }
+    catch(const std::exception& e)
+    {
+        err << "Error: Failed to hash materials: " << e.what() << "!\n";
+        return false;
+    }
+}
+
+void HashReport::print(std::ostream& out) const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    /* Group copies by hash in order of the first copy */
+    struct Group
+    {
+        std::size_t size = 0;
+        std::vector<std::string> copies;
+    };
+
+    std::vector<uint64_t> order;
+    std::unordered_map<uint64_t, Group> groups;
+    std::size_t nMaterials = 0;
+    for(const auto& file : m_files)
+    {
+        for(const auto& entry : file.entries)
+        {
+            auto& group = groups[entry.hash];
+            if(group.copies.empty())
+            {
+                order.push_back(entry.hash);
+                group.size = entry.size;
+            }
+            group.copies.push_back(file.path + ":" + entry.name);
+            nMaterials++;
+        }
+    }
+
+    std::size_t nDuplicates = 0;
+    std::size_t nDuplicatedSize = 0;
+    out << "=========================================\nDuplicated materials:\n";
+    for(const auto hash : order)
+    {
+        const auto& group = groups.at(hash);
+        if(group.copies.size() < 2) {
+            continue;
+        }
+
+        out << "  " << libim::HashToHex(hash) << "  " << SETW(10, ' ') << group.size << "  copies: " << group.copies.size() << '\n';
+        for(const auto& copy : group.copies) {
+            out << "    " << copy << '\n';
+        }
+
+        nDuplicates     += group.copies.size() - 1;
+        nDuplicatedSize += (group.copies.size() - 1) * group.size;
+    }
+
+    out << "-----------------------------------------\n"
+        << "Total materials: "  << nMaterials << " in " << m_files.size() << " file(s)\n"
+        << "Unique materials: " << order.size() << '\n'
+        << "Duplicate copies: " << nDuplicates << " (" << nDuplicatedSize << " bytes of pixel data)" << std::endl;
+}
+bool ListSections(const std::string& cndFile, bool dump, std::string outDir, bool sync, std::ostream& out, std::ostream& err)
+{
+    try
+    {
+        auto istream = OpenInputStream(cndFile);
+        libim::CND::CndSectionReader reader(*istream);
+
+        std::string sectionDir;
+        if(dump)
+        {
+            outDir += (outDir.empty() ? "" : "/" ) + GetBaseName(cndFile);
+            sectionDir = outDir + "/" + "sections";
+            MakePath(sectionDir);
+        }
+
+        /* Sections are read in file order so data of each section is copied straight from the file */
+        ByteArray buffer;
+        libim::CND::CndSection section;
+        for(std::size_t idx = 0; reader.next(section); idx++)
+        {
+            const std::string name = libim::CND::GetCndSectionName(section.type);
+            out << "Section: " << std::left << std::setfill(' ') << std::setw(12) << name
+                      << "offset: " << std::setw(12) << section.offset
+                      << "size: "   << std::setw(12) << section.size
+                      << "count: "  << section.count << std::endl;
+
+            if(dump && section.size > 0)
+            {
+                const std::string fileName = sectionDir + "/" + std::to_string(idx) + "_" + name + ".bin";
+                RemoveFile(fileName); // OutputFileStream doesn't truncate existing file
+
+                OutputFileStream ofs(fileName);
+                ofs.setSyncOnClose(sync);
+                ofs.write(*istream, section.offset, section.size, buffer);
+            }
+        }
+
+        return true;
+    }
+    catch(const std::exception& e)
+    {
+        err << "Error: Failed to read CND file sections: " << e.what() << "!\n";
+        return false;
+    }
+}
+
+/* Adds jobs of JSON job file to batch. Job objects are:
+     { "op": "extract",  "input": <files>, "output": <dir>, "bmp": <bool>, "bmp32": <bool>, "verbose": <bool>, "cache": <dir>, "dedup": <bool> }
+     { "op": "hash",     "input": <files> }
+     { "op": "patch",    "input": <files>, "materials": <mat files>, "gen_mipmaps": <N>, "in_place": <bool> }
+     { "op": "sections", "input": <files>, "output": <dir>, "dump": <bool> }
+   <files> is a file path, glob or @list file, or array of them. Every job accepts "sync": <bool>.
+   Unset members default to command line options, mipmaps are generated only when "gen_mipmaps" is set (0 = full chain). */
+bool AddBatchJobs(Batch& batch, const std::string& jobsFile, const std::string& outDir, bool verbose, std::size_t asyncDepth, bool sync, const std::string& cacheDir, bool dedup, MaterialDedup& registry, HashReport& report, libim::ProgressListener* progress)
+{
+    try
+    {
+        for(const auto& job : LoadBatchJobs(jobsFile))
+        {
+            const auto op = job.getString("op", "extract");
+            std::vector<std::string> inputs;
+            if(!ExpandInputs(job.getStrings("input"), inputs)) {
+                return false;
+            }
+
+            if(inputs.empty())
+            {
+                std::cerr << "Error: Job \"" << op << "\" in job file has no input file!\n";
+                return false;
+            }
+
+            const bool bSync = job.getBool("sync", sync);
+            if(op == "extract")
+            {
+                const auto output   = job.getString("output", outDir);
+                const bool bBmp32   = job.getBool("bmp32", false);
+                const bool bBmp     = job.getBool("bmp", false) || bBmp32;
+                const bool bVerbose = job.getBool("verbose", verbose);
+                const auto cache    = job.getString("cache", cacheDir);
+                MaterialDedup* pDedup = job.getBool("dedup", dedup) ? &registry : nullptr;
+                for(const auto& file : inputs)
+                {
+                    batch.add(file, [=](std::ostream& out, std::ostream& err) {
+                        return RecoverCnd(file, out, err) &&
+                            ExtractMaterials(file, output, bBmp, bBmp32, bVerbose, 1, bSync, cache, pDedup, progress, out, err);
+                    });
+                }
+            }
+            else if(op == "hash")
+            {
+                HashReport* pReport = &report;
+                for(const auto& file : inputs)
+                {
+                    const std::size_t slot = report.add(file);
+                    batch.add(file, [=](std::ostream& out, std::ostream& err) {
+                        return RecoverCnd(file, out, err) &&
+                            HashMaterials(file, 1, *pReport, slot, progress, out, err);
+                    });
+                }
+            }
+            else if(op == "patch")
+            {
+                std::vector<std::string> matFiles;
+                if(!ExpandInputs(job.getStrings("materials"), matFiles)) {
+                    return false;
+                }
+
+                if(matFiles.empty())
+                {
+                    std::cerr << "Error: Job \"patch\" in job file has no material files!\n";
+                    return false;
+                }
+
+                const auto genMipmaps  = job.find("gen_mipmaps");
+                const uint32_t nLevels = genMipmaps ? static_cast<uint32_t>(genMipmaps->asNumber()) : 0;
+                const bool bInPlace    = job.getBool("in_place", false);
+                for(const auto& file : inputs)
+                {
+                    batch.add(file, [=](std::ostream& out, std::ostream& err) {
+                        return RecoverCnd(file, out, err) &&
+                            ReplaceMaterial(file, matFiles, genMipmaps != nullptr, nLevels, asyncDepth, bInPlace, 1, out, err);
+                    });
+                }
+            }
+            else if(op == "sections")
+            {
+                const auto output = job.getString("output", outDir);
+                const bool bDump  = job.getBool("dump", false);
+                for(const auto& file : inputs)
+                {
+                    batch.add(file, [=](std::ostream& out, std::ostream& err) {
+                        return RecoverCnd(file, out, err) &&
+                            ListSections(file, bDump, output, bSync, out, err);
+                    });
+                }
+            }
+            else
+            {
+                std::cerr << "Error: Unknown job \"" << op << "\" in job file!\n";
+                return false;
+            }
+        }
+
+        return true;
+    }
+    catch(const JsonError& e)
+    {
+        std::cerr << "Error: Invalid job file: " << e.what() << "!\n";
+        return false;
+    }
+}
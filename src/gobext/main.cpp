@@ -1,43 +1,87 @@
+#include <algorithm>
+#include <atomic>
 #include <fstream>
 #include <iomanip>
 #include <iostream>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <unordered_set>
 
 #include "libim/gob.h"
 #include "libim/common.h"
+#include "libim/io/asyncio.h"
+#include "libim/io/compressedstream.h"
 #include "libim/io/filestream.h"
+#include "libim/utils/progress.h"
+#include "libim/utils/threadpool.h"
+#include "cmdutils/asynclog.h"
+#include "cmdutils/batch.h"
 #include "cmdutils/options.h"
+#include "cmdutils/orderedoutput.h"
+#include "cmdutils/progress.h"
+#include "cmdutils/stats.h"
 
 #define SETW(n, f)  std::right << std::setfill(f) << std::setw(n)
 #define SET_FINFO_LW(n) SETW(10 + n, '.')
 
 static constexpr auto OPT_OTPUT_DIR       ("--output-dir");
 static constexpr auto OPT_OTPUT_DIR_SHORT ("-o");
+static constexpr auto OPT_ADD             ("--add");
+static constexpr auto OPT_ADD_SHORT       ("-a");
+static constexpr auto OPT_ASYNC           ("--async");
+static constexpr auto OPT_BASE_DIR        ("--base-dir");
+static constexpr auto OPT_CODEC           ("--codec");
+static constexpr auto OPT_JOBS            ("--jobs");
+static constexpr auto OPT_JOBS_SHORT      ("-j");
+static constexpr auto OPT_JOBS_FILE       ("--jobs-file");
+static constexpr auto OPT_LEVEL           ("--level");
+static constexpr auto OPT_MAX_MEMORY      ("--max-memory");
+static constexpr auto OPT_NEW             ("--new");
+static constexpr auto OPT_NO_SYNC         ("--no-sync");
+static constexpr auto OPT_PACK            ("--pack");
+static constexpr auto OPT_REMOVE          ("--remove");
+static constexpr auto OPT_STATS           ("--stats");
 static constexpr auto OPT_VERBOSE         ("--verbose");
 static constexpr auto OPT_VERBOSE_SHORT   ("-v");
 static constexpr auto OPT_HELP            ("--help");
 static constexpr auto OPT_HELP_SHORT      ("-h");
 
 void print_help();
-bool ExtractGob(std::shared_ptr<const GobFileDirectory> gobDir, std::string outDir, const bool verbose);
+bool ExtractGob(const GobArchive& gob, const std::string& gobFile, std::string outDir, const bool verbose, std::size_t jobs, std::size_t asyncDepth, const bool sync, libim::ProgressListener* progress = nullptr, std::ostream& out = std::cout, std::ostream& err = std::cerr);
+bool ExtractGobFile(const std::string& gobFile, std::string outDir, const bool verbose, std::size_t jobs, std::size_t asyncDepth, const bool sync, libim::ProgressListener* progress = nullptr, std::ostream& out = std::cout, std::ostream& err = std::cerr);
+bool UpdateGob(const std::string& gobFile, bool create, const std::string& baseDir, const std::vector<std::string>& addFiles, const std::vector<std::string>& removeEntries, const bool sync, std::ostream& out = std::cout, std::ostream& err = std::cerr);
+bool PackFile(const std::string& inFile, const std::string& outFile, const std::string& codecName, int level, std::size_t jobs, const bool sync, std::ostream& out = std::cout, std::ostream& err = std::cerr);
+bool AddBatchJobs(Batch& batch, const std::string& jobsFile, const std::string& outDir, const bool verbose, std::size_t asyncDepth, const bool sync, libim::ProgressListener* progress);
 
 int main(int argc, const char *argv[])
 {
     Options opt(argc, argv);
+    const bool bJobsFile = opt.hasOpt(OPT_JOBS_FILE);
     if(argc < 2 ||
        opt.hasOpt(OPT_HELP) ||
        opt.hasOpt(OPT_HELP_SHORT) ||
-       opt.unspecified().empty())
+       (opt.unspecified().empty() && !bJobsFile))
     {
         print_help();
         return 1;
     }
 
-    std::string inputFile = opt.unspecified().at(0);
-    if(!FileExists(inputFile)) 
-    {
-        std::cerr << "Error: File \"" << inputFile << "\" does not exists!"; 
+    const bool bCreate = opt.hasOpt(OPT_NEW);
+    std::vector<std::string> inputFiles;
+    if(!ExpandInputs(opt.unspecified(), inputFiles)) {
         return 1;
     }
+
+    for(const auto& inputFile : inputFiles)
+    {
+        if(!bCreate && !FileExists(inputFile))
+        {
+            std::cerr << "Error: File \"" << inputFile << "\" does not exists!"; 
+            return 1;
+        }
+    }
     
     std::string outdir;
     if(opt.hasOpt(OPT_OTPUT_DIR_SHORT)){
@@ -55,22 +99,132 @@ int main(int argc, const char *argv[])
         bVerboseOutput = true;
     }
 
-    /* Extract files from gob file */
-    int result = 0;
-    auto gobDir = LoadGobFromFile(inputFile);
-    if(gobDir)
+    std::size_t nJobs = 1;
+    if(opt.hasOpt(OPT_JOBS_SHORT) || opt.hasOpt(OPT_JOBS))
+    {
+        auto jobs = opt.hasOpt(OPT_JOBS_SHORT) ? opt.arg(OPT_JOBS_SHORT) : opt.arg(OPT_JOBS);
+        nJobs = 0; // 0 = use all hardware threads
+        if(!jobs.empty() && !ParseUnsigned(jobs, nJobs))
+        {
+            std::cerr << "Error: Invalid number of jobs \"" << jobs << "\"!\n";
+            return 1;
+        }
+    }
+
+    std::size_t nAsyncDepth = 0; // 0 = no async I/O
+    if(opt.hasOpt(OPT_ASYNC))
+    {
+        auto depth  = opt.arg(OPT_ASYNC);
+        nAsyncDepth = AsyncIO::DEFAULT_QUEUE_DEPTH;
+        if(!depth.empty() && (!ParseUnsigned(depth, nAsyncDepth) || nAsyncDepth == 0))
+        {
+            std::cerr << "Error: Invalid async I/O queue depth \"" << depth << "\"!\n";
+            return 1;
+        }
+    }
+
+    const bool bSync = !opt.hasOpt(OPT_NO_SYNC);
+
+    /* Many input files or job file are processed in batch mode. Files are processed in parallel
+       on one pool of -j workers, each file by a single worker. */
+    const bool bBatch = bJobsFile || inputFiles.size() > 1;
+    const std::size_t nFileJobs = bBatch ? 1 : nJobs;
+
+    std::size_t nMaxMemoryMB = BATCH_DEFAULT_MEMORY_MB;
+    if(opt.hasOpt(OPT_MAX_MEMORY) && !ParseUnsigned(opt.arg(OPT_MAX_MEMORY), nMaxMemoryMB)) // 0 = unlimited
     {
-        outdir += (outdir.empty() ? "" : "/") + GetBaseName(inputFile) + "_GOB";
-        MakePath(outdir);
+        std::cerr << "Error: Invalid memory limit \"" << opt.arg(OPT_MAX_MEMORY) << "\"!\n";
+        return 1;
+    }
+
+    /* Console output is written by background thread, extraction progress is shown on one status line */
+    const bool bExtract = !bCreate && !opt.hasOpt(OPT_ADD) && !opt.hasOpt(OPT_ADD_SHORT) && !opt.hasOpt(OPT_REMOVE) && !opt.hasOpt(OPT_PACK);
+    AsyncLog log(std::cout);
+    libim::ProgressMeter meter;
+    libim::ProgressListener* progress = &meter;
+    std::unique_ptr<ProgressPrinter> progressPrinter;
+    if(bExtract || bJobsFile) {
+        progressPrinter.reset(new ProgressPrinter(meter, "files"));
+    }
 
-        if(!ExtractGob(gobDir, outdir, bVerboseOutput)) {
+    int result = 0;
+    Batch batch;
+    const auto addOp = [&](const std::string& file, BatchOp op) {
+        if(bBatch) {
+            batch.add(file, std::move(op));
+        }
+        else if(!op(log.stream(), std::cerr)) {
             result = 1;
         }
+    };
+
+    /* Add, replace or remove files */
+    if(bCreate || opt.hasOpt(OPT_ADD) || opt.hasOpt(OPT_ADD_SHORT) || opt.hasOpt(OPT_REMOVE))
+    {
+        auto addFiles  = opt.args(OPT_ADD);
+        auto addFiles2 = opt.args(OPT_ADD_SHORT);
+        addFiles.insert(addFiles.end(),
+                    std::make_move_iterator(addFiles2.begin()),
+                    std::make_move_iterator(addFiles2.end()));
+
+        const auto baseDir       = opt.arg(OPT_BASE_DIR);
+        const auto removeEntries = opt.args(OPT_REMOVE);
+        for(const auto& inputFile : inputFiles)
+        {
+            addOp(inputFile, [=](std::ostream& out, std::ostream& err) {
+                return UpdateGob(inputFile, bCreate, baseDir, addFiles, removeEntries, bSync, out, err);
+            });
+        }
+    }
+    /* Pack file into compressed container, files packed from many input files are written to --pack dir */
+    else if(opt.hasOpt(OPT_PACK))
+    {
+        std::size_t level = 0; // 0 = codec default level
+        if(opt.hasOpt(OPT_LEVEL) && (!ParseUnsigned(opt.arg(OPT_LEVEL), level) || level > std::size_t(std::numeric_limits<int>::max())))
+        {
+            std::cerr << "Error: Invalid compression level \"" << opt.arg(OPT_LEVEL) << "\"!\n";
+            return 1;
+        }
+
+        const auto packFile = opt.arg(OPT_PACK);
+        const auto codec    = opt.arg(OPT_CODEC);
+        for(const auto& inputFile : inputFiles)
+        {
+            const auto outFile = inputFiles.size() > 1 ? packFile + "/" + GetFileName(inputFile) : packFile;
+            addOp(inputFile, [=](std::ostream& out, std::ostream& err) {
+                return PackFile(inputFile, outFile, codec, int(level), nFileJobs, bSync, out, err);
+            });
+        }
     }
+    /* Extract files from gob file */
     else
     {
-        std::cerr << "Error reading GOB file!\n";
-        result =  1;
+        for(const auto& inputFile : inputFiles)
+        {
+            addOp(inputFile, [=](std::ostream& out, std::ostream& err) {
+                return ExtractGobFile(inputFile, outdir, bVerboseOutput, nFileJobs, nAsyncDepth, bSync, progress, out, err);
+            });
+        }
+    }
+
+    if(bJobsFile && !AddBatchJobs(batch, opt.arg(OPT_JOBS_FILE), outdir, bVerboseOutput, nAsyncDepth, bSync, progress)) {
+        result = 1;
+    }
+    else if(bBatch && batch.run(nJobs, nMaxMemoryMB * 1024 * 1024, log.stream(), std::cerr) > 0) {
+        result = 1;
+    }
+
+    if(progressPrinter)
+    {
+        progressPrinter->stop();
+        if(meter.doneItems() > 0) {
+            log.stream() << "Extracted " << FormatThroughput(meter, "files") << std::endl;
+        }
+    }
+    log.flush();
+
+    if(opt.hasOpt(OPT_STATS)) {
+        DumpStats(opt.arg(OPT_STATS));
     }
 
     return result;
@@ -80,81 +234,393 @@ void print_help()
 {
     std::cout << "\nIndiana Jones and The Infernal Machine GOB file extractor\n";
     std::cout << "Extracts resources from CND file!\n";
-    std::cout << "  Usage: gobext <gob file> [options]" << std::endl << std::endl;
+    std::cout << "  Usage: gobext <gob file> [options]" << std::endl;
+    std::cout << "         gobext <gob files, globs or @list file> [options]" << std::endl;
+    std::cout << "         gobext --jobs-file <file> [options]" << std::endl << std::endl;
 
     std::cout << "Option        Long option        Meaning\n";
+    std::cout << OPT_ADD_SHORT         << SETW(17, ' ') << OPT_ADD         << SETW(95, ' ') << "Add or replace <files> in GOB file, entry name is file path relative to base dir\n";
+    std::cout << "  "                  << SETW(19, ' ') << OPT_ASYNC       << SETW(79, ' ') << "Extract with asynchronous I/O, [N] requests in flight (default 32)\n";
+    std::cout << "  "                  << SETW(22, ' ') << OPT_BASE_DIR    << SETW(61, ' ') << "Base dir <dir> of added files (default current dir)\n";
+    std::cout << "  "                  << SETW(19, ' ') << OPT_CODEC       << SETW(107, ' ') << "Compression codec <name>: store, zlib, zstd or lz4 (default zstd, zlib if zstd is unavailable)\n";
     std::cout << OPT_HELP_SHORT        << SETW(18, ' ') << OPT_HELP        << SETW(31, ' ') << "Show this message\n";
+    std::cout << OPT_JOBS_SHORT        << SETW(18, ' ') << OPT_JOBS        << SETW(71, ' ') << "Number of parallel extraction jobs <N>. 0 = all CPU cores\n";
+    std::cout << "  "                  << SETW(23, ' ') << OPT_JOBS_FILE    << SETW(75, ' ') << "Run extract, update and pack jobs of JSON job <file> in batch mode\n";
+    std::cout << "  "                  << SETW(19, ' ') << OPT_LEVEL       << SETW(68, ' ') << "Compression level <N> of packed file. 0 = codec default\n";
+    std::cout << "  "                  << SETW(24, ' ') << OPT_MAX_MEMORY   << SETW(86, ' ') << "Memory budget <MB> of files processed in parallel in batch mode (default 1024)\n";
+    std::cout << "  "                  << SETW(17, ' ') << OPT_NEW         << SETW(64, ' ') << "Create new GOB file, existing file is overwritten\n";
+    std::cout << "  "                  << SETW(21, ' ') << OPT_NO_SYNC     << SETW(55, ' ') << "Don't flush extracted files to disk on close\n";
     std::cout << OPT_OTPUT_DIR_SHORT   << SETW(24, ' ') << OPT_OTPUT_DIR   << SETW(34, ' ') << "Output folder <output dir>\n";
+    std::cout << "  "                  << SETW(18, ' ') << OPT_PACK        << SETW(67, ' ') << "Pack GOB or CND file into compressed container <file>\n";
+    std::cout << "  "                  << SETW(20, ' ') << OPT_REMOVE      << SETW(42, ' ') << "Remove <entries> from GOB file\n";
+    std::cout << "  "                  << SETW(19, ' ') << OPT_STATS       << SETW(55, ' ') << "Dump I/O stats as JSON to stdout or [file]\n";
     std::cout << OPT_VERBOSE_SHORT     << SETW(21, ' ') << OPT_VERBOSE     << SETW(25, ' ') << "Verbose output\n";
 }
 
-bool ExtractGob(std::shared_ptr<const GobFileDirectory> gobDir, std::string outDir, const bool verbose)
+/* Prints entry line and info only in verbose mode, extraction progress is shown by ProgressPrinter */
+void PrintEntryInfo(const GobFileEntry& entry, const bool verbose, std::size_t nWritten, std::ostream& out, std::ostream& err)
+{
+    if(verbose)
+    {
+        std::string strSize = std::to_string(entry.size);
+        out << "Extracting file: " << entry.name << '\n';
+        out << "  offset in gob:"  << SET_FINFO_LW((14 - (strSize.size() + 6)) + 11) << std::hex << std::showbase << entry.offset << '\n';
+        out << "  file size:"      << SET_FINFO_LW(14) << std::dec << strSize<< " bytes\n";
+        out << "  bytes written to disk:" << SET_FINFO_LW(2) << std::dec << nWritten << " bytes\n\n";
+    }
+
+    if(nWritten < entry.size) {
+        err << "  Warning: not all bytes were written to disk!\n\n";
+    } else if(nWritten > entry.size) {
+        err << "  Warning: too many bytes were written to disk!\n\n";
+    }
+}
+
+void ExtractEntry(const GobArchive& gob, const GobFileEntry& entry, const std::string& outPath, const bool verbose, const bool sync, libim::ProgressListener* progress, std::ostream& out, std::ostream& err)
+{
+    /* Open output file stream */
+    OutputFileStream ofs(outPath);
+    ofs.setSyncOnClose(sync);
+
+    /* Write entry to file straight from the mapped GOB file, entries of compressed GOB file are decompressed */
+    std::size_t nWritten = 0;
+    if(entry.size > 0)
+    {
+        if(auto data = gob.entryData(entry)) {
+            nWritten = ofs.write(data, entry.size);
+        }
+        else
+        {
+            auto istream = gob.openEntry(entry);
+            ofs.write(*istream);
+            nWritten = ofs.tell();
+        }
+    }
+
+    PrintEntryInfo(entry, verbose, nWritten, out, err);
+    if(progress) {
+        progress->onItem(GetGobEntryName(entry), nWritten);
+    }
+}
+
+/* Extracts entries with async I/O. Entry data is read from GOB file ahead into chunk buffers,
+   while previously read chunks are written to output files. */
+void ExtractEntriesAsync(const GobArchive& gob, const std::string& gobFile, const std::vector<std::string>& outPaths, const bool verbose, std::size_t queueDepth, const bool sync, libim::ProgressListener* progress, std::ostream& fout, std::ostream& ferr)
+{
+    AsyncIO aio(queueDepth);
+    if(verbose) {
+        fout << "Async I/O backend: " << AsyncIO::GetBackendName(aio.backend()) << '\n';
+    }
+
+    AsyncFile src(gobFile, FileStream::Read);
+    OrderedOutput output(gob.entries().size(), fout, ferr);
+    AsyncCopyPipeline pipeline(aio);
+
+    for(std::size_t i = 0; i < gob.entries().size(); i++)
+    {
+        const auto& entry = gob.entries().at(i);
+        auto dst = std::make_shared<AsyncFile>(outPaths.at(i), FileStream::Write);
+        dst->setSyncOnClose(sync);
+
+        /* Output file is closed when its data has been written */
+        pipeline.copy(src, entry.offset, *dst, 0, entry.size, [&, i, dst]() mutable {
+            dst.reset();
+
+            std::ostringstream out;
+            std::ostringstream err;
+            PrintEntryInfo(gob.entries().at(i), verbose, gob.entries().at(i).size, out, err);
+            output.commit(i, out.str(), err.str());
+            if(progress) {
+                progress->onItem(GetGobEntryName(gob.entries().at(i)), gob.entries().at(i).size);
+            }
+        });
+    }
+
+    pipeline.finish();
+}
+
+bool ExtractGob(const GobArchive& gob, const std::string& gobFile, std::string outDir, const bool verbose, std::size_t jobs, std::size_t asyncDepth, const bool sync, libim::ProgressListener* progress, std::ostream& fout, std::ostream& ferr)
 {
     try
     {
+        /* Make output directories once up front */
+        std::vector<std::string> outPaths;
+        outPaths.reserve(gob.entries().size());
+
+        std::unordered_set<std::string> dirs;
+        for(const auto& entry : gob.entries())
+        {
+            outPaths.push_back(outDir + '/' + GetGobEntryName(entry));
+            const auto& outPath = outPaths.back();
+
+            auto dir = outPath.substr(0, outPath.find_last_of("/\\"));
+            if(dirs.insert(std::move(dir)).second && !MakePath(outPath))
+            {
+                ferr << "Error: could not make file path: " << outPath << "!\n";
+                return false;
+            }
+        }
+
+        /* Async I/O copies raw file ranges, so it can't be used for compressed GOB file */
+        if(asyncDepth > 0 && gob.isCompressed())
+        {
+            ferr << "Warning: async I/O is not supported for compressed GOB file, extracting without it\n";
+            asyncDepth = 0;
+        }
+
+        if(progress)
+        {
+            std::size_t nBytes = 0;
+            for(const auto& entry : gob.entries()) {
+                nBytes += entry.size;
+            }
+            progress->onBegin(gob.entries().size(), nBytes);
+        }
+
         /* Save entries to files */
-        for(const auto& entry : gobDir->entries)
+        if(asyncDepth > 0) {
+            ExtractEntriesAsync(gob, gobFile, outPaths, verbose, asyncDepth, sync, progress, fout, ferr);
+        }
+        else if(jobs == 1)
         {
-            std::cout << "Extracting file: " << entry.name << std::endl;
-            if(verbose)
+            for(std::size_t i = 0; i < gob.entries().size(); i++) {
+                ExtractEntry(gob, gob.entries().at(i), outPaths.at(i), verbose, sync, progress, fout, ferr);
+            }
+        }
+        else
+        {
+            /* Entries are read from the shared read-only mapping, so no file cursor is shared between workers */
+            libim::ThreadPool pool(jobs);
+            std::mutex mtxOut;
+
+            for(std::size_t i = 0; i < gob.entries().size(); i++)
             {
-                std::string strSize = std::to_string(entry.size);
-                std::cout << "  offset in gob:"  << SET_FINFO_LW((14 - (strSize.size() + 6)) + 11) << std::hex << std::showbase << entry.offset << std::endl;
-                std::cout << "  file size:"      << SET_FINFO_LW(14) << std::dec << strSize<< " bytes\n";
+                pool.submit([&, i]{
+                    std::ostringstream out;
+                    std::ostringstream err;
+                    ExtractEntry(gob, gob.entries().at(i), outPaths.at(i), verbose, sync, progress, out, err);
+
+                    std::lock_guard<std::mutex> lock(mtxOut);
+                    fout << out.str();
+                    ferr << err.str();
+                });
             }
 
-            /* Seek to entry offset */
-            gobDir->stream->seek(entry.offset);
+            pool.wait();
+        }
+
+        fout << "--------------------------\nTotal files extracted: " << gob.entries().size() << "\n\n";
+        return true;
+    }
+    catch (const std::exception& e)
+    {
+        ferr << "An exception was thrown while extracting GOB dir: " << e.what() << std::endl;
+        return false;
+    }
+}
+
+bool ExtractGobFile(const std::string& gobFile, std::string outDir, const bool verbose, std::size_t jobs, std::size_t asyncDepth, const bool sync, libim::ProgressListener* progress, std::ostream& out, std::ostream& err)
+{
+    try
+    {
+        GobArchive gob(gobFile);
+
+        outDir += (outDir.empty() ? "" : "/") + GetBaseName(gobFile) + "_GOB";
+        MakePath(outDir);
+        return ExtractGob(gob, gobFile, outDir, verbose, jobs, asyncDepth, sync, progress, out, err);
+    }
+    catch (const std::exception& e)
+    {
+        err << "Error reading GOB file: " << e.what() << std::endl;
+        return false;
+    }
+}
 
-            /* Set entry file path */
-            auto outPath = outDir + '/' + entry.name;
-            if(!MakePath(outPath))
+bool UpdateGob(const std::string& gobFile, bool create, const std::string& baseDir, const std::vector<std::string>& addFiles, const std::vector<std::string>& removeEntries, const bool sync, std::ostream& out, std::ostream& err)
+{
+    try
+    {
+        GobWriter gob(gobFile, create ? GobWriter::Mode::Create : GobWriter::Mode::Update, sync);
+        for(const auto& entryName : removeEntries)
+        {
+            if(!gob.removeEntry(entryName))
             {
-                std::cerr << "Error: could not make file path: " << outPath << "!\n";
-                return 1;
+                err << "Error: Entry \"" << entryName << "\" not found in GOB file!\n";
+                return false;
+            }
+            out << "Removed file: " << entryName << std::endl;
+        }
+
+        for(const auto& file : addFiles)
+        {
+            /* Entry name is file path relative to base dir with '\\' as path separator */
+            std::string entryName = file;
+            std::replace(entryName.begin(), entryName.end(), '/', '\\');
+            while(entryName.compare(0, 2, ".\\") == 0) {
+                entryName.erase(0, 2);
             }
 
-            /* Open output file stream */
-            OutputFileStream ofs(outPath);
+            const bool bReplaced = gob.findEntry(entryName) != nullptr;
+            gob.addFile(entryName, baseDir.empty() ? file : baseDir + "/" + file);
+            out << (bReplaced ? "Replaced file: " : "Added file: ") << entryName << std::endl;
+        }
+
+        gob.commit(sync);
+        out << "\n-----------------------------------------\nTotal files in GOB: " << gob.entries().size()
+                  << "\nUnused bytes: " << gob.unusedSize() << std::endl << std::endl;
+        return true;
+    }
+    catch(const std::exception& e)
+    {
+        err << "Error writing GOB file: " << e.what() << std::endl;
+        return false;
+    }
+}
+
+bool PackFile(const std::string& inFile, const std::string& outFile, const std::string& codecName, int level, std::size_t jobs, const bool sync, std::ostream& out, std::ostream& err)
+{
+    CompressionCodec codec = IsCodecSupported(CompressionCodec::Zstd) ? CompressionCodec::Zstd : CompressionCodec::Zlib;
+    if(!codecName.empty() && !GetCodecByName(codecName, codec))
+    {
+        err << "Error: Unknown codec \"" << codecName << "\"!\n";
+        return false;
+    }
 
-            /* Write entry to file */
-            ByteArray buffer(4096);
-            std::size_t offEntryEnd = entry.offset + entry.size;
-            std::size_t nWritten = 0;
+    if(!IsCodecSupported(codec))
+    {
+        err << "Error: Codec \"" << GetCodecName(codec) << "\" is not supported by this build!\n";
+        return false;
+    }
 
-            while(gobDir->stream->tell() < offEntryEnd && !gobDir->stream->eos())
+    if(!IsCodecLevelValid(codec, level))
+    {
+        int minLevel = 0, maxLevel = 0;
+        err << "Error: Invalid compression level " << level << " for codec \"" << GetCodecName(codec) << "\"";
+        if(GetCodecLevelRange(codec, minLevel, maxLevel)) {
+            err << ", use 0 (default) or " << minLevel << " - " << maxLevel;
+        }
+        else {
+            err << ", codec has no compression levels";
+        }
+        err << "!\n";
+        return false;
+    }
+
+    try
+    {
+        /* Already packed file is repacked */
+        auto istream = OpenInputStream(inFile);
+
+        /* OutputFileStream doesn't truncate existing file */
+        MakePath(outFile);
+        if(FileExists(outFile) && !RemoveFile(outFile))
+        {
+            err << "Error: could not overwrite file: " << outFile << "!\n";
+            return false;
+        }
+
+        std::size_t nPacked = 0;
+        {
+            OutputFileStream ofs(outFile);
+            ofs.setSyncOnClose(sync);
+            nPacked = CompressStream(*istream, 0, istream->size(), ofs, codec, CompressedStream::DEFAULT_CHUNK_SIZE, level, jobs);
+        }
+
+        out << "Packed " << inFile << " with " << GetCodecName(codec) << " codec: "
+                  << istream->size() << " -> " << nPacked << " bytes";
+        if(istream->size() > 0) {
+            out << " (" << std::fixed << std::setprecision(1) << 100.0 * double(nPacked) / double(istream->size()) << "%)";
+        }
+        out << std::endl;
+        return true;
+    }
+    catch(const std::exception& e)
+    {
+        err << "Error packing file: " << e.what() << std::endl;
+        return false;
+    }
+}
+
+/* Adds jobs of JSON job file to batch. Job objects are:
+     { "op": "extract", "input": <files>, "output": <dir>, "verbose": <bool> }
+     { "op": "update",  "input": <files>, "add": <files>, "remove": <entries>, "base_dir": <dir>, "new": <bool> }
+     { "op": "pack",    "input": <files>, "output": <file or dir>, "codec": <name>, "level": <N> }
+   <files> is a file path, glob or @list file, or array of them. Every job accepts "sync": <bool>.
+   Unset members default to command line options. Packed files of job with many input files are written to output dir. */
+bool AddBatchJobs(Batch& batch, const std::string& jobsFile, const std::string& outDir, const bool verbose, std::size_t asyncDepth, const bool sync, libim::ProgressListener* progress)
+{
+    try
+    {
+        for(const auto& job : LoadBatchJobs(jobsFile))
+        {
+            const auto op = job.getString("op", "extract");
+            std::vector<std::string> inputs;
+            if(!ExpandInputs(job.getStrings("input"), inputs)) {
+                return false;
+            }
+
+            if(inputs.empty())
             {
-                if(gobDir->stream->tell() + buffer.size() >= offEntryEnd) {
-                    buffer.resize(offEntryEnd - gobDir->stream->tell());
-                }
+                std::cerr << "Error: Job \"" << op << "\" in job file has no input file!\n";
+                return false;
+            }
 
-                if(gobDir->stream->read(reinterpret_cast<byte_t*>(buffer.data()), buffer.size()) != buffer.size())
+            const bool bSync = job.getBool("sync", sync);
+            if(op == "extract")
+            {
+                const auto output   = job.getString("output", outDir);
+                const bool bVerbose = job.getBool("verbose", verbose);
+                for(const auto& file : inputs)
                 {
-                    std::cerr << "Error reading GOB entry into buffer!\n";
-                    return false;
+                    batch.add(file, [=](std::ostream& out, std::ostream& err) {
+                        return ExtractGobFile(file, output, bVerbose, 1, asyncDepth, bSync, progress, out, err);
+                    });
                 }
-
-                ofs.write(buffer);
-                nWritten += buffer.size();
             }
-
-            if(verbose) {
-                std::cout << "  bytes written to disk:" << SET_FINFO_LW(2) << std::dec << nWritten << " bytes\n\n";
+            else if(op == "update")
+            {
+                const bool bCreate  = job.getBool("new", false);
+                const auto baseDir  = job.getString("base_dir");
+                const auto addFiles = job.getStrings("add");
+                const auto removeEntries = job.getStrings("remove");
+                for(const auto& file : inputs)
+                {
+                    batch.add(file, [=](std::ostream& out, std::ostream& err) {
+                        return UpdateGob(file, bCreate, baseDir, addFiles, removeEntries, bSync, out, err);
+                    });
+                }
             }
+            else if(op == "pack")
+            {
+                const auto output = job.getString("output");
+                if(output.empty())
+                {
+                    std::cerr << "Error: Job \"pack\" in job file has no output file!\n";
+                    return false;
+                }
 
-            if(nWritten < entry.size) {
-                std::cerr << "  Warning: not all bytes were written to disk!\n\n";
-            } else if(nWritten > entry.size) {
-                std::cerr << "  Warning: too many bytes were written to disk!\n\n";
+                const auto codec = job.getString("codec");
+                const int level  = static_cast<int>(job.getNumber("level", 0));
+                for(const auto& file : inputs)
+                {
+                    const auto outFile = inputs.size() > 1 ? output + "/" + GetFileName(file) : output;
+                    batch.add(file, [=](std::ostream& out, std::ostream& err) {
+                        return PackFile(file, outFile, codec, level, 1, bSync, out, err);
+                    });
+                }
+            }
+            else
+            {
+                std::cerr << "Error: Unknown job \"" << op << "\" in job file!\n";
+                return false;
             }
         }
 
-        std::cout << (!verbose ? "\n" : "") << "--------------------------\nTotal files extracted: " << gobDir->entries.size() << std::endl << std::endl;
         return true;
     }
-    catch (const std::exception& e)
+    catch(const JsonError& e)
     {
-        std::cerr << "An exception was thrown while extracting GOB dir: " << e.what() << std::endl;
+        std::cerr << "Error: Invalid job file: " << e.what() << "!\n";
         return false;
     }
 }
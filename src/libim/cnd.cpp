@@ -1,6 +1,26 @@
 #include "cnd.h"
+#include "io/asyncio.h"
+#include "utils/hash.h"
+#include "utils/threadpool.h"
+#include "utils/stats.h"
+#include <algorithm>
 #include <array>
-#include<cstdint>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+#include <unordered_map>
+
+#ifndef OS_WINDOWS
+#  include <fcntl.h>
+#  include <unistd.h>
+#endif
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+# define CND_SSE2
+# include <emmintrin.h>
+#endif
 
 using namespace libim::CND;
 
@@ -95,24 +115,87 @@ static constexpr std::array<char, 1216> CopyrightNotice = {
 
 
 
-CndHeader libim::CND::LoadHeader(const InputStream& istream)
+const std::array<char, 1216>& libim::CND::GetCopyrightNotice()
 {
-    CndHeader cndHeader = istream.read<CndHeader>();
+    return CopyrightNotice;
+}
+
+uint32_t libim::CND::GetFileVersion()
+{
+    return FileVersion;
+}
 
+bool libim::CND::HasCopyrightNotice(const char* data)
+{
+    static_assert(CopyrightNotice.size() % 16 == 0, "Copyright notice size is not a multiple of 16");
+#ifdef CND_SSE2
+    /* Differences of all 16 byte blocks are accumulated and tested once at the end, so the loop doesn't branch */
+    __m128i diff = _mm_setzero_si128();
+    for(std::size_t i = 0; i < CopyrightNotice.size(); i += 16)
+    {
+        const __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+        const __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(CopyrightNotice.data() + i));
+        diff = _mm_or_si128(diff, _mm_xor_si128(a, b));
+    }
+    return _mm_movemask_epi8(_mm_cmpeq_epi8(diff, _mm_setzero_si128())) == 0xFFFF;
+#else
+    return memcmp(data, CopyrightNotice.data(), CopyrightNotice.size()) == 0;
+#endif
+}
+
+void libim::CND::VerifyHeader(const CndHeader& header)
+{
     /* Verify file copyright notice  */
-    //if(strncmp(cndHeader.copyright, &CND_COPYRIGHT[0], CND_COPYRIGHT.size() - 1))
-    if(cndHeader.copyright != CopyrightNotice) {
+    if(!HasCopyrightNotice(header.copyright.data())) {
         throw StreamError("Error bad CND file copyright!");
     }
 
     /* Verify file version */
-    if(cndHeader.version != FileVersion) {
-        throw StreamError("Error wrong CND file version: " + std::to_string(cndHeader.version));
+    if(header.version != FileVersion) {
+        throw StreamError("Error wrong CND file version: " + std::to_string(header.version));
     }
+}
 
+CndHeader libim::CND::LoadHeader(const InputStream& istream)
+{
+    LIBIM_STATS_SCOPED_TIMER("CND::LoadHeader");
+    CndHeader cndHeader = istream.read<CndHeader>();
+    VerifyHeader(cndHeader);
     return cndHeader;
 }
 
+uint32_t libim::CND::GetMaterialPixelDataSize(const CndMatHeader& matHeader)
+{
+    if(matHeader.texturesPerMipmap < 1) {
+        return 0;
+    }
+
+    uint32_t size = 0;
+    for(int32_t i = 0; i < matHeader.mipmapCount; i++) {
+        size += GetMipmapPixelDataSize(matHeader.texturesPerMipmap, matHeader.width, matHeader.height, matHeader.colorInfo.bpp);
+    }
+    return size;
+}
+
+/* Makes material from material header and material's pixel data. Texture bitmaps are allocated from arena. */
+static Material MakeMaterial(const CndMatHeader& matHeader, const Bitmap& pixelData, const std::shared_ptr<libim::Arena>& arena)
+{
+    /* Read mipmaps from buffer */
+    std::size_t offset = 0;
+    const bool hasPixelData = matHeader.mipmapCount > 0 && matHeader.texturesPerMipmap > 0;
+    std::vector<Mipmap> mipmaps(hasPixelData ? matHeader.mipmapCount : 0);
+    for(auto&& mipmap : mipmaps) {
+        mipmap = ReadMipmapFromBuffer(pixelData, offset, matHeader.texturesPerMipmap, matHeader.width, matHeader.height, matHeader.colorInfo, arena);
+    }
+
+    /* Init new material */
+    Material mat(matHeader.name);
+    mat.setSize(matHeader.width, matHeader.height);
+    mat.setColorFormat(matHeader.colorInfo);
+    mat.setMipmaps(std::move(mipmaps));
+    return mat;
+}
+
 uint32_t libim::CND::GetMatSectionOffset(const CndHeader& header)
 {
     return sizeof(CndHeader) +
@@ -121,14 +204,112 @@ uint32_t libim::CND::GetMatSectionOffset(const CndHeader& header)
             4;                         // 4 = unknown 4 bytes
 }
 
+const char* libim::CND::GetCndSectionName(CndSectionType type)
+{
+    switch(type)
+    {
+    case CndSectionType::Header:    return "header";
+    case CndSectionType::Sounds:    return "sounds";
+    case CndSectionType::Unknown:   return "unknown";
+    case CndSectionType::Materials: return "materials";
+    case CndSectionType::Unparsed:  return "unparsed";
+    }
+    return "";
+}
+
+CndSectionReader::CndSectionReader(const InputStream& istream) :
+    m_stream(istream)
+{
+    m_stream.seekBegin();
+    m_header = LoadHeader(m_stream);
+}
+
+const CndHeader& CndSectionReader::header() const
+{
+    return m_header;
+}
+
+bool CndSectionReader::next(CndSection& section)
+{
+    const std::size_t fileSize = m_stream.size();
+    section.offset = m_offset;
+    section.count  = 0;
+
+    switch(m_next)
+    {
+    case 0:
+        section.type = CndSectionType::Header;
+        section.size = sizeof(CndHeader);
+        break;
+    case 1:
+        section.type  = CndSectionType::Sounds;
+        section.size  = std::size_t(m_header.worldSoundUnknown) + 48 * std::size_t(m_header.worldSounds); // see GetMatSectionOffset
+        section.count = m_header.worldSounds;
+        break;
+    case 2:
+        section.type = CndSectionType::Unknown;
+        section.size = 4;
+        break;
+    case 3:
+        /* Section begins with the size of materials pixel data, the rest of the section is not read */
+        if(m_header.numMaterials > 0)
+        {
+            if(m_offset + 4 > fileSize) {
+                throw StreamError("CND material section is out of file bounds!");
+            }
+
+            m_stream.seek(m_offset);
+            section.type  = CndSectionType::Materials;
+            section.size  = 4 + std::size_t(m_header.numMaterials) * sizeof(CndMatHeader) + m_stream.read<uint32_t>();
+            section.count = m_header.numMaterials;
+            break;
+        }
+        m_next++;
+        // fall through
+    case 4:
+        section.type = CndSectionType::Unparsed;
+        section.size = fileSize > m_offset ? fileSize - m_offset : 0;
+        if(section.size > 0) {
+            break;
+        }
+        m_next++;
+        // fall through
+    default:
+        return false;
+    }
+
+    if(section.offset + section.size > fileSize) {
+        throw StreamError(std::string("CND ") + GetCndSectionName(section.type) + " section is out of file bounds!");
+    }
+
+    m_offset += section.size;
+    m_next++;
+    return true;
+}
+
 std::vector<Material> libim::CND::LoadMaterials(const InputStream& istream)
 {
+    CndHeader cndHeader;
     try
     {
-        std::vector<Material> materials;
-
         /* Read cnd file header */
-        auto cndHeader = LoadHeader(istream);
+        cndHeader = LoadHeader(istream);
+    }
+    catch(const std::exception& e)
+    {
+        std::cerr << "CND Error: An exception was thrown while loading material from CND file stream: " << e.what() << "!\n";
+        return {};
+    }
+
+    return LoadMaterials(istream, cndHeader);
+}
+
+std::vector<Material> libim::CND::LoadMaterials(const InputStream& istream, const CndHeader& cndHeader)
+{
+    LIBIM_STATS_SCOPED_TIMER("CND::LoadMaterials");
+    try
+    {
+        std::vector<Material> materials;
 
         /* Return if no materials are present in file*/
         if(cndHeader.numMaterials < 1)
@@ -151,10 +332,19 @@ std::vector<Material> libim::CND::LoadMaterials(const InputStream& istream)
         /* Read material header list from file stream */
         auto matHeaders = istream.read<std::vector<CndMatHeader>>(cndHeader.numMaterials);
 
-        /* Read materials pixel data from file stream */
-        Bitmap vecBitmapBuff = istream.read<Bitmap>(nBitmapBuffSize);
+        /* All texture bitmaps of loaded materials are allocated from one arena which lives as long as any of the bitmaps */
+        std::size_t nTextures = 0;
+        for(const auto& matHeader : matHeaders)
+        {
+            if(matHeader.mipmapCount > 0 && matHeader.texturesPerMipmap > 0) {
+                nTextures += std::size_t(matHeader.mipmapCount) * matHeader.texturesPerMipmap;
+            }
+        }
+        auto arena = MakeBitmapArena(std::min<std::size_t>(nBitmapBuffSize, istream.size() - istream.tell()), nTextures);
 
-        /* Extract materials from pixel data buffer */
+        /* Read materials from pixel data in file stream */
+        Bitmap matBuffer;
+        std::size_t nBitmapRead = 0;
         for(auto&& matHeader : matHeaders)
         {
             if(matHeader.mipmapCount < 1 || matHeader.texturesPerMipmap < 1)
@@ -171,22 +361,25 @@ std::vector<Material> libim::CND::LoadMaterials(const InputStream& istream)
                 return materials;
             }
 
-            /* Read mipmaps from buffer */
-            std::vector<Mipmap> mipmaps(matHeader.mipmapCount);
-            for(auto&& mipmap : mipmaps) {
-                mipmap = MoveMipmapFromBuffer(vecBitmapBuff, matHeader.texturesPerMipmap, matHeader.width, matHeader.height, matHeader.colorInfo);
+            /* Read material's pixel data */
+            const std::size_t matSize = GetMaterialPixelDataSize(matHeader);
+            if(nBitmapRead + matSize > nBitmapBuffSize)
+            {
+                std::cerr << "CND Error: Cannot extract material " << matHeader.name << " from buffer. Pixel data out of bounds!\n";
+                materials.clear();
+                return materials;
             }
 
-            /* Init new material */
-            Material mat(matHeader.name);
-            mat.setSize(matHeader.width, matHeader.height);
-            mat.setColorFormat(matHeader.colorInfo);
-            mat.setMipmaps(std::move(mipmaps));
+            matBuffer.resize(matSize);
+            if(istream.read(matBuffer.data(), matSize) != matSize) {
+                throw StreamError("Error reading material pixel data from stream!");
+            }
+            nBitmapRead += matSize;
 
-            materials.emplace_back(std::move(mat));
+            materials.emplace_back(MakeMaterial(matHeader, matBuffer, arena));
         }
 
-        if(!vecBitmapBuff.empty()) {
+        if(nBitmapRead != nBitmapBuffSize) {
             std::cerr << "CND Warning: Not all bitmap data was copied from buffer!\n";
         }
 
@@ -200,14 +393,276 @@ std::vector<Material> libim::CND::LoadMaterials(const InputStream& istream)
 }
 
 
-bool libim::CND::ReplaceMaterial(const Material& mat, const std::string& cndFile)
+/* Range of patched CND file. Range is either copied from input file at srcOffset or written from data. */
+struct PatchRange
+{
+    std::size_t srcOffset;
+    std::size_t size;
+    const byte_t* data;
+};
+
+/* Writes patched file from ranges which follow the file size field at the beginning of file */
+static void WritePatchedFile(const InputFileStream& ifstream, const std::string& outFile, const std::vector<PatchRange>& ranges)
 {
-    if(mat.mipmaps().empty() || mat.mipmaps().at(0).empty()) {
+    /* OutputFileStream doesn't truncate, leftover file of interrupted patch is removed */
+    RemoveFile(outFile);
+    OutputFileStream ofstream(outFile);
+    ofstream.write(uint32_t(0)); // file size
+
+    ByteArray copyBuffer; // reused chunk buffer for stream to stream copy
+    for(const auto& range : ranges)
+    {
+        if(range.data) {
+            ofstream.write(range.data, range.size);
+        }
+        else {
+            ofstream.write(ifstream, range.srcOffset, range.size, copyBuffer);
+        }
+    }
+
+    /* Write new file size to the beginning of the output cnd file*/
+    const std::size_t fileSize = ofstream.tell();
+    ofstream.seekBegin();
+    ofstream.write(static_cast<uint32_t>(fileSize));
+    ofstream.close();
+}
+
+/* Same as WritePatchedFile but ranges are written with async I/O pipeline,
+   so reading of the next copied ranges overlaps with writing of the previous ones */
+static void WritePatchedFileAsync(const std::string& inFile, const std::string& outFile, const std::vector<PatchRange>& ranges, std::size_t queueDepth)
+{
+    AsyncIO aio(queueDepth);
+    AsyncFile ifs(inFile, FileStream::Read);
+    AsyncFile ofs(outFile, FileStream::Write);
+    AsyncCopyPipeline pipeline(aio);
+
+    std::size_t outOffset = sizeof(uint32_t);
+    for(const auto& range : ranges)
+    {
+        if(range.data) {
+            pipeline.write(ofs, outOffset, range.data, range.size);
+        }
+        else {
+            pipeline.copy(ifs, range.srcOffset, ofs, outOffset, range.size);
+        }
+        outOffset += range.size;
+    }
+
+    /* Ranges don't overlap file size field, so it can be written in parallel with them */
+    const uint32_t nFileSize = static_cast<uint32_t>(outOffset);
+    pipeline.write(ofs, 0, reinterpret_cast<const byte_t*>(&nFileSize), sizeof(nFileSize));
+    pipeline.finish();
+}
+
+/* Range of CND file overwritten by in-place patch */
+struct InPlaceRange
+{
+    std::size_t offset;
+    std::size_t size;
+    const byte_t* data;
+};
+
+static constexpr uint32_t kJournalMagic = 0x314A4D49; // "IMJ1"
+
+/* Flushes directory entry of file to disk, so that file rename or removal survives crash */
+static void SyncParentDir(const std::string& file)
+{
+#ifdef OS_WINDOWS
+    (void)file; // NTFS journals metadata updates
+#else
+    const auto pos = file.find_last_of('/');
+    const std::string dir = pos == std::string::npos ? "." : (pos == 0 ? "/" : file.substr(0, pos));
+    const int fd = open(dir.c_str(), O_RDONLY);
+    if(fd != -1)
+    {
+        fsync(fd);
+        close(fd);
+    }
+#endif
+}
+
+template<typename T>
+static void AppendPod(ByteArray& buffer, const T& value)
+{
+    const auto* p = reinterpret_cast<const byte_t*>(&value);
+    buffer.insert(buffer.end(), p, p + sizeof(T));
+}
+
+template<typename T>
+static bool ReadPod(const ByteArray& buffer, std::size_t& pos, T& value)
+{
+    if(buffer.size() - pos < sizeof(T)) {
         return false;
     }
 
+    std::memcpy(&value, buffer.data() + pos, sizeof(T));
+    pos += sizeof(T);
+    return true;
+}
+
+/* Writes undo journal with the current data of ranges in cndFile and makes it durable before the file is modified.
+   Journal layout: magic | file size | range count | (offset, size, data) of every range | XXH64 of all preceding bytes */
+static void WritePatchJournal(const std::string& journalFile, const FileStream& cndFile, const std::vector<InPlaceRange>& ranges)
+{
+    ByteArray journal;
+    AppendPod(journal, kJournalMagic);
+    AppendPod(journal, uint64_t(cndFile.size()));
+    AppendPod(journal, uint32_t(ranges.size()));
+    for(const auto& range : ranges)
+    {
+        AppendPod(journal, uint64_t(range.offset));
+        AppendPod(journal, uint64_t(range.size));
+
+        const std::size_t pos = journal.size();
+        journal.resize(pos + range.size);
+        if(cndFile.readAt(range.offset, journal.data() + pos, range.size) != range.size) {
+            throw StreamError("Error reading CND file data for patch journal!");
+        }
+    }
+    AppendPod(journal, libim::XXH64(journal.data(), journal.size()));
+
+    /* Journal is published with rename, so it's either complete or missing */
+    const std::string tmpFile = journalFile + ".tmp";
+    RemoveFile(tmpFile);
+    {
+        OutputFileStream ofs(tmpFile);
+        ofs.write(journal.data(), journal.size());
+        ofs.flush();
+    }
+
+    if(!RenameFile(tmpFile, journalFile))
+    {
+        RemoveFile(tmpFile);
+        throw FileStreamError("Failed to write CND patch journal: " + journalFile);
+    }
+    SyncParentDir(journalFile);
+}
+
+/* Overwrites ranges of CND file, journal of original data is written first */
+static void PatchFileInPlace(const std::string& cndFile, const std::vector<InPlaceRange>& ranges)
+{
+    const std::string journalFile = GetPatchJournalPath(cndFile);
+    {
+        FileStream fs(cndFile, FileStream::ReadWrite);
+        WritePatchJournal(journalFile, fs, ranges);
+
+        for(const auto& range : ranges)
+        {
+            fs.seek(range.offset);
+            if(fs.write(range.data, range.size) != range.size) {
+                throw FileStreamError("Failed to write patched data to CND file!");
+            }
+        }
+        fs.flush();
+    }
+
+    /* Patch is complete once the journal is gone */
+    RemoveFile(journalFile);
+    SyncParentDir(journalFile);
+}
+
+std::string libim::CND::GetPatchJournalPath(const std::string& cndFile)
+{
+    return cndFile + ".journal";
+}
+
+bool libim::CND::RecoverInPlacePatch(const std::string& cndFile)
+{
+    const std::string journalFile = GetPatchJournalPath(cndFile);
+    if(!FileExists(journalFile)) {
+        return false;
+    }
+
+    ByteArray journal;
+    {
+        InputFileStream ifs(journalFile);
+        if(ifs.size() > 0) {
+            journal = ifs.read(ifs.size());
+        }
+    }
+
+    /* Verify journal is complete */
+    std::size_t pos = 0;
+    uint32_t magic = 0, nRanges = 0;
+    uint64_t fileSize = 0, checksum = 0;
+    bool bValid = journal.size() >= sizeof(uint64_t) &&
+                  ReadPod(journal, pos, magic) && magic == kJournalMagic &&
+                  ReadPod(journal, pos, fileSize) && ReadPod(journal, pos, nRanges);
+
+    std::vector<InPlaceRange> ranges;
+    for(uint32_t i = 0; bValid && i < nRanges; i++)
+    {
+        uint64_t offset = 0, size = 0;
+        bValid = ReadPod(journal, pos, offset) && ReadPod(journal, pos, size) &&
+                 size <= journal.size() - pos && offset + size <= fileSize;
+        if(bValid)
+        {
+            ranges.push_back({ std::size_t(offset), std::size_t(size), journal.data() + pos });
+            pos += std::size_t(size);
+        }
+    }
+
+    bValid = bValid && ReadPod(journal, pos, checksum) && pos == journal.size() &&
+             checksum == libim::XXH64(journal.data(), journal.size() - sizeof(checksum));
+
+    /* Incomplete journal means the file wasn't modified yet. Journal of file with different size is stale. */
+    if(bValid && FileExists(cndFile))
+    {
+        FileStream fs(cndFile, FileStream::ReadWrite);
+        if(fs.size() == fileSize)
+        {
+            for(const auto& range : ranges)
+            {
+                fs.seek(range.offset);
+                if(fs.write(range.data, range.size) != range.size) {
+                    throw FileStreamError("Failed to restore CND file from patch journal!");
+                }
+            }
+            fs.flush();
+        }
+        else {
+            bValid = false;
+        }
+    }
+    else {
+        bValid = false;
+    }
+
+    RemoveFile(journalFile);
+    SyncParentDir(journalFile);
+    return bValid;
+}
+
+bool libim::CND::ReplaceMaterial(const Material& mat, const std::string& cndFile, CndPatchMode mode)
+{
+    LIBIM_STATS_SCOPED_TIMER("CND::ReplaceMaterial");
+    return ReplaceMaterials({ mat }, cndFile, 0, mode);
+}
+
+bool libim::CND::ReplaceMaterials(const std::vector<Material>& mats, const std::string& cndFile, std::size_t asyncQueueDepth, CndPatchMode mode)
+{
+    LIBIM_STATS_SCOPED_TIMER("CND::ReplaceMaterials");
+    if(mats.empty()) {
+        return false;
+    }
+
+    /* Map material name to replacing material. If the same material is given more than once the last one wins. */
+    std::unordered_map<std::string, const Material*> replMats;
+    for(const auto& mat : mats)
+    {
+        if(mat.mipmaps().empty() || mat.mipmaps().at(0).empty()) {
+            return false;
+        }
+        replMats[mat.name()] = &mat;
+    }
+
     try
     {
+        /* Don't patch over data of interrupted in-place patch */
+        if(RecoverInPlacePatch(cndFile)) {
+            std::cout << "CND Info: Interrupted in-place patch of CND file was rolled back\n";
+        }
+
         InputFileStream ifstream(cndFile);
 
         /* Read cnd file header */
@@ -221,7 +676,7 @@ bool libim::CND::ReplaceMaterial(const Material& mat, const std::string& cndFile
         }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
-// Find material that is being patched
+// Find materials that are being patched
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
         /* Seek to material header list */
@@ -238,12 +693,17 @@ bool libim::CND::ReplaceMaterial(const Material& mat, const std::string& cndFile
 
         /* Read material header list */
         auto matHeaders = ifstream.read<std::vector<CndMatHeader>>(cndHeader.numMaterials);
+        const std::size_t pixelDataOffset = ifstream.tell();
 
-        /* Get patching material pixel data offset and size */
-        std::size_t replMatOff  = 0;
-        uint32_t    replMatSize = 0;
-        for(auto& matHeader : matHeaders)
+        /* Get pixel data size of each material and patch headers of materials being replaced */
+        std::vector<uint32_t>        matSizes(matHeaders.size(), 0);
+        std::vector<uint32_t>        patchSizes(matHeaders.size(), 0);
+        std::vector<const Material*> matPatches(matHeaders.size(), nullptr);
+        std::size_t nReplaced = 0;
+
+        for(std::size_t i = 0; i < matHeaders.size(); i++)
         {
+            auto& matHeader = matHeaders[i];
             if(matHeader.mipmapCount < 1 || matHeader.texturesPerMipmap < 1)
             {
                 std::cerr << "CND Warning: No pixel data found for material: " << matHeader.name << std::endl;
@@ -256,32 +716,56 @@ bool libim::CND::ReplaceMaterial(const Material& mat, const std::string& cndFile
                 return false;
             }
 
+            matSizes[i] = GetMaterialPixelDataSize(matHeader);
+
             /* Do we have material header that is being patched? */
-            if(matHeader.name == mat.name())
-            {
-                /* Calculate material's mipmap size */
-                for(int32_t i = 0; i < matHeader.mipmapCount; i++){
-                    replMatSize += GetMipmapPixelDataSize(matHeader.texturesPerMipmap, matHeader.width, matHeader.height, matHeader.colorInfo.bpp);
-                }
+            auto itMat = replMats.find(matHeader.name);
+            if(itMat == replMats.end() || itMat->second == nullptr) {
+                continue;
+            }
 
-                matHeader.width       = mat.width();
-                matHeader.height      = mat.height();
-                matHeader.colorInfo   = mat.colorFormat();
-                matHeader.mipmapCount = mat.mipmaps().size();
-                matHeader.texturesPerMipmap = mat.mipmaps().at(0).size();
+            const Material& mat = *itMat->second;
+            itMat->second = nullptr; // Only the first material with the same name is patched
+            matPatches[i] = &mat;
+            nReplaced++;
 
-                break;
+            /* Calculate new bitmap buffer size */
+            uint32_t nPatchMatSize = 0;
+            for(std::size_t mmIdx = 0; mmIdx < mat.mipmaps().size(); mmIdx++){
+                nPatchMatSize += GetMipmapPixelDataSize(mat.mipmaps().at(mmIdx).size(), mat.width(), mat.height(), mat.colorFormat().bpp);
             }
+            nBitmapBufSize = (nBitmapBufSize - matSizes[i]) + nPatchMatSize;
+            patchSizes[i]  = nPatchMatSize;
 
-            for(int32_t i = 0; i < matHeader.mipmapCount; i++){
-                replMatOff += GetMipmapPixelDataSize(matHeader.texturesPerMipmap, matHeader.width, matHeader.height, matHeader.colorInfo.bpp);
+            matHeader.width       = mat.width();
+            matHeader.height      = mat.height();
+            matHeader.colorInfo   = mat.colorFormat();
+            matHeader.mipmapCount = mat.mipmaps().size();
+            matHeader.texturesPerMipmap = mat.mipmaps().at(0).size();
+        }
+
+        /* Verify all materials were found */
+        if(nReplaced != replMats.size())
+        {
+            for(const auto& mat : replMats)
+            {
+                if(mat.second) {
+                    std::cerr << "CND Error: Cannot replace material " << mat.first << " in cnd file: material not found!\n";
+                }
             }
+            return false;
         }
 
-        /* Verify offset and size */
-        if(replMatOff >=  nBitmapBufSize || replMatSize == 0)
+        /* Verify total size of pixel data */
+        std::size_t nOldBitmapSize = 0;
+        for(auto size : matSizes) {
+            nOldBitmapSize += size;
+        }
+
+        const std::size_t restOffset = pixelDataOffset + nOldBitmapSize;
+        if(restOffset > ifstream.size())
         {
-            std::cerr << "CND Error: Cannot replace material in cnd file: material not found!\n";
+            std::cerr << "CND Error: Cannot replace material in cnd file: material pixel data is out of file bounds!\n";
             return false;
         }
 
@@ -289,59 +773,116 @@ bool libim::CND::ReplaceMaterial(const Material& mat, const std::string& cndFile
 // Patch cnd file
 /////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
-    // Writting material list
-        /* Get patching material pixel data size */
-        uint32_t nPatchMatSize = 0;
-        for(std::size_t i = 0; i < mat.mipmaps().size(); i++){
-            nPatchMatSize += GetMipmapPixelDataSize(mat.mipmaps().at(i).size(), mat.width(), mat.height(), mat.colorFormat().bpp);
+        /* Overwrite headers and pixel data of replaced materials in place when no data has to move */
+        bool bInPlace = mode == CndPatchMode::InPlace;
+        for(std::size_t i = 0; bInPlace && i < matHeaders.size(); i++) {
+            bInPlace = !matPatches[i] || patchSizes[i] == matSizes[i];
         }
 
-        /* Calculate new bitmap buffer size */
-        nBitmapBufSize = (nBitmapBufSize - replMatSize) + nPatchMatSize;
+        if(bInPlace)
+        {
+            std::vector<InPlaceRange> ranges;
+            std::size_t matOffset = pixelDataOffset;
+            for(std::size_t i = 0; i < matHeaders.size(); i++)
+            {
+                if(matPatches[i])
+                {
+                    const std::size_t headerOffset = matListOffset + sizeof(uint32_t) + i * sizeof(CndMatHeader);
+                    ranges.push_back({ headerOffset, sizeof(CndMatHeader), reinterpret_cast<const byte_t*>(&matHeaders[i]) });
 
+                    std::size_t texOffset = matOffset;
+                    for(const auto& mipmap : matPatches[i]->mipmaps())
+                    {
+                        for(const auto& tex : mipmap)
+                        {
+                            ranges.push_back({ texOffset, tex.bitmap()->size(), tex.bitmap()->data() });
+                            texOffset += tex.bitmap()->size();
+                        }
+                    }
 
-        /* Open output cnd file */
-        const std::string patchedCndFile = cndFile + ".patched";
-        OutputFileStream ofstream(patchedCndFile);
+                    if(texOffset - matOffset != matSizes[i]) {
+                        throw StreamError("Pixel data size of material " + matPatches[i]->name() + " doesn't match its textures!");
+                    }
+                }
+                matOffset += matSizes[i];
+            }
+
+            ifstream.close();
+            PatchFileInPlace(cndFile, ranges);
+            return true;
+        }
+        else if(mode == CndPatchMode::InPlace) {
+            std::cout << "CND Info: Pixel data size of replaced material changed, CND file is rewritten\n";
+        }
+
+        /* Make list of output file ranges after the file size field */
+        std::vector<PatchRange> ranges;
 
         /* Copy input cnd file to output stream until materials section */
-        ofstream.write(ifstream, 0, matListOffset);
-        //ifstream.seek(matListOffset); // Move istream cur forward
+        ranges.push_back({ sizeof(uint32_t), matListOffset - sizeof(uint32_t), nullptr });
 
         /* Write new pixel data size */
-        ofstream.write(nBitmapBufSize);
+        ranges.push_back({ 0, sizeof(nBitmapBufSize), reinterpret_cast<const byte_t*>(&nBitmapBufSize) });
 
         /* Write material list headers */
-        ofstream.write(matHeaders);
-
-        /* Seek to begining of material list raw data */
-        ifstream.seek(ifstream.tell() + sizeof(nBitmapBufSize) + cndHeader.numMaterials * sizeof(CndMatHeader));
+        ranges.push_back({ 0, matHeaders.size() * sizeof(CndMatHeader), reinterpret_cast<const byte_t*>(matHeaders.data()) });
 
-        /* Write pixel data until offset of material that's being patched */
-        ofstream.write(ifstream, ifstream.tell(), replMatOff);        
-        //ifstream.seek(ifstream.tell() + replMatOff); // Move istream cur forward
+        /* Write pixel data. Consecutive unchanged materials are copied from input file in one go. */
+        std::size_t copyOffset = pixelDataOffset;
+        std::size_t copySize   = 0;
+        std::size_t matOffset  = pixelDataOffset;
 
-        /* Write new material data to output cnd file */
-        for(const auto& mipmap : mat.mipmaps())
+        for(std::size_t i = 0; i < matHeaders.size(); i++)
         {
-            for(const auto& tex : mipmap) {
-                ofstream.write(tex.bitmap());
+            if(!matPatches[i])
+            {
+                copySize  += matSizes[i];
+                matOffset += matSizes[i];
+                continue;
             }
-        }
 
-        /* Write the rest of input cnd file to output cnd file */
-        ofstream.write(ifstream, ifstream.tell() + replMatSize);
+            if(copySize > 0) {
+                ranges.push_back({ copyOffset, copySize, nullptr });
+            }
 
-        /* Write new file size to the beginning of the output cnd file*/
-        ofstream.seekBegin();
-        ofstream.write(static_cast<uint32_t>(ofstream.size()));
+            /* Write new material data to output cnd file */
+            for(const auto& mipmap : matPatches[i]->mipmaps())
+            {
+                for(const auto& tex : mipmap) {
+                    ranges.push_back({ 0, tex.bitmap()->size(), tex.bitmap()->data() });
+                }
+            }
+
+            matOffset += matSizes[i];
+            copyOffset = matOffset;
+            copySize   = 0;
+        }
+
+        /* Write the rest of unchanged materials and the rest of input cnd file to output cnd file */
+        copySize += ifstream.size() - restOffset;
+        if(copySize > 0) {
+            ranges.push_back({ copyOffset, copySize, nullptr });
+        }
 
-        /* Close IO file stream */
-        ifstream.close();
-        ofstream.close();
+        /* Write patched cnd file */
+        const std::string patchedCndFile = cndFile + ".patched";
+        if(asyncQueueDepth > 0)
+        {
+            ifstream.close();
+            WritePatchedFileAsync(cndFile, patchedCndFile, ranges, asyncQueueDepth);
+        }
+        else
+        {
+            WritePatchedFile(ifstream, patchedCndFile, ranges);
+            ifstream.close();
+        }
 
         /* Rename patched file name to original name */
-        RenameFile(patchedCndFile, cndFile);
+        if(!RenameFile(patchedCndFile, cndFile))
+        {
+            std::cerr << "CND Error: Failed to rename patched file " << patchedCndFile << " to " << cndFile << "!\n";
+            return false;
+        }
         return true;
     }
     catch(const std::exception& e)
@@ -350,3 +891,443 @@ bool libim::CND::ReplaceMaterial(const Material& mat, const std::string& cndFile
         return false;
     }
 }
+
+
+/* Reads CND header and material header table and calculates offset of each material's pixel data */
+static std::vector<CndMaterialEntry> ReadMaterialEntries(const InputStream& istream, CndHeader& header, std::size_t& pixelDataOffset, std::size_t& pixelDataSize)
+{
+    /* Read cnd file header */
+    istream.seekBegin();
+    header = LoadHeader(istream);
+    pixelDataOffset = 0;
+    pixelDataSize   = 0;
+
+    std::vector<CndMaterialEntry> entries;
+    if(header.numMaterials < 1) {
+        return entries;
+    }
+
+    /* Seek to materials position and read pixel data size */
+    istream.seek(GetMatSectionOffset(header));
+    pixelDataSize = istream.read<uint32_t>();
+
+    /* Read material header list and calculate offset of each material's pixel data */
+    auto matHeaders = istream.read<std::vector<CndMatHeader>>(header.numMaterials);
+    pixelDataOffset = istream.tell();
+
+    std::size_t offset = pixelDataOffset;
+    entries.reserve(matHeaders.size());
+    for(const auto& matHeader : matHeaders)
+    {
+        CndMaterialEntry entry;
+        entry.header = matHeader;
+        entry.pixelDataOffset = offset;
+        entry.pixelDataSize   = 0;
+
+        if(matHeader.mipmapCount > 0 && matHeader.texturesPerMipmap > 0)
+        {
+            if(matHeader.colorInfo.bpp % 8 != 0) {
+                throw StreamError("Material " + std::string(matHeader.name) + " has wrong bitdepth size: " + std::to_string(matHeader.colorInfo.bpp));
+            }
+
+            entry.pixelDataSize = GetMaterialPixelDataSize(matHeader);
+        }
+
+        offset += entry.pixelDataSize;
+        if(offset > pixelDataOffset + pixelDataSize) {
+            throw StreamError("Material " + std::string(matHeader.name) + " pixel data is out of bounds!");
+        }
+
+        entries.push_back(entry);
+    }
+
+    return entries;
+}
+
+/* Feeds pixel data of material to hasher, reads stream with readAt */
+static void HashPixelData(const InputStream& istream, const CndMaterialEntry& entry, libim::XXH64Hasher& hasher)
+{
+    ByteArray buffer(std::min<std::size_t>(entry.pixelDataSize, 256 * 1024));
+    std::size_t offset = entry.pixelDataOffset;
+    for(std::size_t nRemaining = entry.pixelDataSize; nRemaining > 0;)
+    {
+        const std::size_t nRead = istream.readAt(offset, buffer.data(), std::min(nRemaining, buffer.size()));
+        if(nRead == 0) {
+            throw StreamError("Error reading material pixel data from stream!");
+        }
+
+        hasher.update(buffer.data(), nRead);
+        nRemaining -= nRead;
+        offset     += nRead;
+    }
+}
+
+CndMaterialIndex::CndMaterialIndex(StreamPtr<InputStream> istream) :
+    m_stream(std::move(istream))
+{
+    if(!m_stream) {
+        throw StreamError("CndMaterialIndex: stream is null!");
+    }
+
+    m_entries = ReadMaterialEntries(*m_stream, m_header, m_pixelDataOffset, m_pixelDataSize);
+}
+
+const CndHeader& CndMaterialIndex::header() const
+{
+    return m_header;
+}
+
+std::size_t CndMaterialIndex::size() const
+{
+    return m_entries.size();
+}
+
+bool CndMaterialIndex::empty() const
+{
+    return m_entries.empty();
+}
+
+const std::vector<CndMaterialEntry>& CndMaterialIndex::entries() const
+{
+    return m_entries;
+}
+
+const CndMaterialEntry& CndMaterialIndex::at(std::size_t idx) const
+{
+    return m_entries.at(idx);
+}
+
+const CndMaterialEntry* CndMaterialIndex::find(const std::string& name) const
+{
+    for(const auto& entry : m_entries)
+    {
+        if(strncmp(entry.header.name, name.c_str(), sizeof(entry.header.name)) == 0) {
+            return &entry;
+        }
+    }
+
+    return nullptr;
+}
+
+std::size_t CndMaterialIndex::pixelDataOffset() const
+{
+    return m_pixelDataOffset;
+}
+
+std::size_t CndMaterialIndex::pixelDataSize() const
+{
+    return m_pixelDataSize;
+}
+
+Material CndMaterialIndex::loadMaterial(std::size_t idx) const
+{
+    return loadMaterial(m_entries.at(idx));
+}
+
+Material CndMaterialIndex::loadMaterial(const CndMaterialEntry& entry) const
+{
+    Bitmap pixelData(entry.pixelDataSize);
+    if(entry.pixelDataSize > 0)
+    {
+        if(m_stream->readAt(entry.pixelDataOffset, pixelData.data(), pixelData.size()) != pixelData.size()) {
+            throw StreamError("Error reading material pixel data from stream!");
+        }
+    }
+
+    const std::size_t nTextures = entry.pixelDataSize > 0 ? std::size_t(entry.header.mipmapCount) * entry.header.texturesPerMipmap : 0;
+    auto arena = MakeBitmapArena(entry.pixelDataSize, nTextures);
+    return MakeMaterial(entry.header, pixelData, arena);
+}
+
+uint64_t CndMaterialIndex::hashMaterial(std::size_t idx) const
+{
+    return hashMaterial(m_entries.at(idx));
+}
+
+uint64_t CndMaterialIndex::hashMaterial(const CndMaterialEntry& entry) const
+{
+    libim::XXH64Hasher hasher;
+    hasher.update(&entry.header, sizeof(entry.header));
+    HashPixelData(*m_stream, entry, hasher);
+    return hasher.digest();
+}
+
+uint64_t CndMaterialIndex::hashContent(std::size_t idx) const
+{
+    return hashContent(m_entries.at(idx));
+}
+
+uint64_t CndMaterialIndex::hashContent(const CndMaterialEntry& entry) const
+{
+    /* Header fields following the name */
+    constexpr std::size_t contentOffset = offsetof(CndMatHeader, width);
+
+    libim::XXH64Hasher hasher;
+    hasher.update(reinterpret_cast<const byte_t*>(&entry.header) + contentOffset, sizeof(entry.header) - contentOffset);
+    HashPixelData(*m_stream, entry, hasher);
+    return hasher.digest();
+}
+
+const StreamPtr<InputStream>& CndMaterialIndex::stream() const
+{
+    return m_stream;
+}
+
+std::vector<uint64_t> libim::CND::HashMaterials(const CndMaterialIndex& index, std::size_t numThreads, ProgressListener* progress)
+{
+    LIBIM_STATS_SCOPED_TIMER("CND::HashMaterials");
+    std::vector<uint64_t> hashes(index.size(), 0);
+    if(progress) {
+        progress->onBegin(index.size(), index.pixelDataSize());
+    }
+
+    const auto hash = [&](std::size_t i) {
+        hashes[i] = index.hashContent(i);
+        if(progress)
+        {
+            const auto& entry = index.at(i);
+            progress->onItem(std::string(entry.header.name, strnlen(entry.header.name, sizeof(entry.header.name))), entry.pixelDataSize);
+        }
+    };
+
+    if(numThreads == 1 || index.size() < 2)
+    {
+        for(std::size_t i = 0; i < index.size(); i++) {
+            hash(i);
+        }
+        return hashes;
+    }
+
+    /* Each task hashes one material into its own slot, the first error is rethrown by wait */
+    libim::ThreadPool pool(numThreads);
+    for(std::size_t i = 0; i < index.size(); i++) {
+        pool.submit([&, i]{ hash(i); });
+    }
+
+    pool.wait();
+    return hashes;
+}
+
+
+constexpr std::size_t CndMaterialTable::npos;
+
+CndMaterialTable::CndMaterialTable(const InputStream& istream)
+{
+    CndHeader header;
+    std::size_t pixelDataOffset = 0;
+    std::size_t pixelDataSize   = 0;
+    *this = CndMaterialTable(ReadMaterialEntries(istream, header, pixelDataOffset, pixelDataSize));
+}
+
+CndMaterialTable::CndMaterialTable(const std::vector<CndMaterialEntry>& entries)
+{
+    reserve(entries.size(), entries.size() * 16);
+    for(const auto& entry : entries) {
+        add(entry);
+    }
+}
+
+std::size_t CndMaterialTable::size() const
+{
+    return m_nameOffsets.size();
+}
+
+bool CndMaterialTable::empty() const
+{
+    return m_nameOffsets.empty();
+}
+
+void CndMaterialTable::add(const CndMaterialEntry& entry)
+{
+    if(size() >= std::numeric_limits<Row>::max()) {
+        throw std::length_error("CndMaterialTable: too many materials");
+    }
+
+    /* Name in header is not necessarily null terminated */
+    const auto& name = entry.header.name;
+    m_nameOffsets.push_back(static_cast<uint32_t>(m_namePool.size()));
+    m_namePool.insert(m_namePool.end(), name, name + strnlen(name, sizeof(name)));
+    m_namePool.push_back('\0');
+
+    auto formatId = findFormat(entry.header.colorInfo);
+    if(formatId == npos)
+    {
+        if(m_formats.size() > std::numeric_limits<uint16_t>::max()) {
+            throw std::length_error("CndMaterialTable: too many color formats");
+        }
+        formatId = m_formats.size();
+        m_formats.push_back(entry.header.colorInfo);
+    }
+
+    m_widths.push_back(entry.header.width);
+    m_heights.push_back(entry.header.height);
+    m_formatIds.push_back(static_cast<uint16_t>(formatId));
+    m_mipmapCounts.push_back(entry.header.mipmapCount);
+    m_texturesPerMipmap.push_back(entry.header.texturesPerMipmap);
+    m_pixelDataOffsets.push_back(entry.pixelDataOffset);
+    m_pixelDataSizes.push_back(static_cast<uint32_t>(entry.pixelDataSize));
+}
+
+void CndMaterialTable::reserve(std::size_t numMaterials, std::size_t nameCapacity)
+{
+    m_namePool.reserve(nameCapacity);
+    m_nameOffsets.reserve(numMaterials);
+    m_widths.reserve(numMaterials);
+    m_heights.reserve(numMaterials);
+    m_formatIds.reserve(numMaterials);
+    m_mipmapCounts.reserve(numMaterials);
+    m_texturesPerMipmap.reserve(numMaterials);
+    m_pixelDataOffsets.reserve(numMaterials);
+    m_pixelDataSizes.reserve(numMaterials);
+}
+
+const char* CndMaterialTable::name(Row row) const
+{
+    return &m_namePool.at(m_nameOffsets.at(row));
+}
+
+int32_t CndMaterialTable::width(Row row) const
+{
+    return m_widths.at(row);
+}
+
+int32_t CndMaterialTable::height(Row row) const
+{
+    return m_heights.at(row);
+}
+
+const ColorFormat& CndMaterialTable::format(Row row) const
+{
+    return m_formats.at(m_formatIds.at(row));
+}
+
+uint16_t CndMaterialTable::formatId(Row row) const
+{
+    return m_formatIds.at(row);
+}
+
+int32_t CndMaterialTable::mipmapCount(Row row) const
+{
+    return m_mipmapCounts.at(row);
+}
+
+int32_t CndMaterialTable::texturesPerMipmap(Row row) const
+{
+    return m_texturesPerMipmap.at(row);
+}
+
+uint64_t CndMaterialTable::pixelDataOffset(Row row) const
+{
+    return m_pixelDataOffsets.at(row);
+}
+
+uint32_t CndMaterialTable::pixelDataSize(Row row) const
+{
+    return m_pixelDataSizes.at(row);
+}
+
+const std::vector<int32_t>& CndMaterialTable::widths() const
+{
+    return m_widths;
+}
+
+const std::vector<int32_t>& CndMaterialTable::heights() const
+{
+    return m_heights;
+}
+
+const std::vector<uint16_t>& CndMaterialTable::formatIds() const
+{
+    return m_formatIds;
+}
+
+const std::vector<int32_t>& CndMaterialTable::mipmapCounts() const
+{
+    return m_mipmapCounts;
+}
+
+const std::vector<uint64_t>& CndMaterialTable::pixelDataOffsets() const
+{
+    return m_pixelDataOffsets;
+}
+
+const std::vector<uint32_t>& CndMaterialTable::pixelDataSizes() const
+{
+    return m_pixelDataSizes;
+}
+
+const std::vector<ColorFormat>& CndMaterialTable::formats() const
+{
+    return m_formats;
+}
+
+std::size_t CndMaterialTable::findFormat(const ColorFormat& format) const
+{
+    auto it = std::find(m_formats.begin(), m_formats.end(), format);
+    return it != m_formats.end() ? std::size_t(it - m_formats.begin()) : npos;
+}
+
+std::size_t CndMaterialTable::find(const std::string& name) const
+{
+    for(std::size_t row = 0; row < size(); row++)
+    {
+        if(name == &m_namePool[m_nameOffsets[row]]) {
+            return row;
+        }
+    }
+    return npos;
+}
+
+std::vector<CndMaterialTable::Row> CndMaterialTable::rows() const
+{
+    std::vector<Row> result(size());
+    for(std::size_t i = 0; i < result.size(); i++) {
+        result[i] = Row(i);
+    }
+    return result;
+}
+
+std::vector<CndMaterialTable::Row> CndMaterialTable::filter(int32_t width, int32_t height, const ColorFormat& format) const
+{
+    std::vector<Row> result;
+    const auto formatId = findFormat(format);
+    if(formatId == npos) {
+        return result;
+    }
+
+    /* Format id is compared first, it has the smallest column */
+    const auto id = uint16_t(formatId);
+    for(std::size_t row = 0; row < size(); row++)
+    {
+        if(m_formatIds[row] == id && m_widths[row] == width && m_heights[row] == height) {
+            result.push_back(Row(row));
+        }
+    }
+    return result;
+}
+
+void CndMaterialTable::sort(std::vector<Row>& rows, Column column, bool descending) const
+{
+    const auto sortBy = [&](const auto& values) {
+        std::stable_sort(rows.begin(), rows.end(), [&](Row lhs, Row rhs) {
+            return descending ? values.at(rhs) < values.at(lhs) : values.at(lhs) < values.at(rhs);
+        });
+    };
+
+    switch(column)
+    {
+    case Column::Name:
+        std::stable_sort(rows.begin(), rows.end(), [&](Row lhs, Row rhs) {
+            const int cmp = strcmp(name(lhs), name(rhs));
+            return descending ? cmp > 0 : cmp < 0;
+        });
+        break;
+    case Column::Width:             sortBy(m_widths);            break;
+    case Column::Height:            sortBy(m_heights);           break;
+    case Column::Format:            sortBy(m_formatIds);         break;
+    case Column::MipmapCount:       sortBy(m_mipmapCounts);      break;
+    case Column::TexturesPerMipmap: sortBy(m_texturesPerMipmap); break;
+    case Column::PixelDataOffset:   sortBy(m_pixelDataOffsets);  break;
+    case Column::PixelDataSize:     sortBy(m_pixelDataSizes);    break;
+    }
+}
@@ -18,6 +18,7 @@
 #include "common.h"
 #include "io/filestream.h"
 #include "io/stream.h"
+#include "utils/progress.h"
 
 namespace libim {
 namespace CND {
@@ -76,11 +77,257 @@ struct CndMatHeader
 };
 
 
+struct CndMaterialEntry
+{
+    CndMatHeader header;
+    std::size_t  pixelDataOffset; // Offset of material's pixel data in CND file
+    std::size_t  pixelDataSize;   // Size of all material's mipmaps
+};
+
+
+enum class CndSectionType
+{
+    Header,
+    Sounds,    // sound headers and sound data
+    Unknown,   // 4 unknown bytes between sound and material section
+    Materials, // pixel data size, material headers and pixel data
+    Unparsed   // rest of file (models, sprites, keyframes, ...), layout not known yet
+};
+
+struct CndSection
+{
+    CndSectionType type;
+    std::size_t offset;
+    std::size_t size;
+    std::size_t count; // number of resources in section, 0 if not known
+};
+
+const char* GetCndSectionName(CndSectionType type);
+
+/* Single pass, forward-only reader of CND file sections. Only the header and the fields needed
+   to find the next section are read, section data is not read nor buffered, and the stream position
+   never moves backwards, so section data can be copied straight from the stream in section order.
+   Sections are returned in file order. */
+class CndSectionReader
+{
+public:
+    /* Reads and verifies CND header at the beginning of stream. Throws StreamError on error. */
+    explicit CndSectionReader(const InputStream& istream);
+
+    const CndHeader& header() const;
+
+    /* Reads next section into section. Returns false if there are no more sections.
+       Throws StreamError if section is out of file bounds. */
+    bool next(CndSection& section);
+
+private:
+    const InputStream& m_stream;
+    CndHeader m_header;
+    std::size_t m_offset = 0; // offset of next section
+    int m_next = 0;           // type of next section
+};
+
+/* Reads CND header from current stream position. Throws StreamError if header is not valid (see VerifyHeader). */
 CndHeader LoadHeader(const InputStream& istream);
 
+/* Throws StreamError if header doesn't have copyright notice or file version of CND file */
+void VerifyHeader(const CndHeader& header);
+
+/* Returns true if data begins with CND copyright notice (GetCopyrightNotice().size() bytes are read).
+   Notice is compared with SSE2 where available. */
+bool HasCopyrightNotice(const char* data);
+
+/* Returns copyright notice and file version every CND file header must have */
+const std::array<char, 1216>& GetCopyrightNotice();
+uint32_t GetFileVersion();
+
 uint32_t GetMatSectionOffset(const CndHeader& header);
+uint32_t GetMaterialPixelDataSize(const CndMatHeader& matHeader);
 std::vector<Material> LoadMaterials(const InputStream& istream);
-bool ReplaceMaterial(const Material& mat, const std::string& filename);
+
+/* Loads materials of CND file with already read and verified header, e.g. header returned by ProbeFile */
+std::vector<Material> LoadMaterials(const InputStream& istream, const CndHeader& header);
+
+/* How ReplaceMaterials writes patched CND file */
+enum class CndPatchMode
+{
+    Rewrite, // patched copy of the file is written and renamed over the original file
+    InPlace  // if pixel data size of every replaced material is unchanged only material headers and pixel data
+             // of replaced materials are overwritten in the file, otherwise the file is rewritten
+};
+
+bool ReplaceMaterial(const Material& mat, const std::string& filename, CndPatchMode mode = CndPatchMode::Rewrite);
+
+/* Replaces materials in CND file in one pass over the file.
+   If asyncQueueDepth > 0 patched file is written with AsyncIO pipeline with up to asyncQueueDepth requests in flight,
+   otherwise with blocking I/O where unchanged data is copied by the kernel if supported (copy_file_range).
+   In-place patch first writes an undo journal with the original data of overwritten ranges next to the file
+   (see GetPatchJournalPath) and removes it when patched data is flushed to disk, so a patch interrupted by crash
+   is rolled back by RecoverInPlacePatch. Interrupted patch is rolled back before the file is patched again. */
+bool ReplaceMaterials(const std::vector<Material>& mats, const std::string& filename, std::size_t asyncQueueDepth = 0,
+                      CndPatchMode mode = CndPatchMode::Rewrite);
+
+/* Returns path of in-place patch journal of CND file */
+std::string GetPatchJournalPath(const std::string& filename);
+
+/* Rolls back in-place patch of CND file which was interrupted before it completed.
+   Returns true if the file was restored, false if there was nothing to roll back. Incomplete journal
+   (crash while journal was written, file not modified yet) and stale journal are removed.
+   Throws StreamError if journal is valid but the file couldn't be restored. */
+bool RecoverInPlacePatch(const std::string& filename);
+
+
+/* Index of materials stored in CND file. Only the material header table is read
+   when index is made; material's pixel data is read and decoded on loadMaterial call.
+   loadMaterial and hashMaterial read the stream with readAt, so they can be called concurrently
+   if readAt of the stream is thread-safe (see Stream), e.g. for MappedFileStream and FileStream. */
+class CndMaterialIndex
+{
+public:
+    /* Reads CND header and material header table. Throws StreamError on error. */
+    explicit CndMaterialIndex(StreamPtr<InputStream> istream);
+
+    const CndHeader& header() const;
+
+    std::size_t size() const;
+    bool empty() const;
+    const std::vector<CndMaterialEntry>& entries() const;
+    const CndMaterialEntry& at(std::size_t idx) const;
+    const CndMaterialEntry* find(const std::string& name) const;
+
+    /* Offset and size of pixel data of all materials */
+    std::size_t pixelDataOffset() const;
+    std::size_t pixelDataSize() const;
+
+    /* Reads pixel data of material and decodes its mipmaps */
+    Material loadMaterial(std::size_t idx) const;
+    Material loadMaterial(const CndMaterialEntry& entry) const;
+
+    /* Returns XXH64 hash of material header and pixel data as stored in CND file.
+       Materials with equal hash decode to the same Material. */
+    uint64_t hashMaterial(std::size_t idx) const;
+    uint64_t hashMaterial(const CndMaterialEntry& entry) const;
+
+    /* Returns XXH64 hash of material content: size, color format, mipmap layout and pixel data.
+       Name is not hashed, so materials with equal content hash are copies of the same material,
+       possibly stored under different names or in different CND files. */
+    uint64_t hashContent(std::size_t idx) const;
+    uint64_t hashContent(const CndMaterialEntry& entry) const;
+
+    const StreamPtr<InputStream>& stream() const;
+
+private:
+    StreamPtr<InputStream> m_stream;
+    CndHeader m_header;
+    std::vector<CndMaterialEntry> m_entries;
+    std::size_t m_pixelDataOffset = 0;
+    std::size_t m_pixelDataSize   = 0;
+};
+
+/* Returns content hash (see CndMaterialIndex::hashContent) of every material of index, in index order.
+   Materials are hashed in parallel on numThreads threads (0 = all hardware threads, 1 = calling thread only),
+   so readAt of index stream has to be thread-safe when numThreads != 1.
+   If progress is not null every hashed material is reported to it. */
+std::vector<uint64_t> HashMaterials(const CndMaterialIndex& index, std::size_t numThreads = 0, ProgressListener* progress = nullptr);
+
+/* Compact structure-of-arrays table of material metadata. Table is made straight from CND material header table,
+   pixel data is not read. Names are stored in one string pool and the other fields in parallel column arrays,
+   color formats as index into the list of distinct formats of the table. Filter and sort queries scan only
+   the columns they need. Queries return and take row numbers, rows are in material header table order. */
+class CndMaterialTable
+{
+public:
+    using Row = uint32_t;
+
+    enum class Column
+    {
+        Name,
+        Width,
+        Height,
+        Format,            // sorted by format id
+        MipmapCount,
+        TexturesPerMipmap,
+        PixelDataOffset,
+        PixelDataSize
+    };
+
+    static constexpr std::size_t npos = std::size_t(-1);
+
+    CndMaterialTable() = default;
+
+    /* Reads CND header and material header table of stream. Throws StreamError on error. */
+    explicit CndMaterialTable(const InputStream& istream);
+    explicit CndMaterialTable(const std::vector<CndMaterialEntry>& entries);
+
+    std::size_t size() const;
+    bool empty() const;
+
+    /* Appends material to table */
+    void add(const CndMaterialEntry& entry);
+    void reserve(std::size_t numMaterials, std::size_t nameCapacity = 0);
+
+    const char* name(Row row) const;
+    int32_t width(Row row) const;
+    int32_t height(Row row) const;
+    const ColorFormat& format(Row row) const;
+    uint16_t formatId(Row row) const;
+    int32_t mipmapCount(Row row) const;
+    int32_t texturesPerMipmap(Row row) const;
+    uint64_t pixelDataOffset(Row row) const;
+    uint32_t pixelDataSize(Row row) const;
+
+    /* Columns */
+    const std::vector<int32_t>&  widths() const;
+    const std::vector<int32_t>&  heights() const;
+    const std::vector<uint16_t>& formatIds() const;
+    const std::vector<int32_t>&  mipmapCounts() const;
+    const std::vector<uint64_t>& pixelDataOffsets() const;
+    const std::vector<uint32_t>& pixelDataSizes() const;
+
+    /* Distinct color formats of table, index is format id */
+    const std::vector<ColorFormat>& formats() const;
+
+    /* Returns id of format or npos if no material has the format */
+    std::size_t findFormat(const ColorFormat& format) const;
+
+    /* Returns row of material with name or npos if not found */
+    std::size_t find(const std::string& name) const;
+
+    /* Returns all rows in table order */
+    std::vector<Row> rows() const;
+
+    /* Returns rows for which pred(row) returns true */
+    template<typename Pred>
+    std::vector<Row> filter(Pred&& pred) const
+    {
+        std::vector<Row> result;
+        for(Row row = 0; row < size(); row++)
+        {
+            if(pred(row)) {
+                result.push_back(row);
+            }
+        }
+        return result;
+    }
+
+    /* Returns rows of materials of size width x height and color format */
+    std::vector<Row> filter(int32_t width, int32_t height, const ColorFormat& format) const;
+
+    /* Sorts rows by column, rows with equal values keep their order */
+    void sort(std::vector<Row>& rows, Column column, bool descending = false) const;
+
+private:
+    std::vector<char>     m_namePool;    // null terminated names
+    std::vector<uint32_t> m_nameOffsets;
+    std::vector<int32_t>  m_widths;
+    std::vector<int32_t>  m_heights;
+    std::vector<uint16_t> m_formatIds;
+    std::vector<int32_t>  m_mipmapCounts;
+    std::vector<int32_t>  m_texturesPerMipmap;
+    std::vector<uint64_t> m_pixelDataOffsets;
+    std::vector<uint32_t> m_pixelDataSizes;
+    std::vector<ColorFormat> m_formats;
+};
 
 }}
 #endif // LIBIM_CND_H
@@ -12,6 +12,8 @@
 #include <type_traits>
 #include <utility>
 
+#include "utils/arena.h"
+
 #if defined(WIN32) || defined(_WIN32)
 #  define OS_WINDOWS 1
 #  include <windows.h>
@@ -45,11 +47,19 @@ static constexpr std::size_t BYTE_BIT = CHAR_BIT;
 using byte_t = uint8_t;
 using ByteArray = std::vector<byte_t>;
 
-using Bitmap = ByteArray;
+/* Bitmap memory can be carved from arena shared by many bitmaps, see MakeBitmapPtr */
+using BitmapAllocator = libim::ArenaAllocator<byte_t>;
+using Bitmap = std::vector<byte_t, BitmapAllocator>;
 using BitmapPtr = std::shared_ptr<Bitmap>;
 
-inline BitmapPtr MakeBitmapPtr(std::size_t size) {
-    return std::make_shared<Bitmap>(size);
+/* Makes bitmap of size bytes. If arena is not null bitmap and its control block are allocated from arena */
+inline BitmapPtr MakeBitmapPtr(std::size_t size, const std::shared_ptr<libim::Arena>& arena = nullptr) {
+    return std::allocate_shared<Bitmap>(libim::ArenaAllocator<Bitmap>(arena), size, BitmapAllocator(arena));
+}
+
+template<typename InputIt>
+inline BitmapPtr MakeBitmapPtr(InputIt first, InputIt last, const std::shared_ptr<libim::Arena>& arena = nullptr) {
+    return std::allocate_shared<Bitmap>(libim::ArenaAllocator<Bitmap>(arena), first, last, BitmapAllocator(arena));
 }
 
 
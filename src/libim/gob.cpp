@@ -0,0 +1,364 @@
+#include "gob.h"
+
+#include <algorithm>
+
+
+GobArchive::GobArchive(const std::string& filepath) :
+    m_stream(OpenInputStream(filepath))
+{
+    m_mapped = dynamic_cast<const MappedFileStream*>(m_stream.get());
+
+    /* Read and verify header */
+    auto header = m_stream->read<GobFileHeader>();
+    if(header.signature != GOB_FILE_SIGNATURE) {
+        throw StreamError("Error unknown GOB file!");
+    }
+
+    if(header.version != GOB_FILE_VERSION) {
+        throw StreamError("Error wrong GOB file version: " + std::to_string(header.version));
+    }
+
+    /* Read directory */
+    m_stream->seek(header.directoryOffset);
+    const auto nDirSize = m_stream->read<uint32_t>();
+    m_entries = m_stream->read<std::vector<GobFileEntry>>(nDirSize);
+
+    /* Verify entries are within the archive */
+    for(const auto& entry : m_entries)
+    {
+        if(std::size_t(entry.offset) + entry.size > m_stream->size()) {
+            throw StreamError("Error GOB entry '" + GetGobEntryName(entry) + "' is out of file bounds!");
+        }
+    }
+
+    buildIndex();
+}
+
+void GobArchive::buildIndex()
+{
+    m_names.reserve(m_entries.size());
+    m_index.reserve(m_entries.size());
+    m_sorted.resize(m_entries.size());
+
+    for(std::size_t i = 0; i < m_entries.size(); i++)
+    {
+        m_names.push_back(NormalizeGobEntryName(GetGobEntryName(m_entries[i])));
+        m_index.emplace(m_names.back(), i); // first entry with the same name wins
+        m_sorted[i] = i;
+    }
+
+    std::sort(m_sorted.begin(), m_sorted.end(), [&](std::size_t a, std::size_t b) {
+        return m_names[a] < m_names[b];
+    });
+}
+
+const std::vector<GobFileEntry>& GobArchive::entries() const
+{
+    return m_entries;
+}
+
+const GobFileEntry* GobArchive::findEntry(const std::string& name) const
+{
+    auto it = m_index.find(NormalizeGobEntryName(name));
+    if(it == m_index.end()) {
+        return nullptr;
+    }
+
+    return &m_entries[it->second];
+}
+
+std::vector<const GobFileEntry*> GobArchive::findEntries(const std::string& prefix) const
+{
+    const auto nprefix = NormalizeGobEntryName(prefix);
+    auto it = std::lower_bound(m_sorted.begin(), m_sorted.end(), nprefix, [&](std::size_t idx, const std::string& p) {
+        return m_names[idx] < p;
+    });
+
+    std::vector<const GobFileEntry*> result;
+    for(; it != m_sorted.end() && m_names[*it].compare(0, nprefix.size(), nprefix) == 0; ++it) {
+        result.push_back(&m_entries[*it]);
+    }
+
+    return result;
+}
+
+std::vector<const GobFileEntry*> GobArchive::listDirectory(const std::string& dir, bool recursive) const
+{
+    auto ndir = NormalizeGobEntryName(dir);
+    if(!ndir.empty() && ndir.back() != '/') {
+        ndir.push_back('/');
+    }
+
+    auto result = findEntries(ndir);
+    if(!recursive)
+    {
+        result.erase(std::remove_if(result.begin(), result.end(), [&](const GobFileEntry* e) {
+            const auto& name = m_names[std::size_t(e - m_entries.data())];
+            return name.find('/', ndir.size()) != std::string::npos;
+        }), result.end());
+    }
+
+    return result;
+}
+
+StreamPtr<InputStream> GobArchive::openEntry(const std::string& name) const
+{
+    auto entry = findEntry(name);
+    if(!entry) {
+        return nullptr;
+    }
+
+    return openEntry(*entry);
+}
+
+StreamPtr<InputStream> GobArchive::openEntry(const GobFileEntry& entry) const
+{
+    /* Every entry of compressed archive gets its own decompression cursor, so entries can be read concurrently */
+    StreamPtr<Stream> parent = m_stream;
+    if(!m_mapped) {
+        parent = static_cast<const CompressedStream&>(*m_stream).duplicate();
+    }
+
+    auto sstream = MakeStreamPtr<SubStream>(std::move(parent), entry.offset, entry.size);
+    sstream->setName(GetFileName(GetGobEntryName(entry)));
+    return sstream;
+}
+
+const byte_t* GobArchive::entryData(const GobFileEntry& entry) const
+{
+    return m_mapped ? m_mapped->data(entry.offset) : nullptr;
+}
+
+bool GobArchive::isCompressed() const
+{
+    return m_mapped == nullptr;
+}
+
+const StreamPtr<InputStream>& GobArchive::stream() const
+{
+    return m_stream;
+}
+
+
+GobWriter::GobWriter(const std::string& filepath, Mode mode, bool sync) :
+    m_filepath(filepath),
+    m_sync(sync)
+{
+    if(mode == Mode::Create)
+    {
+        /* New archive is written to temporary file, so existing file is kept if writing fails.
+           FileStream doesn't truncate existing file. */
+        m_tmpFilepath = filepath + ".tmp";
+        if(FileExists(m_tmpFilepath) && !RemoveFile(m_tmpFilepath)) {
+            throw FileStreamError("Failed to overwrite file: " + m_tmpFilepath);
+        }
+
+        m_stream = MakeStreamPtr<FileStream>(m_tmpFilepath, FileStream::ReadWrite);
+        m_stream->setSyncOnClose(sync);
+        m_dataEnd = sizeof(GobFileHeader);
+        return;
+    }
+
+    if(!FileExists(filepath)) {
+        throw FileStreamError("GOB file '" + filepath + "' does not exist!");
+    }
+
+    m_stream = MakeStreamPtr<FileStream>(filepath, FileStream::ReadWrite);
+    m_stream->setSyncOnClose(sync);
+    m_stream->seekBegin();
+    auto header = m_stream->read<GobFileHeader>();
+    if(header.signature != GOB_FILE_SIGNATURE) {
+        throw StreamError("Error unknown GOB file!");
+    }
+
+    if(header.version != GOB_FILE_VERSION) {
+        throw StreamError("Error wrong GOB file version: " + std::to_string(header.version));
+    }
+
+    m_stream->seek(header.directoryOffset);
+    const auto nDirSize = m_stream->read<uint32_t>();
+    m_entries = m_stream->read<std::vector<GobFileEntry>>(nDirSize);
+    m_dirSize = sizeof(uint32_t) + m_entries.size() * sizeof(GobFileEntry);
+
+    for(const auto& entry : m_entries)
+    {
+        if(std::size_t(entry.offset) + entry.size > m_stream->size()) {
+            throw StreamError("Error GOB entry '" + GetGobEntryName(entry) + "' is out of file bounds!");
+        }
+    }
+
+    /* Data is appended after everything in the file, so committed directory stays intact */
+    m_dataEnd = m_stream->size();
+    buildIndex();
+}
+
+GobWriter::~GobWriter()
+{
+    if(!m_tmpFilepath.empty() && m_stream)
+    {
+        m_stream->setSyncOnClose(false);
+        m_stream->close();
+        RemoveFile(m_tmpFilepath);
+    }
+}
+
+void GobWriter::buildIndex()
+{
+    m_index.clear();
+    m_index.reserve(m_entries.size());
+    for(std::size_t i = 0; i < m_entries.size(); i++) {
+        m_index.emplace(NormalizeGobEntryName(GetGobEntryName(m_entries[i])), i); // first entry with the same name wins
+    }
+}
+
+const std::vector<GobFileEntry>& GobWriter::entries() const
+{
+    return m_entries;
+}
+
+const GobFileEntry* GobWriter::findEntry(const std::string& name) const
+{
+    auto it = m_index.find(NormalizeGobEntryName(name));
+    if(it == m_index.end()) {
+        return nullptr;
+    }
+
+    return &m_entries[it->second];
+}
+
+void GobWriter::checkEntry(const std::string& name, std::size_t size) const
+{
+    if(name.empty() || name.size() > GOB_ENTRY_NAME_MAX_SIZE) {
+        throw StreamError("Invalid GOB entry name '" + name + "'!");
+    }
+
+    if(m_dataEnd + size > UINT32_MAX) {
+        throw StreamError("GOB file size limit of 4 GB exceeded while adding entry '" + name + "'!");
+    }
+}
+
+void GobWriter::setEntry(const std::string& name, std::size_t size)
+{
+    auto nname = NormalizeGobEntryName(name);
+    auto it = m_index.find(nname);
+    if(it == m_index.end())
+    {
+        it = m_index.emplace(std::move(nname), m_entries.size()).first;
+        m_entries.emplace_back();
+    }
+
+    auto& entry = m_entries[it->second];
+    memset(entry.name, 0, sizeof(entry.name));
+    memcpy(entry.name, name.data(), name.size());
+    entry.offset = static_cast<uint32_t>(m_dataEnd);
+    entry.size   = static_cast<uint32_t>(size);
+    m_dataEnd   += size;
+}
+
+void GobWriter::addEntry(const std::string& name, const InputStream& istream)
+{
+    const std::size_t size = istream.size();
+    checkEntry(name, size);
+
+    /* Directory entry is updated only after data was written */
+    if(size > 0)
+    {
+        m_stream->seek(m_dataEnd);
+        m_stream->write(istream, 0, size, m_buffer);
+    }
+    setEntry(name, size);
+}
+
+void GobWriter::addEntry(const std::string& name, const byte_t* data, std::size_t size)
+{
+    checkEntry(name, size);
+    if(size > 0)
+    {
+        m_stream->seek(m_dataEnd);
+        if(m_stream->write(data, size) != size) {
+            throw StreamError("Failed to write GOB entry '" + name + "'!");
+        }
+    }
+    setEntry(name, size);
+}
+
+void GobWriter::addFile(const std::string& name, const std::string& filePath)
+{
+    InputFileStream ifs(filePath);
+    addEntry(name, ifs);
+}
+
+bool GobWriter::removeEntry(const std::string& name)
+{
+    auto it = m_index.find(NormalizeGobEntryName(name));
+    if(it == m_index.end()) {
+        return false;
+    }
+
+    m_entries.erase(m_entries.begin() + std::ptrdiff_t(it->second));
+    buildIndex();
+    return true;
+}
+
+void GobWriter::commit(bool sync)
+{
+    const std::size_t dirSize = sizeof(uint32_t) + m_entries.size() * sizeof(GobFileEntry);
+    if(m_dataEnd + dirSize > UINT32_MAX) {
+        throw StreamError("GOB file size limit of 4 GB exceeded while writing directory!");
+    }
+
+    /* Write directory after entry data */
+    const auto dirOffset = m_dataEnd;
+    m_stream->seek(dirOffset);
+    m_stream->write(static_cast<uint32_t>(m_entries.size()));
+    if(!m_entries.empty() &&
+       m_stream->write(reinterpret_cast<const byte_t*>(m_entries.data()), m_entries.size() * sizeof(GobFileEntry)) != m_entries.size() * sizeof(GobFileEntry)) {
+        throw StreamError("Failed to write GOB directory!");
+    }
+
+    /* Entry data and directory must be on disk before header refers to them */
+    if(sync) {
+        m_stream->flush();
+    }
+
+    GobFileHeader header;
+    header.signature       = GOB_FILE_SIGNATURE;
+    header.version         = GOB_FILE_VERSION;
+    header.directoryOffset = static_cast<uint32_t>(dirOffset);
+    m_stream->seekBegin();
+    if(m_stream->write(reinterpret_cast<const byte_t*>(&header), sizeof(header)) != sizeof(header)) {
+        throw StreamError("Failed to write GOB header!");
+    }
+
+    if(sync) {
+        m_stream->flush();
+    }
+
+    /* Next entries are appended after the committed directory */
+    m_dirSize = dirSize;
+    m_dataEnd = dirOffset + dirSize;
+
+    /* New archive replaces file at m_filepath and is written in place from now on */
+    if(!m_tmpFilepath.empty())
+    {
+        m_stream->close();
+        m_stream.reset();
+        if(!RenameFile(m_tmpFilepath, m_filepath)) {
+            throw FileStreamError("Failed to rename file '" + m_tmpFilepath + "' to '" + m_filepath + "'!");
+        }
+
+        m_tmpFilepath.clear();
+        m_stream = MakeStreamPtr<FileStream>(m_filepath, FileStream::ReadWrite);
+        m_stream->setSyncOnClose(m_sync);
+    }
+}
+
+std::size_t GobWriter::unusedSize() const
+{
+    std::size_t used = sizeof(GobFileHeader) + m_dirSize;
+    for(const auto& entry : m_entries) {
+        used += entry.size;
+    }
+
+    return m_stream->size() > used ? m_stream->size() - used : 0;
+}
@@ -2,15 +2,22 @@
 #define GOB_H
 #include <array>
 #include <cstdint>
+#include <cstring>
 #include <fstream>
 #include <iostream>
 #include <memory>
+#include <string>
+#include <unordered_map>
 #include <utility>
 #include <vector>
 
 #include "common.h"
 #include "io/stream.h"
+#include "io/compressedstream.h"
 #include "io/filestream.h"
+#include "io/mappedfilestream.h"
+#include "io/substream.h"
+#include "utils/stats.h"
 
 static constexpr std::array<char,4> GOB_FILE_SIGNATURE      = {{'G','O','B',' '}};
 static constexpr uint32_t           GOB_FILE_VERSION        = 0x14;
@@ -36,7 +43,7 @@ struct GobFileDirectory
 };
 
 template<>
-GobFileHeader Stream::read() const
+inline GobFileHeader Stream::read() const
 {
     GobFileHeader header;
     const auto nRead = read(reinterpret_cast<byte_t*>(&header), sizeof(header));
@@ -48,7 +55,7 @@ GobFileHeader Stream::read() const
 }
 
 template<>
-GobFileEntry Stream::read() const
+inline GobFileEntry Stream::read() const
 {
     GobFileEntry entry;
     const auto nRead = read(reinterpret_cast<byte_t*>(&entry), sizeof(entry));
@@ -59,11 +66,12 @@ GobFileEntry Stream::read() const
     return entry;
 }
 
-std::shared_ptr<GobFileDirectory> LoadGobFromFile(const std::string& filepath)
+inline std::shared_ptr<GobFileDirectory> LoadGobFromFile(const std::string& filepath)
 {
+    LIBIM_STATS_SCOPED_TIMER("LoadGobFromFile");
     try
     {
-        auto ifs = MakeStreamPtr<InputFileStream>(filepath);
+        auto ifs = OpenInputStream(filepath);
 
         /* Read Header */
         auto header = ifs->read<GobFileHeader>();
@@ -112,4 +120,151 @@ std::shared_ptr<GobFileDirectory> LoadGobFromFile(const std::string& filepath)
     }
 }
 
+/* Returns entry name as string. Entry name is not required to be null terminated. */
+inline std::string GetGobEntryName(const GobFileEntry& entry)
+{
+    const char* end = std::find(entry.name, entry.name + GOB_ENTRY_NAME_MAX_SIZE, '\0');
+    return std::string(entry.name, end);
+}
+
+/* Returns entry name in the form used for lookups: lower case,
+   '/' as path separator and without leading "./" or '/'. */
+inline std::string NormalizeGobEntryName(std::string name)
+{
+    for(auto& ch : name)
+    {
+        if(ch == '\\') {
+            ch = '/';
+        }
+        else if(ch >= 'A' && ch <= 'Z') {
+            ch = ch - 'A' + 'a';
+        }
+    }
+
+    std::size_t start = 0;
+    while(start < name.size())
+    {
+        if(name[start] == '/') {
+            start++;
+        }
+        else if(name.compare(start, 2, "./") == 0) {
+            start += 2;
+        }
+        else {
+            break;
+        }
+    }
+
+    return name.substr(start);
+}
+
+
+/* Memory mapped GOB archive. Entries are exposed as bounded views over the
+   archive file, so they can be read in place without extracting them first.
+   Compressed GOB container (see CompressedStream) is read transparently, its entries are decompressed on read. */
+class GobArchive
+{
+public:
+    /* Opens and maps GOB file. Throws StreamError if file is not a valid GOB file. */
+    explicit GobArchive(const std::string& filepath);
+
+    const std::vector<GobFileEntry>& entries() const;
+
+    /* Finds entry by name. Lookup is case insensitive and accepts both '/' and '\\' as path separator. */
+    const GobFileEntry* findEntry(const std::string& name) const;
+
+    /* Returns entries whose name starts with prefix, sorted by name */
+    std::vector<const GobFileEntry*> findEntries(const std::string& prefix) const;
+
+    /* Returns entries in directory dir e.g.: "mat". If recursive is false only direct children are returned. */
+    std::vector<const GobFileEntry*> listDirectory(const std::string& dir, bool recursive = false) const;
+
+    /* Returns read-only stream over entry data or nullptr if entry was not found */
+    StreamPtr<InputStream> openEntry(const std::string& name) const;
+    StreamPtr<InputStream> openEntry(const GobFileEntry& entry) const;
+
+    /* Returns pointer to entry data in the mapped archive file or nullptr if archive is compressed */
+    const byte_t* entryData(const GobFileEntry& entry) const;
+
+    bool isCompressed() const;
+    const StreamPtr<InputStream>& stream() const;
+
+private:
+    void buildIndex();
+
+private:
+    StreamPtr<InputStream> m_stream;
+    const MappedFileStream* m_mapped = nullptr;           // m_stream if archive is not compressed
+    std::vector<GobFileEntry> m_entries;
+    std::vector<std::string> m_names;                     // normalized entry names
+    std::vector<std::size_t> m_sorted;                    // entry indices sorted by normalized name
+    std::unordered_map<std::string, std::size_t> m_index; // normalized name -> entry index
+};
+
+
+/* Writes GOB archive in place. In Update mode entries of the existing archive are kept and data of new
+   or replaced entries is appended to the end of the file, so data of unchanged entries is never rewritten.
+   Entry data is streamed from the source stream (copied by the kernel where supported), whole files are not buffered.
+   On commit the new directory is written after the entry data and the header's directoryOffset is updated last,
+   so until then the archive on disk stays valid and refers to the previous directory.
+   Data of replaced and removed entries and previous directories remain in the file as unused space (see unusedSize). */
+class GobWriter
+{
+public:
+    enum class Mode
+    {
+        Create, // Create new archive, existing file is replaced on first commit
+        Update  // Update existing archive
+    };
+
+    /* Opens GOB file for writing. Throws StreamError if file can't be opened or existing file is not a valid GOB file.
+       If sync is false file is not flushed to the storage device when it's closed (see FileStream::setSyncOnClose). */
+    explicit GobWriter(const std::string& filepath, Mode mode = Mode::Update, bool sync = true);
+
+    /* Uncommitted changes are discarded, i.e. archive still refers to the last committed directory.
+       In Create mode archive which was never committed is removed and existing file is left untouched. */
+    ~GobWriter();
+
+    GobWriter(const GobWriter&) = delete;
+    GobWriter& operator = (const GobWriter&) = delete;
+
+    const std::vector<GobFileEntry>& entries() const;
+
+    /* Finds entry by name. Lookup is case insensitive and accepts both '/' and '\\' as path separator. */
+    const GobFileEntry* findEntry(const std::string& name) const;
+
+    /* Adds new entry or replaces data of existing entry with the same name. Name is stored as given.
+       Throws StreamError if name is longer than GOB_ENTRY_NAME_MAX_SIZE or archive would exceed 4 GB. */
+    void addEntry(const std::string& name, const InputStream& istream);
+    void addEntry(const std::string& name, const byte_t* data, std::size_t size);
+    void addFile(const std::string& name, const std::string& filePath);
+
+    /* Returns false if entry was not found */
+    bool removeEntry(const std::string& name);
+
+    /* Writes directory and header. If sync is true data is flushed to the storage device
+       before and after the header is updated. Entries can be added and committed again after commit.
+       In Create mode archive is written to <filepath>.tmp which replaces file at filepath on first commit. */
+    void commit(bool sync = true);
+
+    /* Returns number of bytes in archive not referenced by the header, directory or any entry */
+    std::size_t unusedSize() const;
+
+private:
+    void checkEntry(const std::string& name, std::size_t size) const;
+    void setEntry(const std::string& name, std::size_t size); // sets entry to data at m_dataEnd
+    void buildIndex();
+
+private:
+    StreamPtr<FileStream> m_stream;
+    std::string m_filepath;
+    std::string m_tmpFilepath;   // file written in Create mode until first commit
+    bool m_sync = true;
+    std::vector<GobFileEntry> m_entries;
+    std::unordered_map<std::string, std::size_t> m_index; // normalized name -> entry index
+    std::size_t m_dataEnd = 0;   // offset where data of next entry is appended
+    std::size_t m_dirSize = 0;   // size of committed directory
+    ByteArray m_buffer;          // copy buffer
+};
+
 #endif // GOB_H
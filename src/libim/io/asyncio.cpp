@@ -0,0 +1,976 @@
+#include "asyncio.h"
+#include "../utils/stats.h"
+#include "../utils/threadpool.h"
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstring>
+#include <limits>
+#include <mutex>
+#include <stdexcept>
+#include <system_error>
+
+#ifdef OS_WINDOWS
+# include <windows.h>
+# include <locale>
+# include <codecvt>
+# include <unordered_set>
+#else
+# include <errno.h>
+# include <fcntl.h>
+# include <sys/stat.h>
+# include <sys/types.h>
+# include <sys/uio.h>
+# include <unistd.h>
+#endif
+
+#if defined(__linux__) && defined(__has_include)
+# if __has_include(<linux/io_uring.h>)
+#  include <linux/io_uring.h>
+#  include <sys/mman.h>
+#  include <sys/syscall.h>
+#  if defined(__NR_io_uring_setup) && defined(__NR_io_uring_enter)
+#   define ASYNCIO_IO_URING
+#  endif
+# endif
+#endif
+
+
+namespace {
+    constexpr std::size_t kMaxTransferSize = 1 << 30; // max bytes transferred by one system call
+
+    std::string ErrorString(int error)
+    {
+        return std::system_category().message(error);
+    }
+}
+
+
+/* AsyncFile */
+
+struct AsyncFile::AsyncFileImpl
+{
+    AsyncFileImpl(std::string fp, FileStream::Mode mode) :
+        mode(mode),
+        filePath(GetNativePath(std::move(fp)))
+    {
+    #ifdef OS_WINDOWS
+        DWORD access = 0;
+        DWORD disposition = 0;
+        switch (mode)
+        {
+        case FileStream::Read:      access = GENERIC_READ;                 disposition = OPEN_EXISTING; break;
+        case FileStream::Write:     access = GENERIC_WRITE;                disposition = CREATE_ALWAYS; break;
+        case FileStream::ReadWrite: access = GENERIC_READ | GENERIC_WRITE; disposition = OPEN_ALWAYS;   break;
+        }
+
+        std::wstring_convert<std::codecvt_utf8_utf16<wchar_t>> converter;
+        std::wstring wPath = converter.from_bytes(filePath.c_str());
+        handle = CreateFileW(wPath.c_str(), access, FILE_SHARE_READ, NULL, disposition, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_OVERLAPPED, NULL);
+        if(handle == INVALID_HANDLE_VALUE) {
+            throw FileStreamError(GetLastErrorAsString());
+        }
+
+        LARGE_INTEGER lSize {};
+        if(!GetFileSizeEx(handle, &lSize)) {
+            throw FileStreamError("Error getting the file size: " + GetLastErrorAsString());
+        }
+        fileSize = static_cast<std::size_t>(lSize.QuadPart);
+    #else
+        int flags = O_RDONLY;
+        switch (mode)
+        {
+        case FileStream::Read:      flags = O_RDONLY;                     break;
+        case FileStream::Write:     flags = O_WRONLY | O_CREAT | O_TRUNC; break;
+        case FileStream::ReadWrite: flags = O_RDWR   | O_CREAT;             break;
+        }
+
+        handle = ::open(filePath.c_str(), flags, (mode_t)0600);
+        if(handle == -1) {
+            throw FileStreamError(strerror(errno));
+        }
+
+        struct stat fileInfo {};
+        if(fstat(handle, &fileInfo) == -1) {
+            throw FileStreamError(std::string("Error getting the file size: ") + strerror(errno));
+        }
+        fileSize = fileInfo.st_size;
+    #endif
+    }
+
+    ~AsyncFileImpl()
+    {
+        close();
+    }
+
+    void close()
+    {
+    #ifdef OS_WINDOWS
+        if(handle != INVALID_HANDLE_VALUE)
+        {
+            if(syncOnClose && mode != FileStream::Read) {
+                FlushFileBuffers(handle);
+            }
+
+            CloseHandle(handle);
+            handle = INVALID_HANDLE_VALUE;
+        }
+    #else
+        if(handle != -1)
+        {
+            if(syncOnClose && mode != FileStream::Read) {
+                fsync(handle);
+            }
+
+            ::close(handle);
+            handle = -1;
+        }
+    #endif
+    }
+
+    FileStream::Mode mode;
+    std::string filePath;
+    std::size_t fileSize = 0;
+    bool syncOnClose = true;
+#ifdef OS_WINDOWS
+    HANDLE handle = INVALID_HANDLE_VALUE;
+#else
+    int handle = -1;
+#endif
+};
+
+AsyncFile::AsyncFile(std::string filePath, FileStream::Mode mode) :
+    m_file(new AsyncFileImpl(std::move(filePath), mode))
+{}
+
+AsyncFile::~AsyncFile()
+{}
+
+std::size_t AsyncFile::size() const
+{
+    return m_file->fileSize;
+}
+
+const std::string& AsyncFile::path() const
+{
+    return m_file->filePath;
+}
+
+void AsyncFile::setSyncOnClose(bool sync)
+{
+    m_file->syncOnClose = sync;
+}
+
+void AsyncFile::close()
+{
+    m_file->close();
+}
+
+#ifdef OS_WINDOWS
+void* AsyncFile::handle() const
+#else
+int AsyncFile::handle() const
+#endif
+{
+    return m_file->handle;
+}
+
+
+/* AsyncIO */
+
+struct AsyncIO::Request
+{
+#ifdef OS_WINDOWS
+    OVERLAPPED ov;
+    HANDLE handle;
+#else
+    int fd;
+    struct iovec iov; // used by io_uring
+#endif
+    bool bWrite;
+    std::size_t offset;
+    byte_t* data;
+    std::size_t length;
+    std::size_t done; // number of transferred bytes
+    uint64_t tag;
+    int error;
+
+    std::size_t remaining() const
+    {
+        return std::min(length - done, kMaxTransferSize);
+    }
+};
+
+class AsyncIO::Engine
+{
+public:
+    virtual ~Engine() = default;
+    virtual Backend backend() const = 0;
+
+    /* Queues request, request can be submitted on next reap call */
+    virtual void submit(Request& req) = 0;
+
+    /* Submits queued requests and waits until at least minCompletions requests have finished.
+       Finished requests are appended to done. */
+    virtual void reap(std::vector<Request*>& done, std::size_t minCompletions) = 0;
+};
+
+namespace {
+
+    using Request = AsyncIO::Request;
+
+    inline void RecordTransfer(const Request& req, std::size_t n)
+    {
+        if(req.bWrite) {
+            LIBIM_STATS_ADD(AsyncBytesWritten, n);
+        }
+        else {
+            LIBIM_STATS_ADD(AsyncBytesRead, n);
+        }
+        (void)req; (void)n;
+    }
+
+    /* Transfers request with blocking positional I/O */
+    void BlockingTransfer(Request& req)
+    {
+        while(req.done < req.length)
+        {
+        #ifdef OS_WINDOWS
+            /* File is opened for overlapped I/O, wait for each transfer to finish */
+            std::memset(&req.ov, 0, sizeof(req.ov));
+            const uint64_t offset = req.offset + req.done;
+            req.ov.Offset     = static_cast<DWORD>(offset);
+            req.ov.OffsetHigh = static_cast<DWORD>(offset >> 32);
+            req.ov.hEvent     = CreateEventA(NULL, TRUE, FALSE, NULL);
+            if(!req.ov.hEvent)
+            {
+                req.error = GetLastError();
+                return;
+            }
+
+            DWORD n = 0;
+            const DWORD len = static_cast<DWORD>(req.remaining());
+            BOOL ok = req.bWrite ? WriteFile(req.handle, req.data + req.done, len, NULL, &req.ov)
+                                 : ReadFile(req.handle, req.data + req.done, len, NULL, &req.ov);
+            if(ok || GetLastError() == ERROR_IO_PENDING) {
+                ok = GetOverlappedResult(req.handle, &req.ov, &n, TRUE);
+            }
+
+            const DWORD error = ok ? 0 : GetLastError();
+            CloseHandle(req.ov.hEvent);
+            if(error == ERROR_HANDLE_EOF) {
+                return;
+            }
+            else if(error != 0)
+            {
+                req.error = error;
+                return;
+            }
+        #else
+            const auto offset = static_cast<off_t>(req.offset + req.done);
+            ssize_t n = req.bWrite ? ::pwrite(req.fd, req.data + req.done, req.remaining(), offset)
+                                   : ::pread(req.fd, req.data + req.done, req.remaining(), offset);
+            if(n == -1)
+            {
+                if(errno == EINTR) {
+                    continue;
+                }
+                req.error = errno;
+                return;
+            }
+        #endif
+
+            RecordTransfer(req, std::size_t(n));
+            if(n == 0) {
+                return; // end of file
+            }
+            req.done += std::size_t(n);
+        }
+    }
+
+
+    /* Fallback engine executing requests with blocking I/O on pool threads */
+    class ThreadPoolEngine final : public AsyncIO::Engine
+    {
+    public:
+        explicit ThreadPoolEngine(std::size_t numThreads) :
+            m_pool(numThreads)
+        {}
+
+        AsyncIO::Backend backend() const override
+        {
+            return AsyncIO::Backend::ThreadPool;
+        }
+
+        void submit(Request& req) override
+        {
+            m_pool.submit([this, &req]{
+                BlockingTransfer(req);
+
+                std::lock_guard<std::mutex> lock(m_mutex);
+                m_done.push_back(&req);
+                m_cvDone.notify_one();
+            });
+        }
+
+        void reap(std::vector<Request*>& done, std::size_t minCompletions) override
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_cvDone.wait(lock, [&]{ return m_done.size() >= minCompletions; });
+            done.insert(done.end(), m_done.begin(), m_done.end());
+            m_done.clear();
+        }
+
+    private:
+        std::mutex m_mutex;
+        std::condition_variable m_cvDone;
+        std::vector<Request*> m_done;
+        libim::ThreadPool m_pool; // destroyed first, workers use the members above
+    };
+
+
+#ifdef ASYNCIO_IO_URING
+    /* io_uring engine using raw system calls, so no liburing is required */
+    class IoUringEngine final : public AsyncIO::Engine
+    {
+    public:
+        /* Returns nullptr if io_uring is not available */
+        static std::unique_ptr<IoUringEngine> Create(unsigned entries)
+        {
+            io_uring_params params {};
+            const int fd = static_cast<int>(syscall(__NR_io_uring_setup, entries, &params));
+            if(fd < 0) {
+                return nullptr;
+            }
+
+            std::unique_ptr<IoUringEngine> engine(new IoUringEngine(fd));
+            if(!engine->map(params)) {
+                return nullptr;
+            }
+            return engine;
+        }
+
+        ~IoUringEngine() override
+        {
+            if(m_sqes) {
+                munmap(m_sqes, m_sqesSize);
+            }
+            if(m_cqRing && m_cqRing != m_sqRing) {
+                munmap(m_cqRing, m_cqRingSize);
+            }
+            if(m_sqRing) {
+                munmap(m_sqRing, m_sqRingSize);
+            }
+            ::close(m_fd);
+        }
+
+        AsyncIO::Backend backend() const override
+        {
+            return AsyncIO::Backend::IoUring;
+        }
+
+        void submit(Request& req) override
+        {
+            const unsigned tail = *m_sqTail; // only this thread writes the tail
+            const unsigned idx  = tail & m_sqMask;
+
+            req.iov.iov_base = req.data + req.done;
+            req.iov.iov_len  = req.remaining();
+
+            io_uring_sqe& sqe = m_sqes[idx];
+            std::memset(&sqe, 0, sizeof(sqe));
+            sqe.opcode    = req.bWrite ? IORING_OP_WRITEV : IORING_OP_READV;
+            sqe.fd        = req.fd;
+            sqe.off       = req.offset + req.done;
+            sqe.addr      = reinterpret_cast<uint64_t>(&req.iov);
+            sqe.len       = 1;
+            sqe.user_data = reinterpret_cast<uint64_t>(&req);
+
+            m_sqArray[idx] = idx;
+            __atomic_store_n(m_sqTail, tail + 1, __ATOMIC_RELEASE);
+            m_nUnsubmitted++;
+        }
+
+        void reap(std::vector<Request*>& done, std::size_t minCompletions) override
+        {
+            std::size_t nDone = 0;
+            while(true)
+            {
+                nDone += consume(done);
+                if(nDone >= minCompletions && m_nUnsubmitted == 0) {
+                    return;
+                }
+
+                const unsigned nWait = nDone < minCompletions ? unsigned(minCompletions - nDone) : 0;
+                const int ret = static_cast<int>(syscall(__NR_io_uring_enter, m_fd, m_nUnsubmitted, nWait,
+                                                         nWait > 0 ? IORING_ENTER_GETEVENTS : 0, nullptr, 0));
+                LIBIM_STATS_ADD(AsyncSubmitSyscalls, 1);
+                if(ret < 0)
+                {
+                    if(errno == EINTR || errno == EAGAIN || errno == EBUSY) {
+                        continue;
+                    }
+                    throw FileStreamError("io_uring_enter failed: " + GetLastErrorAsString());
+                }
+                m_nUnsubmitted -= std::min<unsigned>(unsigned(ret), m_nUnsubmitted);
+            }
+        }
+
+    private:
+        explicit IoUringEngine(int fd) : m_fd(fd) {}
+
+        bool map(const io_uring_params& p)
+        {
+            m_sqRingSize = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+            m_cqRingSize = p.cq_off.cqes + p.cq_entries * sizeof(io_uring_cqe);
+            const bool bSingleMmap = (p.features & IORING_FEAT_SINGLE_MMAP) != 0;
+            if(bSingleMmap) {
+                m_sqRingSize = m_cqRingSize = std::max(m_sqRingSize, m_cqRingSize);
+            }
+
+            void* sq = mmap(nullptr, m_sqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_fd, IORING_OFF_SQ_RING);
+            if(sq == MAP_FAILED) {
+                return false;
+            }
+            m_sqRing = static_cast<char*>(sq);
+
+            if(bSingleMmap) {
+                m_cqRing = m_sqRing;
+            }
+            else
+            {
+                void* cq = mmap(nullptr, m_cqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_fd, IORING_OFF_CQ_RING);
+                if(cq == MAP_FAILED) {
+                    return false;
+                }
+                m_cqRing = static_cast<char*>(cq);
+            }
+
+            m_sqesSize = p.sq_entries * sizeof(io_uring_sqe);
+            void* sqes = mmap(nullptr, m_sqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_fd, IORING_OFF_SQES);
+            if(sqes == MAP_FAILED) {
+                return false;
+            }
+            m_sqes = static_cast<io_uring_sqe*>(sqes);
+
+            m_sqTail  = reinterpret_cast<unsigned*>(m_sqRing + p.sq_off.tail);
+            m_sqMask  = *reinterpret_cast<unsigned*>(m_sqRing + p.sq_off.ring_mask);
+            m_sqArray = reinterpret_cast<unsigned*>(m_sqRing + p.sq_off.array);
+            m_cqHead  = reinterpret_cast<unsigned*>(m_cqRing + p.cq_off.head);
+            m_cqTail  = reinterpret_cast<unsigned*>(m_cqRing + p.cq_off.tail);
+            m_cqMask  = *reinterpret_cast<unsigned*>(m_cqRing + p.cq_off.ring_mask);
+            m_cqes    = reinterpret_cast<io_uring_cqe*>(m_cqRing + p.cq_off.cqes);
+            return true;
+        }
+
+        /* Processes completion queue entries, partially transferred requests are resubmitted.
+           Returns number of finished requests. */
+        std::size_t consume(std::vector<Request*>& done)
+        {
+            std::size_t nDone = 0;
+            unsigned head = *m_cqHead;
+            const unsigned tail = __atomic_load_n(m_cqTail, __ATOMIC_ACQUIRE);
+            for(; head != tail; head++)
+            {
+                const io_uring_cqe& cqe = m_cqes[head & m_cqMask];
+                Request& req = *reinterpret_cast<Request*>(cqe.user_data);
+                const int res = cqe.res;
+
+                if(res < 0)
+                {
+                    if(res == -EAGAIN || res == -EINTR)
+                    {
+                        submit(req);
+                        continue;
+                    }
+                    req.error = -res;
+                }
+                else
+                {
+                    RecordTransfer(req, std::size_t(res));
+                    req.done += std::size_t(res);
+                    if(res > 0 && req.done < req.length)
+                    {
+                        submit(req); // short transfer
+                        continue;
+                    }
+                }
+
+                done.push_back(&req);
+                nDone++;
+            }
+
+            __atomic_store_n(m_cqHead, head, __ATOMIC_RELEASE);
+            return nDone;
+        }
+
+    private:
+        int m_fd;
+        char* m_sqRing = nullptr;
+        char* m_cqRing = nullptr;
+        std::size_t m_sqRingSize = 0;
+        std::size_t m_cqRingSize = 0;
+        io_uring_sqe* m_sqes = nullptr;
+        std::size_t m_sqesSize = 0;
+
+        unsigned* m_sqTail  = nullptr;
+        unsigned  m_sqMask  = 0;
+        unsigned* m_sqArray = nullptr;
+        unsigned* m_cqHead  = nullptr;
+        unsigned* m_cqTail  = nullptr;
+        unsigned  m_cqMask  = 0;
+        io_uring_cqe* m_cqes = nullptr;
+        unsigned  m_nUnsubmitted = 0;
+    };
+#endif // ASYNCIO_IO_URING
+
+
+#ifdef OS_WINDOWS
+    /* Overlapped I/O engine, completions are delivered to I/O completion port */
+    class IocpEngine final : public AsyncIO::Engine
+    {
+    public:
+        /* Returns nullptr if completion port can't be created */
+        static std::unique_ptr<IocpEngine> Create()
+        {
+            HANDLE port = CreateIoCompletionPort(INVALID_HANDLE_VALUE, NULL, 0, 1);
+            if(!port) {
+                return nullptr;
+            }
+            return std::unique_ptr<IocpEngine>(new IocpEngine(port));
+        }
+
+        ~IocpEngine() override
+        {
+            CloseHandle(m_port);
+        }
+
+        AsyncIO::Backend backend() const override
+        {
+            return AsyncIO::Backend::Iocp;
+        }
+
+        void submit(Request& req) override
+        {
+            m_queued.push_back(&req);
+        }
+
+        void reap(std::vector<Request*>& done, std::size_t minCompletions) override
+        {
+            for(auto req : m_queued) {
+                issue(*req);
+            }
+            m_queued.clear();
+
+            std::size_t nDone = m_failed.size();
+            done.insert(done.end(), m_failed.begin(), m_failed.end());
+            m_failed.clear();
+
+            while(true)
+            {
+                DWORD n = 0;
+                ULONG_PTR key = 0;
+                LPOVERLAPPED ov = nullptr;
+                const BOOL ok = GetQueuedCompletionStatus(m_port, &n, &key, &ov, nDone < minCompletions ? INFINITE : 0);
+                if(!ov)
+                {
+                    if(nDone >= minCompletions) {
+                        return; // no more completions
+                    }
+                    throw FileStreamError("GetQueuedCompletionStatus failed: " + GetLastErrorAsString());
+                }
+
+                Request& req = *CONTAINING_RECORD(ov, Request, ov);
+                const DWORD error = ok ? 0 : GetLastError();
+                if(error != 0 && error != ERROR_HANDLE_EOF) {
+                    req.error = static_cast<int>(error);
+                }
+                else
+                {
+                    RecordTransfer(req, n);
+                    req.done += n;
+                    if(error == 0 && n > 0 && req.done < req.length)
+                    {
+                        issue(req); // short transfer
+                        std::size_t nFailed = m_failed.size();
+                        done.insert(done.end(), m_failed.begin(), m_failed.end());
+                        m_failed.clear();
+                        nDone += nFailed;
+                        continue;
+                    }
+                }
+
+                done.push_back(&req);
+                nDone++;
+            }
+        }
+
+    private:
+        explicit IocpEngine(HANDLE port) : m_port(port) {}
+
+        void issue(Request& req)
+        {
+            if(m_associated.insert(req.handle).second &&
+               !CreateIoCompletionPort(req.handle, m_port, 0, 0))
+            {
+                m_associated.erase(req.handle);
+                req.error = static_cast<int>(GetLastError());
+                m_failed.push_back(&req);
+                return;
+            }
+
+            std::memset(&req.ov, 0, sizeof(req.ov));
+            const uint64_t offset = req.offset + req.done;
+            req.ov.Offset     = static_cast<DWORD>(offset);
+            req.ov.OffsetHigh = static_cast<DWORD>(offset >> 32);
+
+            const DWORD len = static_cast<DWORD>(req.remaining());
+            const BOOL ok = req.bWrite ? WriteFile(req.handle, req.data + req.done, len, NULL, &req.ov)
+                                       : ReadFile(req.handle, req.data + req.done, len, NULL, &req.ov);
+            if(!ok)
+            {
+                const DWORD error = GetLastError();
+                if(error == ERROR_IO_PENDING) {
+                    return;
+                }
+
+                /* Request failed immediately, no completion packet is queued */
+                if(error != ERROR_HANDLE_EOF) {
+                    req.error = static_cast<int>(error);
+                }
+                m_failed.push_back(&req);
+            }
+            // On success completion packet is queued as well
+        }
+
+    private:
+        HANDLE m_port;
+        std::unordered_set<HANDLE> m_associated;
+        std::vector<Request*> m_queued;
+        std::vector<Request*> m_failed; // requests finished without completion packet
+    };
+#endif // OS_WINDOWS
+}
+
+AsyncIO::AsyncIO(std::size_t queueDepth, bool useNative)
+{
+    queueDepth = std::max<std::size_t>(queueDepth, 1);
+    if(useNative)
+    {
+    #if defined(ASYNCIO_IO_URING)
+        m_engine = IoUringEngine::Create(static_cast<unsigned>(queueDepth));
+    #elif defined(OS_WINDOWS)
+        m_engine = IocpEngine::Create();
+    #endif
+    }
+
+    if(!m_engine) {
+        m_engine.reset(new ThreadPoolEngine(std::min<std::size_t>(queueDepth, 64)));
+    }
+
+    m_requests.reset(new Request[queueDepth]);
+    m_queueDepth = queueDepth;
+    m_free.reserve(queueDepth);
+    for(std::size_t i = queueDepth; i > 0; i--) {
+        m_free.push_back(i - 1);
+    }
+}
+
+AsyncIO::~AsyncIO()
+{
+    drain();
+}
+
+AsyncIO::Backend AsyncIO::backend() const
+{
+    return m_engine->backend();
+}
+
+const char* AsyncIO::GetBackendName(Backend backend)
+{
+    switch (backend)
+    {
+    case Backend::IoUring:    return "io_uring";
+    case Backend::Iocp:       return "iocp";
+    case Backend::ThreadPool: return "thread_pool";
+    }
+    return "unknown";
+}
+
+std::size_t AsyncIO::queueDepth() const
+{
+    return m_queueDepth;
+}
+
+std::size_t AsyncIO::inFlight() const
+{
+    return m_inFlight;
+}
+
+void AsyncIO::read(const AsyncFile& file, std::size_t offset, byte_t* data, std::size_t length, uint64_t tag)
+{
+    Request req {};
+    req.bWrite = false;
+#ifdef OS_WINDOWS
+    req.handle = file.handle();
+#else
+    req.fd = file.handle();
+#endif
+    req.offset = offset;
+    req.data   = data;
+    req.length = length;
+    req.tag    = tag;
+    queue(req);
+}
+
+void AsyncIO::write(const AsyncFile& file, std::size_t offset, const byte_t* data, std::size_t length, uint64_t tag)
+{
+    Request req {};
+    req.bWrite = true;
+#ifdef OS_WINDOWS
+    req.handle = file.handle();
+#else
+    req.fd = file.handle();
+#endif
+    req.offset = offset;
+    req.data   = const_cast<byte_t*>(data); // data is only read from
+    req.length = length;
+    req.tag    = tag;
+    queue(req);
+}
+
+void AsyncIO::queue(Request req)
+{
+    if(m_free.empty()) {
+        throw std::logic_error("AsyncIO queue is full");
+    }
+
+    const std::size_t idx = m_free.back();
+    m_free.pop_back();
+    m_requests[idx] = req;
+    m_inFlight++;
+    LIBIM_STATS_ADD(AsyncRequests, 1);
+    m_engine->submit(m_requests[idx]);
+}
+
+std::size_t AsyncIO::wait(std::vector<Completion>& completions, std::size_t minCompletions)
+{
+    std::vector<Request*> done;
+    m_engine->reap(done, std::min(minCompletions, m_inFlight));
+
+    for(auto req : done)
+    {
+        completions.push_back({ req->tag, req->done, req->error });
+        m_free.push_back(static_cast<std::size_t>(req - m_requests.get()));
+        m_inFlight--;
+    }
+
+    return done.size();
+}
+
+void AsyncIO::drain() noexcept
+{
+    try
+    {
+        std::vector<Completion> completions;
+        while(m_inFlight > 0) {
+            wait(completions, m_inFlight);
+        }
+    }
+    catch(...) {}
+}
+
+
+/* AsyncCopyPipeline */
+
+struct AsyncCopyPipeline::Job
+{
+    const AsyncFile* src;
+    std::size_t srcOffset;
+    const AsyncFile* dst;
+    std::size_t dstOffset;
+    const byte_t* data; // data of write job, nullptr for copy job
+    std::size_t length;
+    std::size_t issued    = 0;
+    std::size_t completed = 0;
+    Callback onDone;
+};
+
+struct AsyncCopyPipeline::Transfer
+{
+    static constexpr std::size_t NoBuffer = std::numeric_limits<std::size_t>::max();
+
+    Job* job = nullptr;
+    std::size_t offset = 0; // offset in job
+    std::size_t length = 0;
+    std::size_t buffer = NoBuffer;
+    bool reading = false;
+};
+
+AsyncCopyPipeline::AsyncCopyPipeline(AsyncIO& aio, std::size_t chunkSize) :
+    m_aio(aio),
+    m_chunkSize(std::max<std::size_t>(chunkSize, 4096)),
+    m_maxQueued(4 * aio.queueDepth()),
+    m_transfers(aio.queueDepth()),
+    m_buffers(std::max<std::size_t>(aio.queueDepth() / 2, 1))
+{
+    for(std::size_t i = m_transfers.size(); i > 0; i--) {
+        m_freeTransfers.push_back(i - 1);
+    }
+
+    for(std::size_t i = m_buffers.size(); i > 0; i--) {
+        m_freeBuffers.push_back(i - 1);
+    }
+}
+
+AsyncCopyPipeline::~AsyncCopyPipeline()
+{
+    m_aio.drain(); // transfers in flight use pipeline buffers
+}
+
+void AsyncCopyPipeline::copy(const AsyncFile& src, std::size_t srcOffset, const AsyncFile& dst, std::size_t dstOffset, std::size_t length, Callback onDone)
+{
+    std::unique_ptr<Job> job(new Job { &src, srcOffset, &dst, dstOffset, nullptr, length, 0, 0, std::move(onDone) });
+    enqueue(std::move(job));
+}
+
+void AsyncCopyPipeline::write(const AsyncFile& dst, std::size_t dstOffset, const byte_t* data, std::size_t length, Callback onDone)
+{
+    std::unique_ptr<Job> job(new Job { nullptr, 0, &dst, dstOffset, data, length, 0, 0, std::move(onDone) });
+    enqueue(std::move(job));
+}
+
+void AsyncCopyPipeline::finish()
+{
+    issue();
+    while(!m_jobs.empty()) {
+        pump();
+    }
+}
+
+void AsyncCopyPipeline::enqueue(std::unique_ptr<Job> job)
+{
+    if(job->length == 0)
+    {
+        if(job->onDone) {
+            job->onDone();
+        }
+        return;
+    }
+
+    m_jobs.push_back(std::move(job));
+    issue();
+    while(m_jobs.size() > m_maxQueued) {
+        pump();
+    }
+}
+
+void AsyncCopyPipeline::issue()
+{
+    while(m_nextJob < m_jobs.size() && !m_freeTransfers.empty())
+    {
+        Job& job = *m_jobs[m_nextJob];
+        Transfer t;
+        t.job    = &job;
+        t.offset = job.issued;
+
+        if(job.data)
+        {
+            /* Write job data directly from caller's memory */
+            t.length = std::min(job.length - job.issued, 16 * m_chunkSize);
+            m_aio.write(*job.dst, job.dstOffset + t.offset, job.data + t.offset, t.length, m_freeTransfers.back());
+        }
+        else
+        {
+            if(m_freeBuffers.empty()) {
+                break;
+            }
+
+            t.buffer  = m_freeBuffers.back();
+            t.length  = std::min(job.length - job.issued, m_chunkSize);
+            t.reading = true;
+
+            auto& buffer = m_buffers[t.buffer];
+            if(buffer.size() < m_chunkSize) {
+                buffer.resize(m_chunkSize);
+            }
+
+            m_aio.read(*job.src, job.srcOffset + t.offset, buffer.data(), t.length, m_freeTransfers.back());
+            m_freeBuffers.pop_back();
+        }
+
+        m_transfers[m_freeTransfers.back()] = t;
+        m_freeTransfers.pop_back();
+
+        job.issued += t.length;
+        if(job.issued == job.length) {
+            m_nextJob++;
+        }
+    }
+}
+
+void AsyncCopyPipeline::pump()
+{
+    if(m_aio.inFlight() == 0)
+    {
+        issue();
+        if(m_aio.inFlight() == 0) {
+            throw std::logic_error("AsyncCopyPipeline: no transfer can be issued");
+        }
+    }
+
+    m_completions.clear();
+    m_aio.wait(m_completions, 1);
+    for(const auto& c : m_completions) {
+        complete(c);
+    }
+
+    /* Remove finished jobs from the front of the queue */
+    while(!m_jobs.empty() && m_jobs.front()->completed == m_jobs.front()->length)
+    {
+        m_jobs.pop_front();
+        m_nextJob--;
+    }
+
+    issue();
+}
+
+void AsyncCopyPipeline::complete(const AsyncIO::Completion& c)
+{
+    const std::size_t idx = static_cast<std::size_t>(c.tag);
+    Transfer& t = m_transfers[idx];
+    Job& job = *t.job;
+
+    if(c.error != 0)
+    {
+        const std::string path = t.reading ? job.src->path() : job.dst->path();
+        throw FileStreamError("Failed to " + std::string(t.reading ? "read from" : "write to") + " file " + path + ": " + ErrorString(c.error));
+    }
+
+    if(c.size != t.length)
+    {
+        throw FileStreamError(t.reading ? "Unexpected end of file: " + job.src->path()
+                                        : "Not all data was written to file: " + job.dst->path());
+    }
+
+    if(t.reading)
+    {
+        /* Write the chunk, the slot of the finished read is reused */
+        t.reading = false;
+        m_aio.write(*job.dst, job.dstOffset + t.offset, m_buffers[t.buffer].data(), t.length, c.tag);
+        return;
+    }
+
+    if(t.buffer != Transfer::NoBuffer) {
+        m_freeBuffers.push_back(t.buffer);
+    }
+    m_freeTransfers.push_back(idx);
+
+    job.completed += t.length;
+    if(job.completed == job.length && job.onDone)
+    {
+        auto onDone = std::move(job.onDone);
+        job.onDone = nullptr;
+        onDone();
+    }
+}
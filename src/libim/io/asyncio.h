@@ -0,0 +1,164 @@
+#ifndef ASYNCIO_H
+#define ASYNCIO_H
+#include "filestream.h"
+#include "common.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+/* File opened for positional asynchronous I/O with AsyncIO.
+   Files opened in Write mode are truncated. */
+class AsyncFile
+{
+public:
+    AsyncFile(std::string filePath, FileStream::Mode mode);
+    ~AsyncFile();
+
+    AsyncFile(const AsyncFile&) = delete;
+    AsyncFile& operator = (const AsyncFile&) = delete;
+
+    /* Returns file size at the time file was opened */
+    std::size_t size() const;
+    const std::string& path() const;
+
+    /* Sets whether written data is flushed to the storage device when file is closed. Default is true. */
+    void setSyncOnClose(bool sync);
+    void close();
+
+#ifdef OS_WINDOWS
+    void* handle() const;
+#else
+    int handle() const;
+#endif
+
+private:
+    struct AsyncFileImpl;
+    std::unique_ptr<AsyncFileImpl> m_file;
+};
+
+
+/* Queue of positional file reads and writes executed asynchronously.
+   Requests are executed by io_uring on Linux, by overlapped I/O and completion port on Windows
+   and by a pool of threads doing blocking positional I/O elsewhere, or when the native
+   API is not available (e.g. io_uring disabled by seccomp).
+   A request transfers all bytes unless it fails or a read reaches the end of file.
+   AsyncIO is not thread safe, requests are issued and completions reaped from one thread. */
+class AsyncIO
+{
+public:
+    static constexpr std::size_t DEFAULT_QUEUE_DEPTH = 32;
+
+    enum class Backend
+    {
+        IoUring,
+        Iocp,
+        ThreadPool
+    };
+
+    struct Completion
+    {
+        uint64_t tag;
+        std::size_t size; // number of transferred bytes
+        int error;        // 0 on success, otherwise errno or GetLastError code
+    };
+
+    /* Creates queue with up to queueDepth requests in flight.
+       If useNative is false the thread pool backend is used. */
+    explicit AsyncIO(std::size_t queueDepth = DEFAULT_QUEUE_DEPTH, bool useNative = true);
+
+    /* Waits for the requests in flight to finish */
+    ~AsyncIO();
+
+    AsyncIO(const AsyncIO&) = delete;
+    AsyncIO& operator = (const AsyncIO&) = delete;
+
+    Backend backend() const;
+    static const char* GetBackendName(Backend backend);
+
+    std::size_t queueDepth() const;
+    std::size_t inFlight() const;
+
+    /* Queues read or write request identified by tag. Data must stay valid until the request completes.
+       Requests are submitted on the next wait call. Throws std::logic_error if queue is full. */
+    void read(const AsyncFile& file, std::size_t offset, byte_t* data, std::size_t length, uint64_t tag);
+    void write(const AsyncFile& file, std::size_t offset, const byte_t* data, std::size_t length, uint64_t tag);
+
+    /* Submits queued requests and waits until at least minCompletions requests
+       (at most the number of requests in flight) have completed. Completed requests are appended to completions. */
+    std::size_t wait(std::vector<Completion>& completions, std::size_t minCompletions = 1);
+
+    /* Waits for all requests in flight, their completions are discarded */
+    void drain() noexcept;
+
+public:
+    struct Request;
+    class Engine;
+
+private:
+    void queue(Request req);
+
+private:
+    std::unique_ptr<Request[]> m_requests;
+    std::size_t m_queueDepth;
+    std::vector<std::size_t> m_free; // free request slots
+    std::unique_ptr<Engine> m_engine;
+    std::size_t m_inFlight = 0;
+};
+
+
+/* Copies file ranges through a pool of chunk buffers with AsyncIO. Reads of the next chunks
+   are in flight while previous chunks are written, so reading and writing overlap.
+   Queued jobs are executed in order they were queued, the number of jobs waiting
+   to be executed is bounded so queuing blocks while the pipeline is full. */
+class AsyncCopyPipeline
+{
+public:
+    static constexpr std::size_t DEFAULT_CHUNK_SIZE = 1024 * 1024;
+
+    using Callback = std::function<void()>;
+
+    /* Data of the copy jobs is read into queueDepth / 2 chunk buffers of chunkSize bytes */
+    explicit AsyncCopyPipeline(AsyncIO& aio, std::size_t chunkSize = DEFAULT_CHUNK_SIZE);
+    ~AsyncCopyPipeline();
+
+    AsyncCopyPipeline(const AsyncCopyPipeline&) = delete;
+    AsyncCopyPipeline& operator = (const AsyncCopyPipeline&) = delete;
+
+    /* Queues copy of length bytes from src at srcOffset to dst at dstOffset.
+       Files must stay open until onDone is called. */
+    void copy(const AsyncFile& src, std::size_t srcOffset, const AsyncFile& dst, std::size_t dstOffset, std::size_t length, Callback onDone = nullptr);
+
+    /* Queues write of length bytes of data to dst at dstOffset. Data must stay valid until onDone is called. */
+    void write(const AsyncFile& dst, std::size_t dstOffset, const byte_t* data, std::size_t length, Callback onDone = nullptr);
+
+    /* Waits for all queued jobs to finish. Throws FileStreamError if any job failed. */
+    void finish();
+
+private:
+    struct Job;
+    struct Transfer;
+
+    void enqueue(std::unique_ptr<Job> job);
+    void issue();
+    void pump();
+    void complete(const AsyncIO::Completion& c);
+
+private:
+    AsyncIO& m_aio;
+    std::size_t m_chunkSize;
+    std::size_t m_maxQueued;
+    std::deque<std::unique_ptr<Job>> m_jobs; // jobs not finished yet, in queue order
+    std::size_t m_nextJob = 0;               // index of the first job with bytes not issued yet
+    std::vector<Transfer> m_transfers;
+    std::vector<std::size_t> m_freeTransfers;
+    std::vector<ByteArray> m_buffers;
+    std::vector<std::size_t> m_freeBuffers;
+    std::vector<AsyncIO::Completion> m_completions;
+};
+
+#endif // ASYNCIO_H
@@ -0,0 +1,219 @@
+#include "bufferedstream.h"
+
+#include <algorithm>
+#include <cstring>
+
+BufferedInputStream::BufferedInputStream(StreamPtr<Stream> stream, std::size_t blockSize) :
+    m_stream(std::move(stream)),
+    m_buffer(std::max<std::size_t>(blockSize, 1))
+{
+    if(!m_stream) {
+        throw StreamError("BufferedInputStream: stream is null!");
+    }
+
+    m_pos = m_stream->tell();
+    this->setName(m_stream->name());
+}
+
+void BufferedInputStream::seek(std::size_t position) const
+{
+    if(position > m_stream->size()) {
+        throw StreamError("BufferedInputStream: failed to seek to position: position out of range");
+    }
+
+    m_pos = position;
+}
+
+std::size_t BufferedInputStream::size() const
+{
+    return m_stream->size();
+}
+
+std::size_t BufferedInputStream::tell() const
+{
+    return m_pos;
+}
+
+bool BufferedInputStream::canRead() const
+{
+    return m_stream->canRead();
+}
+
+bool BufferedInputStream::canWrite() const
+{
+    return false;
+}
+
+const StreamPtr<Stream>& BufferedInputStream::stream() const
+{
+    return m_stream;
+}
+
+bool BufferedInputStream::fill() const
+{
+    const std::size_t nLeft = m_stream->size() - std::min(m_pos, m_stream->size());
+    const std::size_t nRead = std::min(m_buffer.size(), nLeft);
+    if(nRead == 0) {
+        return false;
+    }
+
+    if(m_stream->tell() != m_pos) {
+        m_stream->seek(m_pos);
+    }
+
+    m_bufOffset = m_pos;
+    m_bufSize   = m_stream->read(m_buffer.data(), nRead);
+    return m_bufSize > 0;
+}
+
+std::size_t BufferedInputStream::readsome(byte_t* data, std::size_t length) const
+{
+    std::size_t nTotal = 0;
+    while(length > 0)
+    {
+        /* Copy from buffer if position is in buffered block */
+        if(m_pos >= m_bufOffset && m_pos < m_bufOffset + m_bufSize)
+        {
+            const std::size_t bufPos = m_pos - m_bufOffset;
+            const std::size_t nCopy  = std::min(length, m_bufSize - bufPos);
+            std::memcpy(data, m_buffer.data() + bufPos, nCopy);
+
+            data   += nCopy;
+            length -= nCopy;
+            nTotal += nCopy;
+            m_pos  += nCopy;
+            continue;
+        }
+
+        /* Read large chunks directly from the underlying stream */
+        if(length >= m_buffer.size())
+        {
+            const std::size_t nLeft = m_stream->size() - std::min(m_pos, m_stream->size());
+            const std::size_t nRead = std::min(length, nLeft);
+            if(nRead == 0) {
+                break;
+            }
+
+            if(m_stream->tell() != m_pos) {
+                m_stream->seek(m_pos);
+            }
+
+            const std::size_t n = m_stream->read(data, nRead);
+            nTotal += n;
+            m_pos  += n;
+            break;
+        }
+
+        if(!fill()) {
+            break;
+        }
+    }
+
+    return nTotal;
+}
+
+std::size_t BufferedInputStream::readsomeAt(std::size_t offset, byte_t* data, std::size_t length) const
+{
+    return m_stream->readAt(offset, data, length);
+}
+
+std::size_t BufferedInputStream::writesome(const byte_t* /*data*/, std::size_t /*length*/)
+{
+    throw StreamError("Cannot write to BufferedInputStream!");
+}
+
+
+
+BufferedOutputStream::BufferedOutputStream(StreamPtr<Stream> stream, std::size_t blockSize) :
+    m_stream(std::move(stream)),
+    m_buffer(std::max<std::size_t>(blockSize, 1))
+{
+    if(!m_stream) {
+        throw StreamError("BufferedOutputStream: stream is null!");
+    }
+
+    this->setName(m_stream->name());
+}
+
+BufferedOutputStream::~BufferedOutputStream()
+{
+    try {
+        flush();
+    }
+    catch(const std::exception& e) {
+        std::cerr << "BufferedOutputStream: failed to flush data to stream '" << name() << "': " << e.what() << std::endl;
+    }
+}
+
+Stream& BufferedOutputStream::write(const Stream& istream, std::size_t offset, std::size_t length, ByteArray& buffer)
+{
+    flush();
+    m_stream->write(istream, offset, length, buffer);
+    return *this;
+}
+
+void BufferedOutputStream::seek(std::size_t position) const
+{
+    flush();
+    m_stream->seek(position);
+}
+
+std::size_t BufferedOutputStream::size() const
+{
+    return std::max(m_stream->size(), tell());
+}
+
+std::size_t BufferedOutputStream::tell() const
+{
+    return m_stream->tell() + m_bufSize;
+}
+
+bool BufferedOutputStream::canRead() const
+{
+    return false;
+}
+
+bool BufferedOutputStream::canWrite() const
+{
+    return m_stream->canWrite();
+}
+
+void BufferedOutputStream::flush() const
+{
+    if(m_bufSize == 0) {
+        return;
+    }
+
+    const std::size_t nWritten = m_stream->write(m_buffer.data(), m_bufSize);
+    if(nWritten != m_bufSize) {
+        throw StreamError("BufferedOutputStream: failed to write buffered data to stream!");
+    }
+
+    m_bufSize = 0;
+}
+
+const StreamPtr<Stream>& BufferedOutputStream::stream() const
+{
+    return m_stream;
+}
+
+std::size_t BufferedOutputStream::readsome(byte_t* /*data*/, std::size_t /*length*/) const
+{
+    throw StreamError("Cannot read from BufferedOutputStream!");
+}
+
+std::size_t BufferedOutputStream::writesome(const byte_t* data, std::size_t length)
+{
+    /* Large writes go straight to the underlying stream */
+    if(m_bufSize + length > m_buffer.size()) {
+        flush();
+    }
+
+    if(length >= m_buffer.size()) {
+        return m_stream->write(data, length);
+    }
+
+    std::memcpy(m_buffer.data() + m_bufSize, data, length);
+    m_bufSize += length;
+    return length;
+}
@@ -0,0 +1,81 @@
+#ifndef BUFFEREDSTREAM_H
+#define BUFFEREDSTREAM_H
+#include "stream.h"
+#include "common.h"
+
+#include <memory>
+
+static constexpr std::size_t BUFFERED_STREAM_BLOCK_SIZE = 64 * 1024; // default block size
+
+/* Input stream decorator which reads underlying stream in blocks of blockSize bytes,
+   so that many small reads (e.g. of POD types) don't each end up as separate read of
+   the underlying stream. Reads which are larger than block size bypass the buffer. */
+class BufferedInputStream final : public InputStream
+{
+public:
+    explicit BufferedInputStream(StreamPtr<Stream> stream, std::size_t blockSize = BUFFERED_STREAM_BLOCK_SIZE);
+    virtual ~BufferedInputStream() = default;
+
+    virtual void seek(std::size_t position) const override;
+    virtual std::size_t size() const override;
+    virtual std::size_t tell() const override;
+    virtual bool canRead() const override;
+    virtual bool canWrite() const override;
+
+    const StreamPtr<Stream>& stream() const;
+
+protected:
+    virtual std::size_t readsome(byte_t* data, std::size_t length) const override;
+    virtual std::size_t writesome(const byte_t* data, std::size_t length) override;
+
+    /* Reads underlying stream at offset, the buffer is bypassed */
+    virtual std::size_t readsomeAt(std::size_t offset, byte_t* data, std::size_t length) const override;
+
+private:
+    bool fill() const;
+
+private:
+    StreamPtr<Stream> m_stream;
+    mutable ByteArray m_buffer;
+    mutable std::size_t m_bufOffset = 0; // position of buffered block in underlying stream
+    mutable std::size_t m_bufSize   = 0; // number of valid bytes in buffer
+    mutable std::size_t m_pos       = 0;
+};
+
+
+/* Output stream decorator which gathers small writes into blocks of blockSize bytes
+   before writing them to the underlying stream. Buffered data is written out on flush(),
+   seek() and when the stream is destroyed. */
+class BufferedOutputStream final : public OutputStream
+{
+public:
+    explicit BufferedOutputStream(StreamPtr<Stream> stream, std::size_t blockSize = BUFFERED_STREAM_BLOCK_SIZE);
+    virtual ~BufferedOutputStream();
+
+    using Stream::write;
+
+    /* Flushes buffered data and forwards copy to the underlying stream */
+    virtual Stream& write(const Stream& istream, std::size_t offset, std::size_t length, ByteArray& buffer) override;
+
+    virtual void seek(std::size_t position) const override;
+    virtual std::size_t size() const override;
+    virtual std::size_t tell() const override;
+    virtual bool canRead() const override;
+    virtual bool canWrite() const override;
+
+    /* Writes buffered data to the underlying stream */
+    void flush() const;
+
+    const StreamPtr<Stream>& stream() const;
+
+protected:
+    virtual std::size_t readsome(byte_t* data, std::size_t length) const override;
+    virtual std::size_t writesome(const byte_t* data, std::size_t length) override;
+
+private:
+    StreamPtr<Stream> m_stream;
+    mutable ByteArray m_buffer;
+    mutable std::size_t m_bufSize = 0;
+};
+
+#endif // BUFFEREDSTREAM_H
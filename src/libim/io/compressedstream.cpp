@@ -0,0 +1,531 @@
+#include "compressedstream.h"
+#include "mappedfilestream.h"
+#include "../utils/stats.h"
+#include "../utils/threadpool.h"
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <limits>
+#include <vector>
+
+#ifdef LIBIM_HAVE_ZLIB
+#  include <zlib.h>
+#endif
+#ifdef LIBIM_HAVE_ZSTD
+#  include <zstd.h>
+#endif
+#ifdef LIBIM_HAVE_LZ4
+#  include <lz4.h>
+#endif
+
+namespace {
+    constexpr std::array<char, 4> SIGNATURE = {{'L','I','M','Z'}};
+    constexpr uint16_t VERSION = 1;
+    constexpr uint32_t CHUNK_STORED = 0x1; // chunk data is not compressed
+
+    struct Header
+    {
+        std::array<char, 4> signature;
+        uint16_t version;
+        uint16_t codec;
+        uint32_t chunkSize;
+        uint32_t numChunks;
+        uint64_t size;        // uncompressed size
+        uint64_t indexOffset; // offset of chunk index
+    };
+    static_assert(sizeof(Header) == 32, "Header size != 32");
+
+    struct ChunkEntry
+    {
+        uint64_t offset;
+        uint32_t size;  // compressed size
+        uint32_t flags;
+    };
+    static_assert(sizeof(ChunkEntry) == 16, "ChunkEntry size != 16");
+
+    /* Compresses src to dst. Returns false if codec failed or compressed chunk is not smaller than src. */
+    bool Compress(CompressionCodec codec, int level, const byte_t* src, std::size_t size, ByteArray& dst)
+    {
+        switch(codec)
+        {
+#ifdef LIBIM_HAVE_ZLIB
+        case CompressionCodec::Zlib:
+        {
+            uLongf dstSize = compressBound(uLong(size));
+            dst.resize(dstSize);
+            if(compress2(dst.data(), &dstSize, src, uLong(size), level != 0 ? level : Z_DEFAULT_COMPRESSION) != Z_OK) {
+                return false;
+            }
+            dst.resize(dstSize);
+            break;
+        }
+#endif
+#ifdef LIBIM_HAVE_ZSTD
+        case CompressionCodec::Zstd:
+        {
+            dst.resize(ZSTD_compressBound(size));
+            const std::size_t dstSize = ZSTD_compress(dst.data(), dst.size(), src, size, level != 0 ? level : 3);
+            if(ZSTD_isError(dstSize)) {
+                return false;
+            }
+            dst.resize(dstSize);
+            break;
+        }
+#endif
+#ifdef LIBIM_HAVE_LZ4
+        case CompressionCodec::Lz4:
+        {
+            dst.resize(std::size_t(LZ4_compressBound(int(size))));
+            const int dstSize = LZ4_compress_fast(reinterpret_cast<const char*>(src), reinterpret_cast<char*>(dst.data()),
+                                                  int(size), int(dst.size()), level > 0 ? level : 1); // level = acceleration
+            if(dstSize <= 0) {
+                return false;
+            }
+            dst.resize(std::size_t(dstSize));
+            break;
+        }
+#endif
+        default:
+            (void)level; (void)src;
+            return false;
+        }
+
+        return dst.size() < size;
+    }
+
+    /* Decompresses src to dst of exactly dstSize bytes. Throws StreamError on error. */
+    void Decompress(CompressionCodec codec, const byte_t* src, std::size_t size, byte_t* dst, std::size_t dstSize)
+    {
+        bool bSuccess = false;
+        switch(codec)
+        {
+#ifdef LIBIM_HAVE_ZLIB
+        case CompressionCodec::Zlib:
+        {
+            uLongf nOut = uLongf(dstSize);
+            bSuccess = uncompress(dst, &nOut, src, uLong(size)) == Z_OK && nOut == dstSize;
+            break;
+        }
+#endif
+#ifdef LIBIM_HAVE_ZSTD
+        case CompressionCodec::Zstd:
+            bSuccess = ZSTD_decompress(dst, dstSize, src, size) == dstSize;
+            break;
+#endif
+#ifdef LIBIM_HAVE_LZ4
+        case CompressionCodec::Lz4:
+            bSuccess = LZ4_decompress_safe(reinterpret_cast<const char*>(src), reinterpret_cast<char*>(dst), int(size), int(dstSize)) == int(dstSize);
+            break;
+#endif
+        default:
+            (void)src; (void)size; (void)dst;
+            break;
+        }
+
+        if(!bSuccess) {
+            throw StreamError(std::string("CompressedStream: failed to decompress ") + GetCodecName(codec) + " chunk!");
+        }
+    }
+}
+
+
+const char* GetCodecName(CompressionCodec codec)
+{
+    switch(codec)
+    {
+    case CompressionCodec::Store: return "store";
+    case CompressionCodec::Zlib:  return "zlib";
+    case CompressionCodec::Zstd:  return "zstd";
+    case CompressionCodec::Lz4:   return "lz4";
+    }
+    return "unknown";
+}
+
+bool GetCodecByName(const std::string& name, CompressionCodec& codec)
+{
+    for(auto c : { CompressionCodec::Store, CompressionCodec::Zlib, CompressionCodec::Zstd, CompressionCodec::Lz4 })
+    {
+        if(name == GetCodecName(c))
+        {
+            codec = c;
+            return true;
+        }
+    }
+    return false;
+}
+
+bool GetCodecLevelRange(CompressionCodec codec, int& minLevel, int& maxLevel)
+{
+    switch(codec)
+    {
+    case CompressionCodec::Zlib:
+        minLevel = 1;
+        maxLevel = 9;
+        return true;
+    case CompressionCodec::Zstd:
+        minLevel = 1;
+#ifdef LIBIM_HAVE_ZSTD
+        maxLevel = ZSTD_maxCLevel();
+#else
+        maxLevel = 22;
+#endif
+        return true;
+    case CompressionCodec::Lz4:
+        minLevel = 1;
+        maxLevel = 65537; // LZ4_ACCELERATION_MAX
+        return true;
+    default:
+        return false;
+    }
+}
+
+bool IsCodecLevelValid(CompressionCodec codec, int level)
+{
+    int minLevel = 0, maxLevel = 0;
+    return level == 0 || (GetCodecLevelRange(codec, minLevel, maxLevel) && level >= minLevel && level <= maxLevel);
+}
+
+bool IsCodecSupported(CompressionCodec codec)
+{
+    switch(codec)
+    {
+    case CompressionCodec::Store: return true;
+#ifdef LIBIM_HAVE_ZLIB
+    case CompressionCodec::Zlib:  return true;
+#endif
+#ifdef LIBIM_HAVE_ZSTD
+    case CompressionCodec::Zstd:  return true;
+#endif
+#ifdef LIBIM_HAVE_LZ4
+    case CompressionCodec::Lz4:   return true;
+#endif
+    default:
+        return false;
+    }
+}
+
+
+struct CompressedStream::Container
+{
+    StreamPtr<InputStream> stream;
+    const byte_t* data = nullptr; // memory mapped container or nullptr
+    Header header;
+    std::vector<ChunkEntry> chunks;
+};
+
+CompressedStream::CompressedStream(StreamPtr<InputStream> istream) :
+    m_buffer{ {}, std::numeric_limits<std::size_t>::max(), {} }
+{
+    if(!istream) {
+        throw StreamError("CompressedStream: stream is null!");
+    }
+
+    auto container = std::make_shared<Container>();
+    container->stream = std::move(istream);
+    auto& stream = *container->stream;
+
+    /* Read and verify header */
+    stream.seekBegin();
+    auto& header = container->header;
+    header = stream.read<Header>();
+    if(header.signature != SIGNATURE) {
+        throw StreamError("CompressedStream: unknown container signature!");
+    }
+
+    if(header.version != VERSION) {
+        throw StreamError("CompressedStream: wrong container version: " + std::to_string(header.version));
+    }
+
+    if(!IsCodecSupported(CompressionCodec(header.codec))) {
+        throw StreamError(std::string("CompressedStream: codec ") + GetCodecName(CompressionCodec(header.codec)) + " is not supported!");
+    }
+
+    const uint64_t nExpectedChunks = header.chunkSize > 0 ? (header.size + header.chunkSize - 1) / header.chunkSize : 0;
+    if(header.chunkSize == 0 || header.numChunks != nExpectedChunks ||
+       header.indexOffset + uint64_t(header.numChunks) * sizeof(ChunkEntry) > stream.size()) {
+        throw StreamError("CompressedStream: corrupted container header!");
+    }
+
+    /* Read and verify chunk index */
+    stream.seek(std::size_t(header.indexOffset));
+    container->chunks = stream.read<std::vector<ChunkEntry>>(header.numChunks);
+    for(const auto& chunk : container->chunks)
+    {
+        if(chunk.offset + chunk.size > header.indexOffset || chunk.size > header.chunkSize) {
+            throw StreamError("CompressedStream: chunk is out of container bounds!");
+        }
+    }
+
+    if(auto mfs = dynamic_cast<const MappedFileStream*>(container->stream.get())) {
+        container->data = mfs->data();
+    }
+
+    this->setName(container->stream->name());
+    m_container = std::move(container);
+}
+
+CompressedStream::CompressedStream(std::shared_ptr<const Container> container) :
+    m_container(std::move(container)),
+    m_buffer{ {}, std::numeric_limits<std::size_t>::max(), {} }
+{
+    this->setName(m_container->stream->name());
+}
+
+CompressedStream::~CompressedStream()
+{}
+
+bool CompressedStream::IsCompressedStream(const InputStream& istream)
+{
+    if(istream.size() < sizeof(Header)) {
+        return false;
+    }
+
+    const auto pos = istream.tell();
+    std::array<char, 4> signature;
+    istream.seekBegin();
+    const bool bRead = istream.read(reinterpret_cast<byte_t*>(signature.data()), signature.size()) == signature.size();
+    istream.seek(pos);
+    return bRead && signature == SIGNATURE;
+}
+
+StreamPtr<InputStream> CompressedStream::duplicate() const
+{
+    return StreamPtr<InputStream>(new CompressedStream(m_container));
+}
+
+CompressionCodec CompressedStream::codec() const
+{
+    return CompressionCodec(m_container->header.codec);
+}
+
+std::size_t CompressedStream::chunkSize() const
+{
+    return m_container->header.chunkSize;
+}
+
+std::size_t CompressedStream::compressedSize() const
+{
+    return m_container->stream->size();
+}
+
+void CompressedStream::seek(std::size_t position) const
+{
+    if(position > size()) {
+        throw StreamError("CompressedStream: failed to seek to position: position out of range");
+    }
+
+    m_pos = position;
+}
+
+std::size_t CompressedStream::size() const
+{
+    return std::size_t(m_container->header.size);
+}
+
+std::size_t CompressedStream::tell() const
+{
+    return m_pos;
+}
+
+bool CompressedStream::canRead() const
+{
+    return true;
+}
+
+bool CompressedStream::canWrite() const
+{
+    return false;
+}
+
+void CompressedStream::decompressChunk(std::size_t idx, byte_t* dst, ByteArray& packed) const
+{
+    const auto& header = m_container->header;
+    const auto& chunk  = m_container->chunks[idx];
+    const std::size_t dstSize = std::min<std::size_t>(header.chunkSize, std::size_t(header.size) - idx * header.chunkSize);
+
+    /* Read compressed chunk straight from mapped container or with readAt, so no stream cursor is shared */
+    const byte_t* src = nullptr;
+    if(m_container->data) {
+        src = m_container->data + chunk.offset;
+    }
+    else
+    {
+        packed.resize(chunk.size);
+        if(m_container->stream->readAt(std::size_t(chunk.offset), packed.data(), chunk.size) != chunk.size) {
+            throw StreamError("CompressedStream: failed to read chunk!");
+        }
+        src = packed.data();
+    }
+
+    if(chunk.flags & CHUNK_STORED)
+    {
+        if(chunk.size != dstSize) {
+            throw StreamError("CompressedStream: corrupted stored chunk!");
+        }
+        std::memcpy(dst, src, dstSize);
+    }
+    else {
+        Decompress(codec(), src, chunk.size, dst, dstSize);
+    }
+}
+
+std::size_t CompressedStream::readChunks(std::size_t offset, byte_t* data, std::size_t length, ChunkBuffer& buffer) const
+{
+    const std::size_t chunkSize = m_container->header.chunkSize;
+    length = std::min(length, size() - std::min(offset, size()));
+
+    std::size_t nRead = 0;
+    while(nRead < length)
+    {
+        const std::size_t pos      = offset + nRead;
+        const std::size_t idx      = pos / chunkSize;
+        const std::size_t chunkOff = pos % chunkSize;
+        const std::size_t chunkLen = std::min(chunkSize, size() - idx * chunkSize);
+        const std::size_t n        = std::min(length - nRead, chunkLen - chunkOff);
+
+        const auto& chunk = m_container->chunks[idx];
+        if((chunk.flags & CHUNK_STORED) && m_container->data && chunk.size == chunkLen) {
+            std::memcpy(data + nRead, m_container->data + chunk.offset + chunkOff, n); // stored chunk is read in place
+        }
+        else if(chunkOff == 0 && n == chunkLen && idx != buffer.idx) {
+            decompressChunk(idx, data + nRead, buffer.packed); // whole chunk is read, decompress straight to output
+        }
+        else
+        {
+            if(idx != buffer.idx)
+            {
+                buffer.chunk.resize(chunkSize);
+                decompressChunk(idx, buffer.chunk.data(), buffer.packed);
+                buffer.idx = idx;
+            }
+            std::memcpy(data + nRead, buffer.chunk.data() + chunkOff, n);
+        }
+
+        nRead += n;
+    }
+
+    return nRead;
+}
+
+std::size_t CompressedStream::readsome(byte_t* data, std::size_t length) const
+{
+    const std::size_t nRead = readChunks(m_pos, data, length, m_buffer);
+    m_pos += nRead;
+    return nRead;
+}
+
+std::size_t CompressedStream::readsomeAt(std::size_t offset, byte_t* data, std::size_t length) const
+{
+    ChunkBuffer buffer{ {}, std::numeric_limits<std::size_t>::max(), {} };
+    return readChunks(offset, data, length, buffer);
+}
+
+std::size_t CompressedStream::writesome(const byte_t* /*data*/, std::size_t /*length*/)
+{
+    throw StreamError("Cannot write to read-only CompressedStream!");
+}
+
+
+std::size_t CompressStream(const InputStream& istream, std::size_t offset, std::size_t length, Stream& ostream, CompressionCodec codec,
+                           std::size_t chunkSize, int level, std::size_t numThreads)
+{
+    LIBIM_STATS_SCOPED_TIMER("CompressStream");
+    if(!IsCodecSupported(codec)) {
+        throw StreamError(std::string("CompressStream: codec ") + GetCodecName(codec) + " is not supported!");
+    }
+
+    if(!IsCodecLevelValid(codec, level)) {
+        throw StreamError(std::string("CompressStream: invalid ") + GetCodecName(codec) + " compression level " + std::to_string(level) + "!");
+    }
+
+    if(chunkSize == 0 || chunkSize > std::numeric_limits<uint32_t>::max()) {
+        throw StreamError("CompressStream: invalid chunk size!");
+    }
+
+    if(offset > istream.size()) {
+        throw StreamError("CompressStream: offset is out of stream bounds!");
+    }
+    length = std::min(length, istream.size() - offset);
+
+    Header header;
+    header.signature   = SIGNATURE;
+    header.version     = VERSION;
+    header.codec       = uint16_t(codec);
+    header.chunkSize   = uint32_t(chunkSize);
+    header.numChunks   = uint32_t((length + chunkSize - 1) / chunkSize);
+    header.size        = length;
+    header.indexOffset = 0;
+
+    /* Header is written again with index offset at the end */
+    const std::size_t start = ostream.tell();
+    ostream.write(header);
+
+    struct Job
+    {
+        ByteArray raw;
+        ByteArray packed;
+        bool compressed = false;
+    };
+
+    libim::ThreadPool pool(numThreads);
+    const std::size_t nBatch = std::max<std::size_t>(1, pool.size() * 4);
+    std::vector<Job> jobs(nBatch);
+    std::vector<ChunkEntry> index;
+    index.reserve(header.numChunks);
+
+    std::size_t nOffset = sizeof(Header);
+    istream.seek(offset);
+    for(std::size_t nChunk = 0; nChunk < header.numChunks; nChunk += nBatch)
+    {
+        /* Read next batch of chunks and compress them in parallel */
+        const std::size_t nJobs = std::min<std::size_t>(nBatch, header.numChunks - nChunk);
+        for(std::size_t i = 0; i < nJobs; i++)
+        {
+            auto& job = jobs[i];
+            job.raw.resize(std::min(chunkSize, length - (nChunk + i) * chunkSize));
+            if(istream.read(job.raw.data(), job.raw.size()) != job.raw.size()) {
+                throw StreamError("CompressStream: error reading stream!");
+            }
+
+            if(codec != CompressionCodec::Store) {
+                pool.submit([&job, codec, level]{
+                    job.compressed = Compress(codec, level, job.raw.data(), job.raw.size(), job.packed);
+                });
+            }
+        }
+        pool.wait();
+
+        /* Write chunks in order */
+        for(std::size_t i = 0; i < nJobs; i++)
+        {
+            auto& job = jobs[i];
+            const auto& data = job.compressed ? job.packed : job.raw;
+            if(ostream.write(data.data(), data.size()) != data.size()) {
+                throw StreamError("CompressStream: error writing stream!");
+            }
+
+            index.push_back({ nOffset, uint32_t(data.size()), job.compressed ? 0 : CHUNK_STORED });
+            nOffset += data.size();
+            job.compressed = false;
+        }
+    }
+
+    header.indexOffset = nOffset;
+    ostream.write(index);
+    const std::size_t end = ostream.tell();
+
+    ostream.seek(start);
+    ostream.write(header);
+    ostream.seek(end);
+    return end - start;
+}
+
+StreamPtr<InputStream> OpenInputStream(const std::string& filePath)
+{
+    auto mfs = MakeStreamPtr<MappedFileStream>(filePath);
+    if(CompressedStream::IsCompressedStream(*mfs)) {
+        return MakeStreamPtr<CompressedStream>(std::move(mfs));
+    }
+    return mfs;
+}
@@ -0,0 +1,106 @@
+#ifndef COMPRESSEDSTREAM_H
+#define COMPRESSEDSTREAM_H
+#include "stream.h"
+#include "common.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+/* Compressed container of libim files (e.g. GOB or CND file).
+   Data is split into chunks of fixed uncompressed size which are compressed independently and followed
+   by chunk index, so any position can be read by decompressing only the chunk(s) containing it.
+   Layout: header | chunk 0 | chunk 1 | ... | index (offset, size and flags of every chunk).
+   Chunk which doesn't compress is stored as is. Store codec is always available, other codecs
+   are available if libim was built with the codec library (see IsCodecSupported). */
+enum class CompressionCodec : uint16_t
+{
+    Store = 0,
+    Zlib  = 1,
+    Zstd  = 2,
+    Lz4   = 3
+};
+
+const char* GetCodecName(CompressionCodec codec);
+
+/* Parses codec name as returned by GetCodecName. Returns false if name is unknown. */
+bool GetCodecByName(const std::string& name, CompressionCodec& codec);
+bool IsCodecSupported(CompressionCodec codec);
+
+/* Returns range of compression levels codec accepts besides level 0 (codec default level).
+   Returns false if codec has no compression levels (store). For lz4 level is acceleration factor. */
+bool GetCodecLevelRange(CompressionCodec codec, int& minLevel, int& maxLevel);
+
+/* Returns true if level is 0 or in codec's level range */
+bool IsCodecLevelValid(CompressionCodec codec, int level);
+
+
+/* Read-only random access stream over compressed container.
+   The most recently decompressed chunk is kept, so sequential and nearby reads decompress every chunk once.
+   readAt decompresses into its own buffer and doesn't use the kept chunk, so it's thread-safe if readAt of
+   the container stream is. */
+class CompressedStream final : public InputStream
+{
+public:
+    static constexpr std::size_t DEFAULT_CHUNK_SIZE = 256 * 1024;
+
+    /* Opens container stored in istream. Throws StreamError if istream is not a valid container
+       or its codec is not supported. */
+    explicit CompressedStream(StreamPtr<InputStream> istream);
+    virtual ~CompressedStream();
+
+    /* Returns true if istream begins with container signature. Stream position is restored. */
+    static bool IsCompressedStream(const InputStream& istream);
+
+    /* Returns new stream over the same container which shares chunk index but has its own position and chunk buffer.
+       Container stream is read with readAt, so the streams can be read from different threads at the same time
+       if container stream is e.g. a MappedFileStream or FileStream. */
+    StreamPtr<InputStream> duplicate() const;
+
+    CompressionCodec codec() const;
+    std::size_t chunkSize() const;
+    std::size_t compressedSize() const;
+
+    virtual void seek(std::size_t position) const override;
+    virtual std::size_t size() const override;
+    virtual std::size_t tell() const override;
+    virtual bool canRead() const override;
+    virtual bool canWrite() const override;
+
+protected:
+    virtual std::size_t readsome(byte_t* data, std::size_t length) const override;
+    virtual std::size_t writesome(const byte_t* data, std::size_t length) override;
+    virtual std::size_t readsomeAt(std::size_t offset, byte_t* data, std::size_t length) const override;
+
+private:
+    struct Container;
+    struct ChunkBuffer
+    {
+        ByteArray chunk;       // decompressed chunk
+        std::size_t idx;       // index of decompressed chunk
+        ByteArray packed;      // compressed chunk read from non memory mapped stream
+    };
+
+    explicit CompressedStream(std::shared_ptr<const Container> container);
+    void decompressChunk(std::size_t idx, byte_t* dst, ByteArray& packed) const;
+    std::size_t readChunks(std::size_t offset, byte_t* data, std::size_t length, ChunkBuffer& buffer) const;
+
+private:
+    std::shared_ptr<const Container> m_container;
+    mutable ChunkBuffer m_buffer;
+    mutable std::size_t m_pos = 0;
+};
+
+/* Writes length bytes of istream from offset as compressed container to the current position of ostream.
+   Input is read chunk by chunk and chunks are compressed with numThreads threads (0 = all hardware threads),
+   memory use is bounded by a few chunks per thread. level 0 = codec default level.
+   Returns number of bytes written. Throws StreamError if codec is not supported, level is not valid for codec or on I/O error. */
+std::size_t CompressStream(const InputStream& istream, std::size_t offset, std::size_t length, Stream& ostream, CompressionCodec codec,
+                           std::size_t chunkSize = CompressedStream::DEFAULT_CHUNK_SIZE, int level = 0, std::size_t numThreads = 1);
+
+/* Opens file for reading. If file is compressed container CompressedStream over the memory mapped file is returned,
+   otherwise the memory mapped file. Throws StreamError on error. */
+StreamPtr<InputStream> OpenInputStream(const std::string& filePath);
+
+#endif // COMPRESSEDSTREAM_H
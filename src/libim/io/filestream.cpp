@@ -1,6 +1,8 @@
 #include "filestream.h"
 #include "../common.h"
+#include "../utils/stats.h"
 #include <algorithm>
+#include <cstring>
 
 #ifdef OS_WINDOWS
 #include <windows.h>
@@ -22,6 +24,10 @@
 # include <unistd.h>
 #endif
 
+#ifdef __linux__
+# include <sys/sendfile.h>
+#endif
+
 
 
 std::string GetLastErrorAsString()
@@ -131,11 +137,24 @@ struct FileStream::FileStreamImpl
     #endif
     }
 
+    #ifdef OS_WINDOWS
+    /* Reads and writes on Windows are done at explicit offset, because positional ReadFile
+       of synchronous file handle moves file pointer and readAt must not change currentOffset */
+    static OVERLAPPED MakeOverlapped(std::size_t offset)
+    {
+        OVERLAPPED ov {};
+        ov.Offset     = static_cast<DWORD>(uint64_t(offset));
+        ov.OffsetHigh = static_cast<DWORD>(uint64_t(offset) >> 32);
+        return ov;
+    }
+    #endif
+
     std::size_t read(byte_t* data, std::size_t length)
     {
         ssize_t nRead = 0;
     #ifdef OS_WINDOWS
-        if(!ReadFile(fileHandle, reinterpret_cast<LPVOID>(data), (DWORD)length, (LPDWORD)&nRead, NULL)) {
+        OVERLAPPED ov = MakeOverlapped(currentOffset);
+        if(!ReadFile(fileHandle, reinterpret_cast<LPVOID>(data), (DWORD)length, (LPDWORD)&nRead, &ov) && GetLastError() != ERROR_HANDLE_EOF) {
     #else
         nRead = ::read(fd, data, length);
         if(nRead == -1) {
@@ -143,6 +162,9 @@ struct FileStream::FileStreamImpl
             throw FileStreamError("Failed to read from file: " + GetLastErrorAsString());
         }
 
+        LIBIM_STATS_ADD(FileReadSyscalls, 1);
+        LIBIM_STATS_ADD(FileBytesRead, nRead);
+
         currentOffset += nRead;
         return static_cast<std::size_t>(nRead);
     }
@@ -151,7 +173,8 @@ struct FileStream::FileStreamImpl
     {
         ssize_t nWritten = 0;
     #ifdef OS_WINDOWS
-        if(!WriteFile(fileHandle, reinterpret_cast<LPCVOID>(data), (DWORD)length, (LPDWORD)&nWritten, NULL)) {
+        OVERLAPPED ov = MakeOverlapped(currentOffset);
+        if(!WriteFile(fileHandle, reinterpret_cast<LPCVOID>(data), (DWORD)length, (LPDWORD)&nWritten, &ov)) {
     #else
         nWritten = ::write(fd, data, length);
         if(nWritten == -1) {
@@ -159,6 +182,9 @@ struct FileStream::FileStreamImpl
             throw FileStreamError("Failed to write data to file: " + GetLastErrorAsString());
         }
 
+        LIBIM_STATS_ADD(FileWriteSyscalls, 1);
+        LIBIM_STATS_ADD(FileBytesWritten, nWritten);
+
         currentOffset += nWritten;
         if(currentOffset > fileSize) {
             fileSize = currentOffset;
@@ -167,6 +193,43 @@ struct FileStream::FileStreamImpl
         return static_cast<std::size_t>(nWritten);
     }
 
+    /* Reads length bytes at offset without changing currentOffset. Safe to call from several threads. */
+    std::size_t readAt(std::size_t offset, byte_t* data, std::size_t length) const
+    {
+        std::size_t nTotal = 0;
+        while(nTotal < length)
+        {
+        #ifdef OS_WINDOWS
+            DWORD nRead = 0;
+            OVERLAPPED ov = MakeOverlapped(offset + nTotal);
+            const DWORD nToRead = static_cast<DWORD>(std::min<std::size_t>(length - nTotal, MAXDWORD));
+            if(!ReadFile(fileHandle, reinterpret_cast<LPVOID>(data + nTotal), nToRead, &nRead, &ov))
+            {
+                if(GetLastError() == ERROR_HANDLE_EOF) {
+                    break;
+                }
+        #else
+            const ssize_t nRead = pread(fd, data + nTotal, length - nTotal, static_cast<off_t>(offset + nTotal));
+            if(nRead == -1)
+            {
+                if(errno == EINTR) {
+                    continue;
+                }
+        #endif
+                throw FileStreamError("Failed to read from file: " + GetLastErrorAsString());
+            }
+
+            LIBIM_STATS_ADD(FileReadSyscalls, 1);
+            LIBIM_STATS_ADD(FileBytesRead, nRead);
+            if(nRead == 0) {
+                break; // end of file
+            }
+            nTotal += static_cast<std::size_t>(nRead);
+        }
+
+        return nTotal;
+    }
+
     void seek(std::size_t position) const
     {
     #ifdef OS_WINDOWS
@@ -181,18 +244,90 @@ struct FileStream::FileStreamImpl
             throw FileStreamError(std::string("Failed to seek to position: ") + GetLastErrorAsString());
         }
 
+        LIBIM_STATS_ADD(FileSeekSyscalls, 1);
+
         currentOffset = position;
         if(currentOffset > fileSize) {
             fileSize = currentOffset;
         }
     }
 
+    /* Copies length bytes from file at offset to the current position of this file.
+       Returns false if the copy couldn't be started and data should be copied in user space. */
+    bool copyFrom(const FileStreamImpl& ifs, std::size_t offset, std::size_t length)
+    {
+    #ifdef __linux__
+        std::size_t nTotal = 0;
+        bool bSendfile = false;
+        while(length > 0)
+        {
+            ssize_t nCopied = 0;
+            if(!bSendfile)
+            {
+                loff_t offIn = static_cast<loff_t>(offset);
+                nCopied = copy_file_range(ifs.fd, &offIn, fd, nullptr, length, 0);
+            }
+            else
+            {
+                off_t offIn = static_cast<off_t>(offset);
+                nCopied = sendfile(fd, ifs.fd, &offIn, length);
+            }
+
+            LIBIM_STATS_ADD(FileCopySyscalls, 1);
+            if(nCopied == -1 && errno == EINTR) {
+                continue;
+            }
+            else if(nCopied <= 0)
+            {
+                if(nTotal == 0)
+                {
+                    /* Not supported for these files, try next method */
+                    if(!bSendfile)
+                    {
+                        bSendfile = true;
+                        continue;
+                    }
+                    return false;
+                }
+
+                throw FileStreamError("Failed to copy data between files: " + GetLastErrorAsString());
+            }
+
+            LIBIM_STATS_ADD(FileBytesCopied, nCopied);
+            offset        += nCopied;
+            length        -= nCopied;
+            nTotal        += nCopied;
+            currentOffset += nCopied;
+            if(currentOffset > fileSize) {
+                fileSize = currentOffset;
+            }
+        }
+
+        return true;
+    #else
+        /* No kernel file to file range copy API */
+        (void)ifs; (void)offset; (void)length;
+        return false;
+    #endif
+    }
+
+    void flush()
+    {
+#ifdef OS_WINDOWS
+        if(!FlushFileBuffers(fileHandle)) {
+#else
+        if(fsync(fd) == -1) {
+#endif
+            throw FileStreamError("Failed to flush file: " + GetLastErrorAsString());
+        }
+    }
+
     void close()
     {
 #ifdef OS_WINDOWS
         if(fileHandle != INVALID_HANDLE_VALUE)
         {
-            if(mode == Write || mode == ReadWrite){
+            if(syncOnClose && (mode == Write || mode == ReadWrite)){
                 FlushFileBuffers(fileHandle);
             }
 
@@ -202,7 +337,7 @@ struct FileStream::FileStreamImpl
 #else
         if(fd > 0)
         {
-            if(mode == Write || mode == ReadWrite){
+            if(syncOnClose && (mode == Write || mode == ReadWrite)){
                 fsync(fd);
             }
 
@@ -218,6 +353,7 @@ struct FileStream::FileStreamImpl
     }
 
     Mode mode;
+    bool syncOnClose = true;
     std::string filePath;
     mutable std::size_t fileSize = 0;
     mutable std::size_t currentOffset = 0;
@@ -275,6 +411,40 @@ void FileStream::close()
     m_fs->close();
 }
 
+Stream& FileStream::write(const Stream& istream, std::size_t offset, std::size_t length, ByteArray& buffer)
+{
+    auto ifs = dynamic_cast<const FileStream*>(&istream);
+    if(ifs && canWrite() && ifs->canRead() && offset < ifs->size())
+    {
+        if(offset + length > ifs->size()) {
+            length = ifs->size() - offset; // write to the end of istream
+        }
+
+        if(m_fs->copyFrom(*ifs->m_fs, offset, length))
+        {
+            ifs->seek(offset + length); // Move istream cursor as if data was read
+            return *this;
+        }
+    }
+
+    return Stream::write(istream, offset, length, buffer);
+}
+
+void FileStream::setSyncOnClose(bool sync)
+{
+    m_fs->syncOnClose = sync;
+}
+
+bool FileStream::syncOnClose() const
+{
+    return m_fs->syncOnClose;
+}
+
+void FileStream::flush()
+{
+    m_fs->flush();
+}
+
 std::size_t FileStream::readsome(byte_t* data, std::size_t length) const
 {
     if(m_fs->currentOffset + length >= m_fs->fileSize){
@@ -283,3 +453,8 @@ std::size_t FileStream::readsome(byte_t* data, std::size_t length) const
 
     return m_fs->read(data, length);
 }
+
+std::size_t FileStream::readsomeAt(std::size_t offset, byte_t* data, std::size_t length) const
+{
+    return m_fs->readAt(offset, data, length);
+}
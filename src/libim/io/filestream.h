@@ -11,6 +11,8 @@ struct FileStreamError : public StreamError {
     using StreamError::StreamError;
 };
 
+std::string GetLastErrorAsString();
+
 class FileStream : public virtual Stream
 {
 public:
@@ -24,6 +26,13 @@ public:
     explicit FileStream(std::string filePath, Mode mode = ReadWrite);
     virtual ~FileStream();
 
+    using Stream::write;
+
+    /* Copies data from istream. If istream is also a FileStream the data is copied
+       by the kernel where the OS supports it (copy_file_range/sendfile on Linux)
+       otherwise it's copied in chunks through buffer. */
+    virtual Stream& write(const Stream& istream, std::size_t offset, std::size_t length, ByteArray& buffer) override;
+
     virtual void seek(std::size_t position) const override;
     virtual std::size_t size() const override;
     virtual std::size_t tell() const override;
@@ -31,10 +40,20 @@ public:
     virtual bool canWrite() const override;
     virtual void close();
 
+    /* Sets whether written data is flushed to the storage device when file is closed. Default is true. */
+    void setSyncOnClose(bool sync);
+    bool syncOnClose() const;
+
+    /* Flushes written data to the storage device */
+    void flush();
+
 protected:
     virtual std::size_t readsome(byte_t* data, std::size_t length) const override;
     virtual std::size_t writesome(const byte_t* data, std::size_t length) override;
 
+    /* Positional read (pread / ReadFile at offset), safe to call concurrently on the same file */
+    virtual std::size_t readsomeAt(std::size_t offset, byte_t* data, std::size_t length) const override;
+
 private:
     struct FileStreamImpl;
     std::shared_ptr<FileStreamImpl> m_fs;
@@ -0,0 +1,241 @@
+#include "mappedfilestream.h"
+#include "../common.h"
+#include "../utils/stats.h"
+#include <algorithm>
+#include <cstring>
+
+#ifdef OS_WINDOWS
+#include <windows.h>
+#else
+# include <errno.h>
+# include <fcntl.h>
+# include <sys/mman.h>
+# include <sys/stat.h>
+# include <sys/types.h>
+# include <unistd.h>
+#endif
+
+
+struct MappedFileStream::MappedFileStreamImpl
+{
+    MappedFileStreamImpl(std::string fp) : filePath(std::move(fp))
+    {
+    #ifdef OS_WINDOWS
+        /* Open file */
+        fileHandle = CreateFileA(filePath.c_str(),
+                        GENERIC_READ,
+                        FILE_SHARE_READ,
+                        NULL,
+                        OPEN_EXISTING,
+                        FILE_ATTRIBUTE_NORMAL,
+                        NULL);
+
+        if (fileHandle == INVALID_HANDLE_VALUE) {
+            throw FileStreamError(GetLastErrorAsString());
+        }
+
+        /* Get file size */
+        LARGE_INTEGER lSize {0};
+        if(!GetFileSizeEx(fileHandle, &lSize))
+        {
+            close();
+            throw FileStreamError("Error getting the file size: " + GetLastErrorAsString());
+        }
+
+        fileSize = static_cast<std::size_t>(lSize.QuadPart);
+        if(fileSize == 0) {
+            return; // Empty files can't be mapped
+        }
+
+        /* Map file */
+        mapHandle = CreateFileMappingA(fileHandle, NULL, PAGE_READONLY, 0, 0, NULL);
+        if(mapHandle == NULL)
+        {
+            close();
+            throw FileStreamError("Failed to create file mapping: " + GetLastErrorAsString());
+        }
+
+        mapData = reinterpret_cast<const byte_t*>(MapViewOfFile(mapHandle, FILE_MAP_READ, 0, 0, 0));
+        if(mapData == nullptr)
+        {
+            close();
+            throw FileStreamError("Failed to map view of file: " + GetLastErrorAsString());
+        }
+
+    #else // Not Win
+        /* Open file */
+        fd = open(filePath.c_str(), O_RDONLY);
+        if (fd == -1) {
+            throw FileStreamError(strerror(errno));
+        }
+
+        /* Get file size */
+        struct stat fileInfo {};
+        if (fstat(fd, &fileInfo) == -1)
+        {
+            close();
+            throw FileStreamError(std::string("Error getting the file size: ") + strerror(errno));
+        }
+
+        fileSize = fileInfo.st_size;
+        if(fileSize == 0) {
+            return; // Empty files can't be mapped
+        }
+
+        /* Map file */
+        void* addr = mmap(nullptr, fileSize, PROT_READ, MAP_PRIVATE, fd, 0);
+        if(addr == MAP_FAILED)
+        {
+            close();
+            throw FileStreamError(std::string("Failed to map file: ") + strerror(errno));
+        }
+
+        mapData = reinterpret_cast<const byte_t*>(addr);
+
+        /* Mapping stays valid after the file descriptor is closed */
+        ::close(fd);
+        fd = -1;
+    #endif
+    }
+
+    std::size_t read(byte_t* data, std::size_t length)
+    {
+        if(currentOffset >= fileSize) {
+            return 0;
+        }
+
+        length = std::min(length, fileSize - currentOffset);
+        std::memcpy(data, mapData + currentOffset, length);
+        currentOffset += length;
+        LIBIM_STATS_ADD(MappedBytesRead, length);
+        return length;
+    }
+
+    void close()
+    {
+    #ifdef OS_WINDOWS
+        if(mapData != nullptr)
+        {
+            UnmapViewOfFile(mapData);
+            mapData = nullptr;
+        }
+
+        if(mapHandle != NULL)
+        {
+            CloseHandle(mapHandle);
+            mapHandle = NULL;
+        }
+
+        if(fileHandle != INVALID_HANDLE_VALUE)
+        {
+            CloseHandle(fileHandle);
+            fileHandle = INVALID_HANDLE_VALUE;
+        }
+    #else
+        if(mapData != nullptr)
+        {
+            munmap(const_cast<byte_t*>(mapData), fileSize);
+            mapData = nullptr;
+        }
+
+        if(fd != -1)
+        {
+            ::close(fd);
+            fd = -1;
+        }
+    #endif
+        fileSize      = 0;
+        currentOffset = 0;
+    }
+
+    ~MappedFileStreamImpl()
+    {
+        close();
+    }
+
+    std::string filePath;
+    std::size_t fileSize = 0;
+    mutable std::size_t currentOffset = 0;
+    const byte_t* mapData = nullptr;
+
+#ifdef OS_WINDOWS
+    HANDLE fileHandle = INVALID_HANDLE_VALUE;
+    HANDLE mapHandle  = NULL;
+#else
+    int fd = -1;
+#endif
+};
+
+MappedFileStream::MappedFileStream(std::string filePath) :
+    m_fs(std::make_shared<MappedFileStreamImpl>(GetNativePath(std::move(filePath))))
+{
+    this->setName(GetFileName(m_fs->filePath));
+}
+
+MappedFileStream::~MappedFileStream()
+{}
+
+void MappedFileStream::seek(std::size_t position) const
+{
+    if(position > m_fs->fileSize) {
+        throw FileStreamError("Failed to seek to position: position out of range");
+    }
+
+    m_fs->currentOffset = position;
+}
+
+std::size_t MappedFileStream::size() const
+{
+    return m_fs->fileSize;
+}
+
+std::size_t MappedFileStream::tell() const
+{
+    return m_fs->currentOffset;
+}
+
+bool MappedFileStream::canRead() const
+{
+    return m_fs->mapData != nullptr;
+}
+
+bool MappedFileStream::canWrite() const
+{
+    return false;
+}
+
+void MappedFileStream::close()
+{
+    m_fs->close();
+}
+
+const byte_t* MappedFileStream::data() const
+{
+    return m_fs->mapData;
+}
+
+const byte_t* MappedFileStream::data(std::size_t offset) const
+{
+    if(m_fs->mapData == nullptr || offset > m_fs->fileSize) {
+        return nullptr;
+    }
+
+    return m_fs->mapData + offset;
+}
+
+std::size_t MappedFileStream::readsome(byte_t* data, std::size_t length) const
+{
+    return m_fs->read(data, length);
+}
+
+std::size_t MappedFileStream::readsomeAt(std::size_t offset, byte_t* data, std::size_t length) const
+{
+    std::memcpy(data, m_fs->mapData + offset, length);
+    LIBIM_STATS_ADD(MappedBytesRead, length);
+    return length;
+}
+
+std::size_t MappedFileStream::writesome(const byte_t* /*data*/, std::size_t /*length*/)
+{
+    throw FileStreamError("Cannot write to read-only mapped file stream!");
+}
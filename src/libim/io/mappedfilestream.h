@@ -0,0 +1,43 @@
+#ifndef MAPPEDFILESTREAM_H
+#define MAPPEDFILESTREAM_H
+#include "stream.h"
+#include "filestream.h"
+#include "common.h"
+
+#include <memory>
+#include <string>
+
+/* Read-only file stream backed by a memory mapped view of the whole file.
+   Reading from the stream is a plain memory copy and data() gives direct
+   access to the file bytes without copying them at all. */
+class MappedFileStream final : public InputStream
+{
+public:
+    explicit MappedFileStream(std::string filePath);
+    virtual ~MappedFileStream();
+
+    virtual void seek(std::size_t position) const override;
+    virtual std::size_t size() const override;
+    virtual std::size_t tell() const override;
+    virtual bool canRead() const override;
+    virtual bool canWrite() const override;
+    void close();
+
+    /* Returns pointer to the beginning of mapped file or nullptr if the file is empty or closed.
+       The pointer is valid for as long as the stream is not closed or destroyed. */
+    const byte_t* data() const;
+
+    /* Returns pointer to mapped file data at offset */
+    const byte_t* data(std::size_t offset) const;
+
+protected:
+    virtual std::size_t readsome(byte_t* data, std::size_t length) const override;
+    virtual std::size_t writesome(const byte_t* data, std::size_t length) override;
+    virtual std::size_t readsomeAt(std::size_t offset, byte_t* data, std::size_t length) const override;
+
+private:
+    struct MappedFileStreamImpl;
+    std::shared_ptr<MappedFileStreamImpl> m_fs;
+};
+
+#endif // MAPPEDFILESTREAM_H
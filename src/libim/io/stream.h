@@ -1,10 +1,12 @@
 #ifndef INPUTSTREAM_H
 #define INPUTSTREAM_H
 #include "common.h"
+#include "../utils/stats.h"
 
 #include <iostream>
 
 #include "assert.h"
+#include <algorithm>
 #include <climits>
 #include <cstdint>
 #include <memory>
@@ -39,10 +41,19 @@ std::shared_ptr<T> StreamPointerCast(const std::shared_ptr<U>& r) {
     return std::static_pointer_cast<T>(StreamPointerCast<Stream>(r));
 }
 
+static constexpr std::size_t STREAM_COPY_BUFFER_SIZE = 1024 * 1024; // default copy buffer size
+
 struct StreamError : public std::runtime_error {
     using std::runtime_error::runtime_error;
 };
 
+/* Concurrency: stream object is not safe to use from several threads at the same time. Stream position is
+   shared state which seek, tell, read and write use, even though some of them are const methods.
+   The exception is readAt, which reads at given offset without using the stream position. readAt of
+   FileStream (pread / positional ReadFile), MappedFileStream, and of SubStream, BufferedInputStream and
+   CompressedStream when the underlying stream's readAt is, can be called from any number of threads at
+   the same time as long as no thread writes to, seeks or closes the stream meanwhile.
+   readAt of other streams falls back to seek and read and must not be called concurrently. */
 class Stream
 {
 public:
@@ -84,9 +95,27 @@ public:
             throw StreamError("End of stream");
         }
 
+        LIBIM_STATS_ADD(StreamReads, 1);
+        LIBIM_STATS_ADD(StreamBytesRead, length);
+        LIBIM_STATS_RECORD(StreamReadSize, length);
         return  readsome(data, length);
     }
 
+    /* Reads up to length bytes at offset without using or moving stream position.
+       Returns number of bytes read, which is less than length only when the end of stream is reached. */
+    std::size_t readAt(std::size_t offset, byte_t* data, std::size_t length) const
+    {
+        if(offset > this->size()) {
+            throw StreamError("Read offset is out of stream bounds");
+        }
+
+        length = std::min(length, this->size() - offset);
+        LIBIM_STATS_ADD(StreamReads, 1);
+        LIBIM_STATS_ADD(StreamBytesRead, length);
+        LIBIM_STATS_RECORD(StreamReadSize, length);
+        return length > 0 ? readsomeAt(offset, data, length) : 0;
+    }
+
 
 //    template<class T>
 //    Stream& write(T&& data)
@@ -133,33 +162,59 @@ public:
     {
         return write(istream, offset, istream.size() - 1);
     }
-    
+
+    /* Write from stream. Copies offsetEnd bytes of istream starting at offsetBegin.
+       Data is copied in chunks of copyBufferSize() bytes. */
     virtual Stream& write(const Stream& istream, std::size_t offsetBegin, std::size_t offsetEnd)
     {
-        if(!istream.canRead() || offsetBegin >= istream.size()) 
+        ByteArray buffer;
+        return write(istream, offsetBegin, offsetEnd, buffer);
+    }
+
+    /* Write from stream. Copies length bytes of istream starting at offset.
+       The buffer is used as intermediate chunk storage and can be reused across calls.
+       If buffer is empty it is resized to min(copyBufferSize(), length). */
+    virtual Stream& write(const Stream& istream, std::size_t offset, std::size_t length, ByteArray& buffer)
+    {
+        if(!istream.canRead() || offset >= istream.size())
         {
             // TODO: log!
             assert(false &&  "!istream.canRead()");
             return *this;
         }
 
-        if((offsetBegin + offsetEnd) > istream.size()) {
+        if((offset + length) > istream.size()) {
             //TODO: log
-            offsetEnd = (istream.size()) - offsetBegin; // write to the end of istream
+            length = istream.size() - offset; // write to the end of istream
+        }
+
+        if(buffer.empty()) {
+            buffer.resize(std::max<std::size_t>(1, std::min(m_copyBufferSize, length)));
+        }
+
+        istream.seek(offset);
+        while(length > 0)
+        {
+            const std::size_t nChunk = std::min(length, buffer.size());
+            if(istream.read(buffer.data(), nChunk) != nChunk) {
+                throw StreamError("Error while reading stream!");
+            }
+
+            if(write(buffer.data(), nChunk) != nChunk) {
+                throw StreamError("Failed to write data to stream!");
+            }
+
+            length -= nChunk;
         }
 
-        //auto cur = istream.tell();
-        istream.seek(offsetBegin);
-        
-        // TODO: read/write in batch
-        write(istream.read(offsetEnd));
-        
-        //istream.seek(cur);
         return *this;
     }
 
     virtual std::size_t write(const byte_t* data, const std::size_t length)
     {
+        LIBIM_STATS_ADD(StreamWrites, 1);
+        LIBIM_STATS_ADD(StreamBytesWritten, length);
+        LIBIM_STATS_RECORD(StreamWriteSize, length);
         return writesome(data, length);
     }
 
@@ -194,10 +249,32 @@ public:
         return m_name;
     }
 
+    /* Sets size of intermediate buffer used when copying data from another stream */
+    void setCopyBufferSize(std::size_t size)
+    {
+        m_copyBufferSize = size > 0 ? size : STREAM_COPY_BUFFER_SIZE;
+    }
+
+    std::size_t copyBufferSize() const
+    {
+        return m_copyBufferSize;
+    }
+
 protected:
     virtual std::size_t readsome(byte_t* data, std::size_t length) const = 0;
     virtual std::size_t writesome(const byte_t* data, std::size_t length) = 0;
 
+    /* Reads length bytes at offset, length is within stream bounds.
+       Default implementation seeks, reads and restores stream position so it isn't thread-safe. */
+    virtual std::size_t readsomeAt(std::size_t offset, byte_t* data, std::size_t length) const
+    {
+        const std::size_t pos = this->tell();
+        this->seek(offset);
+        const std::size_t nRead = readsome(data, length);
+        this->seek(pos);
+        return nRead;
+    }
+
 private:
     template <typename T> struct tag {};
 
@@ -254,6 +331,7 @@ private:
 
 private:
     std::string m_name;
+    std::size_t m_copyBufferSize = STREAM_COPY_BUFFER_SIZE;
 };
 
 
@@ -268,6 +346,7 @@ class OutputStream : public virtual Stream
 {
 private:
     using Stream::read;
+    using Stream::readAt;
 };
 
 
@@ -0,0 +1,103 @@
+#include "substream.h"
+#include "mappedfilestream.h"
+
+#include <algorithm>
+#include <cstring>
+
+SubStream::SubStream(StreamPtr<Stream> parent, std::size_t offset, std::size_t size) :
+    m_parent(std::move(parent)),
+    m_offset(offset),
+    m_size(size)
+{
+    if(!m_parent) {
+        throw StreamError("SubStream: parent stream is null!");
+    }
+
+    if(m_offset > m_parent->size() || m_size > m_parent->size() - m_offset) {
+        throw StreamError("SubStream: range is out of parent stream bounds!");
+    }
+
+    if(auto mfs = dynamic_cast<const MappedFileStream*>(m_parent.get())) {
+        m_data = mfs->data(m_offset);
+    }
+
+    this->setName(m_parent->name());
+}
+
+void SubStream::seek(std::size_t position) const
+{
+    if(position > m_size) {
+        throw StreamError("SubStream: failed to seek to position: position out of range");
+    }
+
+    m_pos = position;
+}
+
+std::size_t SubStream::size() const
+{
+    return m_size;
+}
+
+std::size_t SubStream::tell() const
+{
+    return m_pos;
+}
+
+bool SubStream::canRead() const
+{
+    return m_parent->canRead();
+}
+
+bool SubStream::canWrite() const
+{
+    return false;
+}
+
+const byte_t* SubStream::data() const
+{
+    return m_data;
+}
+
+std::size_t SubStream::offset() const
+{
+    return m_offset;
+}
+
+const StreamPtr<Stream>& SubStream::parent() const
+{
+    return m_parent;
+}
+
+std::size_t SubStream::readsome(byte_t* data, std::size_t length) const
+{
+    if(m_pos >= m_size) {
+        return 0;
+    }
+
+    length = std::min(length, m_size - m_pos);
+    if(m_data != nullptr) {
+        std::memcpy(data, m_data + m_pos, length);
+    }
+    else {
+        length = m_parent->readAt(m_offset + m_pos, data, length);
+    }
+
+    m_pos += length;
+    return length;
+}
+
+std::size_t SubStream::readsomeAt(std::size_t offset, byte_t* data, std::size_t length) const
+{
+    if(m_data != nullptr)
+    {
+        std::memcpy(data, m_data + offset, length);
+        return length;
+    }
+
+    return m_parent->readAt(m_offset + offset, data, length);
+}
+
+std::size_t SubStream::writesome(const byte_t* /*data*/, std::size_t /*length*/)
+{
+    throw StreamError("Cannot write to read-only SubStream!");
+}
@@ -0,0 +1,46 @@
+#ifndef SUBSTREAM_H
+#define SUBSTREAM_H
+#include "stream.h"
+#include "common.h"
+
+#include <memory>
+
+/* Read-only bounded view over the range [offset, offset + size) of the parent stream.
+   No data is copied when the view is made. If parent stream is a MappedFileStream
+   the view reads straight from the mapped memory and data() returns pointer to it.
+   Parent is read with readAt, so views over the same FileStream have independent positions
+   and can be read from different threads at the same time. */
+class SubStream final : public InputStream
+{
+public:
+    SubStream(StreamPtr<Stream> parent, std::size_t offset, std::size_t size);
+    virtual ~SubStream() = default;
+
+    virtual void seek(std::size_t position) const override;
+    virtual std::size_t size() const override;
+    virtual std::size_t tell() const override;
+    virtual bool canRead() const override;
+    virtual bool canWrite() const override;
+
+    /* Returns pointer to the beginning of view or nullptr if parent stream is not memory backed */
+    const byte_t* data() const;
+
+    /* Returns offset of the view in parent stream */
+    std::size_t offset() const;
+
+    const StreamPtr<Stream>& parent() const;
+
+protected:
+    virtual std::size_t readsome(byte_t* data, std::size_t length) const override;
+    virtual std::size_t writesome(const byte_t* data, std::size_t length) override;
+    virtual std::size_t readsomeAt(std::size_t offset, byte_t* data, std::size_t length) const override;
+
+private:
+    StreamPtr<Stream> m_parent;
+    const byte_t* m_data = nullptr;
+    std::size_t m_offset = 0;
+    std::size_t m_size   = 0;
+    mutable std::size_t m_pos = 0;
+};
+
+#endif // SUBSTREAM_H
@@ -125,11 +125,13 @@ typedef struct {
 //    }
 //}
 
-static bool SaveBmpToFile(const std::string& filename, const Bmp& bmp)
+/* Saves bmp to file. If sync is false file is not flushed to disk on close. */
+static bool SaveBmpToFile(const std::string& filename, const Bmp& bmp, bool sync = true)
 {
     try
     {
         OutputFileStream ofs(filename);
+        ofs.setSyncOnClose(sync);
         ofs.write(reinterpret_cast<const byte_t*>(&bmp.header), sizeof(bmp.header));
         ofs.write(reinterpret_cast<const byte_t*>(&bmp.info),   sizeof(bmp.info));
         ofs.write(reinterpret_cast<const byte_t*>(bmp.pixelData->data()), bmp.pixelData->size());
@@ -0,0 +1,295 @@
+#include "bmpreader.h"
+#include "pixelconv.h"
+#include "../io/bufferedstream.h"
+#include "../io/filestream.h"
+#include "../utils/stats.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <exception>
+#include <iostream>
+#include <limits>
+#include <vector>
+
+namespace {
+
+    constexpr uint32_t kBmpInfoHeaderSize = 40; // BITMAPINFOHEADER, the smallest supported info header
+    constexpr uint32_t kBmpMasksOffset    = offsetof(BitmapV5Header, redMask);
+    constexpr uint32_t kBmpMaxDimension   = 1 << 16; // max width and height of BMP
+    constexpr uint64_t kBmpMaxBitmapSize  = std::numeric_limits<uint32_t>::max();
+    constexpr std::size_t kBgrSize  = 3;
+    constexpr std::size_t kBgraSize = 4;
+
+    /* X1R5G5B5, pixel format of BI_RGB 16 bit BMP */
+    constexpr ColorFormat kXRGB_1555 { 2, 16, 5, 5, 5, 10, 5, 0, 3, 3, 3, 0, 0, 0 };
+
+    /* B, G, R bytes of BI_RGB 24 bit BMP. Not supported by ConvertPixels, rows are expanded to BGRA_8888 */
+    constexpr ColorFormat kBGR_888 { 2, 24, 8, 8, 8, 16, 8, 0, 0, 0, 0, 0, 0, 0 };
+
+    void ReadChannelMask(uint32_t mask, int32_t& bits, int32_t& shl, int32_t& shr)
+    {
+        bits = shl = shr = 0;
+        if(mask == 0) {
+            return;
+        }
+
+        while(((mask >> shl) & 1) == 0) {
+            shl++;
+        }
+
+        const uint32_t m = mask >> shl;
+        if((m & (m + 1)) != 0) {
+            throw StreamError("BMP channel mask is not contiguous");
+        }
+
+        while(bits < 32 && ((m >> bits) & 1) != 0) {
+            bits++;
+        }
+
+        if(bits > 8) {
+            throw StreamError("BMP channel mask is wider than 8 bits");
+        }
+        shr = 8 - bits;
+    }
+
+    ColorFormat GetMaskFormat(uint32_t bpp, uint32_t redMask, uint32_t greenMask, uint32_t blueMask, uint32_t alphaMask)
+    {
+        ColorFormat cf {};
+        cf.bpp = int32_t(bpp);
+        ReadChannelMask(redMask,   cf.redBPP,   cf.RedShl,   cf.RedShr);
+        ReadChannelMask(greenMask, cf.greenBPP, cf.GreenShl, cf.GreenShr);
+        ReadChannelMask(blueMask,  cf.blueBPP,  cf.BlueShl,  cf.BlueShr);
+        ReadChannelMask(alphaMask, cf.alphaBPP, cf.AlphaShl, cf.AlphaShr);
+        if(cf.alphaBPP == 0) {
+            cf.AlphaShr = 0;
+        }
+
+        cf.colorMode = bpp == 16 && cf.alphaBPP == 0 ? 1 : 2;
+        return cf;
+    }
+
+    /* Returns true if pixels in both formats have the same memory layout, colorMode is not compared */
+    bool IsSameLayout(const ColorFormat& lhs, const ColorFormat& rhs)
+    {
+        ColorFormat cf = lhs;
+        cf.colorMode = rhs.colorMode;
+        return cf == rhs;
+    }
+
+    void ExpandBgrToBgra(const byte_t* src, byte_t* dst, std::size_t numPixels)
+    {
+        for(std::size_t i = 0; i < numPixels; i++, src += kBgrSize, dst += kBgraSize)
+        {
+            dst[0] = src[0];
+            dst[1] = src[1];
+            dst[2] = src[2];
+            dst[3] = 0xFF;
+        }
+    }
+
+    void ReadRow(const InputStream& istream, byte_t* data, std::size_t size)
+    {
+        if(istream.read(data, size) != size) {
+            throw StreamError("Error reading BMP pixel data");
+        }
+    }
+}
+
+BmpInfo ReadBmpInfo(const InputStream& istream)
+{
+    BitmapFileHeader header;
+    if(istream.read(reinterpret_cast<byte_t*>(&header), sizeof(header)) != sizeof(header)) {
+        throw StreamError("Error reading BMP file header");
+    }
+
+    if(header.type != BMP_TYPE) {
+        throw StreamError("Not a BMP file");
+    }
+
+    /* Info header is read into V5 header, fields missing in older headers stay zero */
+    BitmapV5Header info {};
+    if(istream.read(reinterpret_cast<byte_t*>(&info.size), sizeof(info.size)) != sizeof(info.size)) {
+        throw StreamError("Error reading BMP info header");
+    }
+
+    if(info.size < kBmpInfoHeaderSize) {
+        throw StreamError("Unsupported BMP info header of size " + std::to_string(info.size));
+    }
+
+    const std::size_t nInfo = std::min<std::size_t>(info.size, sizeof(info)) - sizeof(info.size);
+    if(istream.read(reinterpret_cast<byte_t*>(&info) + sizeof(info.size), nInfo) != nInfo) {
+        throw StreamError("Error reading BMP info header");
+    }
+
+    /* BITMAPINFOHEADER is followed by channel masks */
+    if(info.size == kBmpInfoHeaderSize && (info.compression == BI_BITFIELDS || info.compression == BI_ALPHABITFIELDS))
+    {
+        const std::size_t nMasks = (info.compression == BI_ALPHABITFIELDS ? 4 : 3) * sizeof(uint32_t);
+        if(istream.read(reinterpret_cast<byte_t*>(&info) + kBmpMasksOffset, nMasks) != nMasks) {
+            throw StreamError("Error reading BMP channel masks");
+        }
+    }
+
+    if(info.width <= 0 || info.height == 0 || info.height == std::numeric_limits<int32_t>::min() || info.planes != 1) {
+        throw StreamError("Invalid BMP size");
+    }
+
+    BmpInfo bmp;
+    bmp.width   = uint32_t(info.width);
+    bmp.height  = Abs(info.height);
+    bmp.topDown = info.height < 0;
+    bmp.offBits = header.offBits;
+    if(bmp.width > kBmpMaxDimension || bmp.height > kBmpMaxDimension) {
+        throw StreamError("BMP size " + std::to_string(bmp.width) + "x" + std::to_string(bmp.height) + " is too big");
+    }
+
+    /* Sizes are checked in 64 bits, so row and pixel data size can't wrap around */
+    const uint64_t rowSize = (uint64_t(bmp.width) * info.bitCount + 31) / 32 * 4;
+    if(rowSize * bmp.height > kBmpMaxBitmapSize) {
+        throw StreamError("BMP pixel data is too big");
+    }
+    bmp.rowSize = uint32_t(rowSize);
+
+    switch(info.compression)
+    {
+    case BI_RGB:
+        if(info.bitCount == 16) {
+            bmp.format = kXRGB_1555;
+        }
+        else if(info.bitCount == 24) {
+            bmp.format = kBGR_888;
+        }
+        else if(info.bitCount == 32)
+        {
+            /* The high byte of BI_RGB 32 bit pixel is unused */
+            bmp.format = BGRA_8888;
+            bmp.format.alphaBPP = bmp.format.AlphaShl = 0;
+        }
+        else {
+            throw StreamError("Unsupported BMP bit depth: " + std::to_string(info.bitCount));
+        }
+        break;
+    case BI_BITFIELDS:
+    case BI_ALPHABITFIELDS:
+        if(info.bitCount != 16 && info.bitCount != 32) {
+            throw StreamError("Unsupported BMP bit depth: " + std::to_string(info.bitCount));
+        }
+        bmp.format = GetMaskFormat(info.bitCount, info.redMask, info.greenMask, info.blueMask, info.alphaMask);
+        break;
+    default:
+        throw StreamError("Unsupported BMP compression: " + std::to_string(info.compression));
+    }
+
+    return bmp;
+}
+
+Texture ReadBmpTexture(const InputStream& istream, const ColorFormat& format)
+{
+    LIBIM_STATS_SCOPED_TIMER("ReadBmpTexture");
+    const std::size_t start = istream.tell();
+    BmpInfo bmp = ReadBmpInfo(istream);
+
+    if(format.bpp <= 0 || uint64_t(bmp.width) * bmp.height * BBS(uint32_t(format.bpp)) > kBmpMaxBitmapSize) {
+        throw StreamError("BMP is too big for requested color format");
+    }
+
+    /* Texture::toBmp writes rows without padding, accept pixel data which fits only unpadded rows */
+    const uint32_t packedRowSize = GetRowSize(bmp.width, bmp.format.bpp);
+    if(start + bmp.offBits + uint64_t(bmp.rowSize) * bmp.height > istream.size() &&
+       start + bmp.offBits + uint64_t(packedRowSize) * bmp.height <= istream.size()) {
+        bmp.rowSize = packedRowSize;
+    }
+
+    const bool bExpand = bmp.format.bpp == kBGR_888.bpp;
+    const ColorFormat& srcFormat = bExpand ? BGRA_8888 : bmp.format;
+    if(!CanConvertPixels(srcFormat, format)) {
+        throw StreamError("Can't convert BMP pixels to requested color format");
+    }
+
+    if(start + bmp.offBits + uint64_t(bmp.rowSize) * bmp.height > istream.size()) {
+        throw StreamError("BMP pixel data is out of stream bounds");
+    }
+
+    Texture tex;
+    tex.setWidth(bmp.width)
+       .setHeight(bmp.height)
+       .setColorInfo(format)
+       .setRowSize(GetRowSize(bmp.width, format.bpp));
+
+    auto bitmap = MakeBitmapPtr(GetBitmapSize(bmp.width, bmp.height, format.bpp));
+    const std::size_t dstRowSize = tex.rowSize();
+    istream.seek(start + bmp.offBits);
+
+    /* Pixels of the same format are read straight into bitmap */
+    if(!bExpand && IsSameLayout(bmp.format, format))
+    {
+        if(bmp.topDown && bmp.rowSize == dstRowSize) {
+            ReadRow(istream, bitmap->data(), bitmap->size());
+        }
+        else
+        {
+            for(uint32_t y = 0; y < bmp.height; y++)
+            {
+                const uint32_t row = bmp.topDown ? y : bmp.height - 1 - y;
+                ReadRow(istream, bitmap->data() + std::size_t(row) * dstRowSize, dstRowSize);
+                if(bmp.rowSize != dstRowSize) {
+                    istream.seek(istream.tell() + bmp.rowSize - dstRowSize);
+                }
+            }
+        }
+
+        tex.setBitmap(std::move(bitmap));
+        return tex;
+    }
+
+    /* Row buffer holds file row and for 24 bit BMP the row expanded to BGRA_8888 */
+    const std::size_t expandedSize = bExpand ? std::size_t(bmp.width) * kBgraSize : 0;
+    std::vector<byte_t> rowBuffer(bmp.rowSize + expandedSize);
+    byte_t* srcRow = bExpand ? rowBuffer.data() + bmp.rowSize : rowBuffer.data();
+
+    for(uint32_t y = 0; y < bmp.height; y++)
+    {
+        const uint32_t row = bmp.topDown ? y : bmp.height - 1 - y;
+        byte_t* dstRow = bitmap->data() + std::size_t(row) * dstRowSize;
+
+        ReadRow(istream, rowBuffer.data(), bmp.rowSize);
+        if(bExpand)
+        {
+            if(IsSameLayout(srcFormat, format))
+            {
+                ExpandBgrToBgra(rowBuffer.data(), dstRow, bmp.width);
+                continue;
+            }
+            ExpandBgrToBgra(rowBuffer.data(), srcRow, bmp.width);
+        }
+
+        ConvertPixels(srcRow, srcFormat, dstRow, format, bmp.width);
+    }
+
+    tex.setBitmap(std::move(bitmap));
+    return tex;
+}
+
+std::shared_ptr<Material> LoadMaterialFromBmpFile(const std::string& path, const ColorFormat& format, std::ostream& err)
+{
+    LIBIM_STATS_SCOPED_TIMER("LoadMaterialFromBmpFile");
+    try
+    {
+        BufferedInputStream ifstream(MakeStreamPtr<InputFileStream>(path));
+        auto tex = ReadBmpTexture(ifstream, format);
+
+        Mipmap mipmap;
+        mipmap.push_back(std::move(tex));
+
+        auto mat = std::make_shared<Material>(GetBaseName(path) + ".mat");
+        mat->setSize(mipmap.at(0).width(), mipmap.at(0).height());
+        mat->setColorFormat(format);
+        mat->addMipmap(std::move(mipmap));
+        return mat;
+    }
+    catch(const std::exception& e)
+    {
+        err << "An error has occurred while loading material from BMP file \"" << path << "\": " << e.what() << "!\n";
+        return nullptr;
+    }
+}
@@ -0,0 +1,45 @@
+#ifndef LIBIM_BMPREADER_H
+#define LIBIM_BMPREADER_H
+#include <cstdint>
+#include <iostream>
+#include <memory>
+#include <string>
+
+#include "bmp.h"
+#include "colorformat.h"
+#include "material.h"
+#include "texture.h"
+#include "../io/stream.h"
+
+/* Streaming BMP reader. Supported are uncompressed 16, 24 and 32 bit BMP files (BI_RGB) and 16 and 32 bit
+   BMP files with channel masks (BI_BITFIELDS, BI_ALPHABITFIELDS), with BITMAPINFOHEADER up to V5 header.
+   Rows are read one at a time and converted straight into texture bitmap by the pixel conversion kernels,
+   so pixel data is read in one pass and only the texture bitmap is allocated besides one row buffer. */
+
+struct BmpInfo
+{
+    uint32_t width    = 0;
+    uint32_t height   = 0;
+    bool     topDown  = false; // rows are stored top to bottom
+    uint32_t rowSize  = 0;     // size of row in file including padding
+    uint32_t offBits  = 0;     // offset of pixel data from the beginning of file
+    ColorFormat format {};     // format of pixels in file, bpp is 24 for BI_RGB 24 bit BMP (B, G, R byte order)
+
+    bool hasAlpha() const
+    {
+        return format.alphaBPP > 0;
+    }
+};
+
+/* Reads BMP file header and info header from current stream position. Throws StreamError if BMP is not supported. */
+BmpInfo ReadBmpInfo(const InputStream& istream);
+
+/* Reads BMP from current stream position and decodes its pixels to texture in color format.
+   Format has to be 16 or 32 bit format supported by ConvertPixels. Throws StreamError on error. */
+Texture ReadBmpTexture(const InputStream& istream, const ColorFormat& format);
+
+/* Loads BMP file as material of one mipmap with one texture in color format.
+   Material is named after file with extension .mat. Returns nullptr and prints error to err on error. */
+std::shared_ptr<Material> LoadMaterialFromBmpFile(const std::string& path, const ColorFormat& format, std::ostream& err = std::cerr);
+
+#endif // LIBIM_BMPREADER_H
@@ -25,9 +25,27 @@ struct ColorFormat
     int32_t AlphaShr;
 };
 
+inline bool operator == (const ColorFormat& lhs, const ColorFormat& rhs)
+{
+    return lhs.colorMode == rhs.colorMode && lhs.bpp      == rhs.bpp      &&
+           lhs.redBPP    == rhs.redBPP    && lhs.greenBPP == rhs.greenBPP && lhs.blueBPP == rhs.blueBPP &&
+           lhs.RedShl    == rhs.RedShl    && lhs.GreenShl == rhs.GreenShl && lhs.BlueShl == rhs.BlueShl &&
+           lhs.RedShr    == rhs.RedShr    && lhs.GreenShr == rhs.GreenShr && lhs.BlueShr == rhs.BlueShr &&
+           lhs.alphaBPP  == rhs.alphaBPP  && lhs.AlphaShl == rhs.AlphaShl && lhs.AlphaShr == rhs.AlphaShr;
+}
+
+inline bool operator != (const ColorFormat& lhs, const ColorFormat& rhs)
+{
+    return !(lhs == rhs);
+}
+
 static constexpr ColorFormat RGB_565   { 1, 16, 5, 6, 5, 11, 5, 0, 3, 2, 3, 0,  0, 0 };
 static constexpr ColorFormat RGBA_4444 { 2, 16, 4, 4, 4, 12, 8, 4, 4, 4, 4, 4,  0, 4 };
 static constexpr ColorFormat ARGB_4444 { 2, 16, 4, 4, 4,  8, 4, 0, 4, 4, 4, 4, 12, 4 };
-static constexpr ColorFormat ARGB_5551 { 2, 16, 5, 5, 5, 10, 5, 0, 3, 3, 3, 1, 16, 7 };
+static constexpr ColorFormat ARGB_5551 { 2, 16, 5, 5, 5, 10, 5, 0, 3, 3, 3, 1, 15, 7 };
+
+/* 32 bit formats with 8 bit channels. Byte order in memory: RGBA_8888 = R, G, B, A; BGRA_8888 = B, G, R, A */
+static constexpr ColorFormat RGBA_8888 { 2, 32, 8, 8, 8,  0, 8, 16, 0, 0, 0, 8, 24, 0 };
+static constexpr ColorFormat BGRA_8888 { 2, 32, 8, 8, 8, 16, 8,  0, 0, 0, 0, 8, 24, 0 };
 
 #endif // LIBIM_COLORFORMAT_H
@@ -9,7 +9,9 @@
 #include <utility>
 
 #include "bmp.h"
+#include "../io/bufferedstream.h"
 #include "../io/filestream.h"
+#include "../utils/stats.h"
 #include "material.h"
 #include "colorformat.h"
 
@@ -152,7 +154,7 @@ template<> inline Stream& Stream::write(const MatMipmapHeader& mipmapHeader)
 
 
 
-uint32_t MatTextureBitmapSize(const MatTexture& tex, uint32_t bpp)
+inline uint32_t MatTextureBitmapSize(const MatTexture& tex, uint32_t bpp)
 {
     return GetBitmapSize(tex.header.height, tex.header.width, bpp);
 }
@@ -173,11 +175,11 @@ uint32_t MatTextureBitmapSize(const MatTexture& tex, uint32_t bpp)
 
 
 
-std::shared_ptr<Material> LoadMaterialFromFile(const std::string& path)
+inline std::shared_ptr<Material> LoadMaterialFromFile(const std::string& path)
 {
     try
     {
-        InputFileStream ifstream(path);
+        BufferedInputStream ifstream(MakeStreamPtr<InputFileStream>(path));
 
         /* Read header */
         auto header = ifstream.read<MatHeader>();
@@ -233,15 +235,19 @@ std::shared_ptr<Material> LoadMaterialFromFile(const std::string& path)
     }
 }
 
-static bool SaveMaterialToFile(std::string file, const Material& mat)
+/* Saves material to MAT file. If sync is false file is not flushed to disk on close. */
+inline bool SaveMaterialToFile(std::string file, const Material& mat, bool sync = true)
 {
+    LIBIM_STATS_SCOPED_TIMER("SaveMaterialToFile");
     if(mat.mipmaps().empty() || mat.mipmaps().at(0).empty()) {
         return false;
     }
 
     try
     {
-        OutputFileStream ofstream(std::move(file));
+        auto ofs = MakeStreamPtr<OutputFileStream>(std::move(file));
+        ofs->setSyncOnClose(sync);
+        BufferedOutputStream ofstream(std::move(ofs));
 
         /* Write MAT header to file */
         MatHeader header{};
@@ -279,6 +285,7 @@ static bool SaveMaterialToFile(std::string file, const Material& mat)
             }
         }
 
+        ofstream.flush();
         return true;
     }
     catch (const std::exception& e)
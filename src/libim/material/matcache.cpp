@@ -0,0 +1,319 @@
+#include "matcache.h"
+#include "../common.h"
+#include "../io/filestream.h"
+#include "../utils/hash.h"
+
+#include <atomic>
+#include <cstdlib>
+#include <exception>
+#include <memory>
+
+#ifdef OS_WINDOWS
+#  include <process.h>
+#  include <sys/types.h>
+#  include <sys/stat.h>
+#else
+#  include <unistd.h>
+#endif
+
+namespace {
+    constexpr uint32_t kEntryMagic    = 0x31434D49; // "IMC1"
+    constexpr uint32_t kManifestMagic = 0x314D4D49; // "IMM1"
+
+    struct FileStamp
+    {
+        uint64_t size  = 0;
+        int64_t  mtime = 0; // ns since epoch where supported, otherwise seconds
+    };
+
+    bool GetFileStamp(const std::string& file, FileStamp& stamp)
+    {
+#ifdef OS_WINDOWS
+        struct _stat64 st;
+        if(_stat64(file.c_str(), &st) != 0) {
+            return false;
+        }
+        stamp.mtime = int64_t(st.st_mtime);
+#else
+        struct stat st;
+        if(stat(file.c_str(), &st) != 0) {
+            return false;
+        }
+#  if defined(__linux__)
+        stamp.mtime = int64_t(st.st_mtim.tv_sec) * 1000000000 + st.st_mtim.tv_nsec;
+#  else
+        stamp.mtime = int64_t(st.st_mtime);
+#  endif
+#endif
+        stamp.size = uint64_t(st.st_size);
+        return true;
+    }
+
+    std::string GetAbsolutePath(const std::string& path)
+    {
+#ifdef OS_WINDOWS
+        char buffer[_MAX_PATH];
+        return _fullpath(buffer, path.c_str(), _MAX_PATH) ? std::string(buffer) : path;
+#else
+        char* absPath = realpath(path.c_str(), nullptr);
+        if(!absPath) {
+            return path;
+        }
+
+        std::string result(absPath);
+        free(absPath);
+        return result;
+#endif
+    }
+
+    /* Creates every missing directory of path. Unlike MakePath path components can contain dots. */
+    bool MakeDirs(const std::string& path)
+    {
+        std::string current = !path.empty() && path.at(0) == PathSeparator() ? std::string(1, PathSeparator()) : "";
+        for(auto& part : SplitString(GetNativePath(path), PathSeparator()))
+        {
+            if(part.empty()) {
+                continue;
+            }
+
+            current += part;
+            if(!DirExists(current) && !MakeDir(current) && !DirExists(current)) {
+                return false;
+            }
+            current += PathSeparator();
+        }
+        return true;
+    }
+
+    /* Returns unique temporary file path next to path */
+    std::string MakeTempPath(const std::string& path)
+    {
+        static std::atomic<uint64_t> counter(0);
+#ifdef OS_WINDOWS
+        const auto pid = _getpid();
+#else
+        const auto pid = getpid();
+#endif
+        return path + ".tmp" + std::to_string(pid) + "_" + std::to_string(counter++);
+    }
+
+    std::string ReadString(const InputStream& istream)
+    {
+        const auto len  = istream.read<uint32_t>();
+        const auto data = istream.read(std::size_t(len));
+        return std::string(data.begin(), data.end());
+    }
+
+    void WriteString(Stream& ostream, const std::string& str)
+    {
+        ostream.write(uint32_t(str.size()));
+        ostream.write(reinterpret_cast<const byte_t*>(str.data()), str.size());
+    }
+
+    /* Renames temporary file over path or removes it on failure */
+    bool Publish(const std::string& tmpPath, const std::string& path)
+    {
+        if(!RenameFile(tmpPath, path))
+        {
+            RemoveFile(tmpPath);
+            return false;
+        }
+        return true;
+    }
+}
+
+
+MaterialCache::MaterialCache(std::string dir) :
+    m_dir(std::move(dir))
+{
+    if(!MakeDirs(m_dir + "/objects") || !MakeDirs(m_dir + "/cnd")) {
+        throw FileStreamError("Failed to create material cache directory: " + m_dir);
+    }
+}
+
+const std::string& MaterialCache::dir() const
+{
+    return m_dir;
+}
+
+std::string MaterialCache::entryPath(uint64_t hash, const std::string& kind) const
+{
+    const auto hex = libim::HashToHex(hash);
+    return m_dir + "/objects/" + hex.substr(0, 2) + "/" + hex + "." + kind;
+}
+
+std::string MaterialCache::manifestPath(const std::string& cndFile) const
+{
+    const auto absPath = GetAbsolutePath(cndFile);
+    return m_dir + "/cnd/" + libim::HashToHex(libim::XXH64(absPath.data(), absPath.size()));
+}
+
+std::vector<uint64_t> MaterialCache::loadManifest(const std::string& cndFile) const
+{
+    FileStamp stamp;
+    const auto path = manifestPath(cndFile);
+    if(!GetFileStamp(cndFile, stamp) || !FileExists(path)) {
+        return {};
+    }
+
+    try
+    {
+        InputFileStream ifs(path);
+        if(ifs.read<uint32_t>() != kManifestMagic ||
+           ReadString(ifs) != GetAbsolutePath(cndFile) ||
+           ifs.read<uint64_t>() != stamp.size ||
+           ifs.read<int64_t>() != stamp.mtime) {
+            return {};
+        }
+
+        const auto nHashes = ifs.read<uint32_t>();
+        if(ifs.size() - ifs.tell() != nHashes * sizeof(uint64_t)) {
+            return {};
+        }
+        return ifs.read<std::vector<uint64_t>>(nHashes);
+    }
+    catch(const std::exception&) {
+        return {};
+    }
+}
+
+bool MaterialCache::storeManifest(const std::string& cndFile, const std::vector<uint64_t>& hashes)
+{
+    FileStamp stamp;
+    if(!GetFileStamp(cndFile, stamp)) {
+        return false;
+    }
+
+    const auto path    = manifestPath(cndFile);
+    const auto tmpPath = MakeTempPath(path);
+    try
+    {
+        {
+            OutputFileStream ofs(tmpPath);
+            ofs.write(kManifestMagic);
+            WriteString(ofs, GetAbsolutePath(cndFile));
+            ofs.write(stamp.size);
+            ofs.write(stamp.mtime);
+            ofs.write(uint32_t(hashes.size()));
+            ofs.write(hashes);
+        }
+        return Publish(tmpPath, path);
+    }
+    catch(const std::exception&)
+    {
+        RemoveFile(tmpPath);
+        return false;
+    }
+}
+
+bool MaterialCache::contains(uint64_t hash, const std::string& kind) const
+{
+    return FileExists(entryPath(hash, kind));
+}
+
+bool MaterialCache::fetch(uint64_t hash, const std::string& kind, const std::string& dstDir, bool sync, std::vector<std::string>* fileNames) const
+{
+    const auto path = entryPath(hash, kind);
+    if(!FileExists(path)) {
+        return false;
+    }
+
+    try
+    {
+        InputFileStream ifs(path);
+        if(ifs.read<uint32_t>() != kEntryMagic) {
+            return false;
+        }
+
+        /* Read entry file table; file data follows the table in the same order */
+        const auto nFiles = ifs.read<uint32_t>();
+        std::vector<std::pair<std::string, uint64_t>> files;
+        files.reserve(nFiles);
+        for(uint32_t i = 0; i < nFiles; i++)
+        {
+            auto name = ReadString(ifs);
+            if(name.empty() || name.find_first_of("/\\") != std::string::npos) {
+                return false;
+            }
+            files.emplace_back(std::move(name), ifs.read<uint64_t>());
+        }
+
+        std::size_t offset = ifs.tell();
+        for(const auto& file : files)
+        {
+            if(offset + file.second > ifs.size()) {
+                return false;
+            }
+            offset += std::size_t(file.second);
+        }
+
+        ByteArray buffer;
+        offset = ifs.tell();
+        for(const auto& file : files)
+        {
+            /* OutputFileStream doesn't truncate existing file */
+            const auto dstPath = dstDir + "/" + file.first;
+            RemoveFile(dstPath);
+
+            OutputFileStream ofs(dstPath);
+            ofs.setSyncOnClose(sync);
+            if(file.second > 0) {
+                ofs.write(ifs, offset, std::size_t(file.second), buffer);
+            }
+
+            offset += std::size_t(file.second);
+            if(fileNames) {
+                fileNames->push_back(file.first);
+            }
+        }
+
+        return true;
+    }
+    catch(const std::exception&) {
+        return false;
+    }
+}
+
+bool MaterialCache::store(uint64_t hash, const std::string& kind, const std::vector<std::string>& files)
+{
+    const auto path = entryPath(hash, kind);
+    if(!MakeDirs(path.substr(0, path.find_last_of('/')))) {
+        return false;
+    }
+
+    const auto tmpPath = MakeTempPath(path);
+    try
+    {
+        {
+            std::vector<std::unique_ptr<InputFileStream>> inputs;
+            inputs.reserve(files.size());
+            for(const auto& file : files) {
+                inputs.push_back(std::make_unique<InputFileStream>(file));
+            }
+
+            OutputFileStream ofs(tmpPath);
+            ofs.setSyncOnClose(false); // cache entry can be rebuilt if lost
+            ofs.write(kEntryMagic);
+            ofs.write(uint32_t(files.size()));
+            for(std::size_t i = 0; i < files.size(); i++)
+            {
+                WriteString(ofs, GetFileName(files.at(i)));
+                ofs.write(uint64_t(inputs.at(i)->size()));
+            }
+
+            ByteArray buffer;
+            for(const auto& ifs : inputs)
+            {
+                if(ifs->size() > 0) {
+                    ofs.write(*ifs, 0, ifs->size(), buffer);
+                }
+            }
+        }
+        return Publish(tmpPath, path);
+    }
+    catch(const std::exception&)
+    {
+        RemoveFile(tmpPath);
+        return false;
+    }
+}
@@ -0,0 +1,45 @@
+#ifndef LIBIM_MATCACHE_H
+#define LIBIM_MATCACHE_H
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/* Persistent content addressed cache of files made from CND materials, e.g. MAT files and converted bitmaps.
+   Cache entry is identified by material hash (CND::CndMaterialIndex::hashMaterial) and kind of output
+   (e.g. "mat", "bmp", "bmp32") and stores a set of named files packed in one file <dir>/objects/<hh>/<hash>.<kind>.
+   Manifest of CND file stores hashes of all its materials and is keyed by file path, size and modification time,
+   so materials of unchanged CND file are found in cache without reading the file.
+   Entries and manifests are written to temporary files and renamed so concurrent runs and interrupted runs
+   never leave partially written entries. All methods can be called concurrently. */
+class MaterialCache
+{
+public:
+    /* Opens cache in dir, directory is created if it doesn't exist. Throws FileStreamError on error. */
+    explicit MaterialCache(std::string dir);
+
+    const std::string& dir() const;
+
+    /* Returns material hashes stored in manifest of cndFile. Empty vector is returned
+       if there is no manifest or cndFile was modified after the manifest was stored. */
+    std::vector<uint64_t> loadManifest(const std::string& cndFile) const;
+    bool storeManifest(const std::string& cndFile, const std::vector<uint64_t>& hashes);
+
+    bool contains(uint64_t hash, const std::string& kind) const;
+
+    /* Copies files of entry to dstDir. Names of copied files are appended to fileNames if not null.
+       Returns false if entry doesn't exist or is corrupted. */
+    bool fetch(uint64_t hash, const std::string& kind, const std::string& dstDir, bool sync = true, std::vector<std::string>* fileNames = nullptr) const;
+
+    /* Stores copy of files as entry. Files are stored under their file names. Existing entry is replaced. */
+    bool store(uint64_t hash, const std::string& kind, const std::vector<std::string>& files);
+
+private:
+    std::string entryPath(uint64_t hash, const std::string& kind) const;
+    std::string manifestPath(const std::string& cndFile) const;
+
+private:
+    std::string m_dir;
+};
+
+#endif // LIBIM_MATCACHE_H
@@ -1,6 +1,7 @@
 #ifndef MATERIAL_H
 #define MATERIAL_H
 #include <cstdint>
+#include <stdexcept>
 #include <string>
 #include <utility>
 #include <vector>
@@ -143,9 +144,21 @@ inline Bitmap::const_iterator CopyMipmapFromBuffer(Mipmap& mipmap, const Bitmap&
     return itBitmapEnd;
 }
 
-inline Mipmap MoveMipmapFromBuffer(Bitmap& buffer, uint32_t textureCount, uint32_t width, uint32_t height, const ColorFormat& colorInfo)
+/* Returns arena big enough to hold numTextures bitmaps with pixelDataSize bytes of pixel data in total */
+inline std::shared_ptr<libim::Arena> MakeBitmapArena(std::size_t pixelDataSize, std::size_t numTextures)
+{
+    constexpr std::size_t nBitmapOverhead = 128; // shared_ptr control block with Bitmap object and alignment
+    return std::make_shared<libim::Arena>(pixelDataSize + numTextures * nBitmapOverhead);
+}
+
+/* Reads mipmap's textures from buffer starting at offset. Offset is advanced past the read pixel data.
+   If arena is not null texture bitmaps are allocated from arena.
+   Throws std::out_of_range if buffer is too small. */
+inline Mipmap ReadMipmapFromBuffer(const Bitmap& buffer, std::size_t& offset, uint32_t textureCount, uint32_t width, uint32_t height, const ColorFormat& colorInfo,
+                                   const std::shared_ptr<libim::Arena>& arena = nullptr)
 {
     Mipmap mipmap;
+    mipmap.reserve(textureCount);
     for(uint32_t mmIdx = 0; mmIdx < textureCount; mmIdx++) // Mipmap's textures
     {
         /* Calculate texture's size according to the mipmap index */
@@ -160,13 +173,15 @@ inline Mipmap MoveMipmapFromBuffer(Bitmap& buffer, uint32_t textureCount, uint32
 
         /* Init texture bitmap buffer */
         uint32_t bitmapSize = GetBitmapSize(texWidth, texHeight, tex.colorInfo().bpp);
-        auto bitmap = std::make_shared<Bitmap>(bitmapSize);
+        if(offset > buffer.size() || buffer.size() - offset < bitmapSize) {
+            throw std::out_of_range("ReadMipmapFromBuffer: buffer too small");
+        }
 
         /* Copy texture's bitmap from buffer */
-        auto itBitmapEnd = std::next(buffer.begin(), bitmapSize);
-        std::copy(buffer.begin(), itBitmapEnd, bitmap->begin());
+        auto itBitmapBegin = std::next(buffer.begin(), offset);
+        auto bitmap = MakeBitmapPtr(itBitmapBegin, std::next(itBitmapBegin, bitmapSize), arena);
+        offset += bitmapSize;
 
-        buffer.erase(buffer.begin(), itBitmapEnd);
         tex.setBitmap(std::move(bitmap));
         mipmap.emplace_back(std::move(tex));
     }
@@ -174,6 +189,16 @@ inline Mipmap MoveMipmapFromBuffer(Bitmap& buffer, uint32_t textureCount, uint32
     return mipmap;
 }
 
+/* Moves mipmap's textures from the beginning of buffer. Moved pixel data is erased from buffer.
+   Note: erasing shifts the rest of buffer, use ReadMipmapFromBuffer to read many mipmaps from one buffer. */
+inline Mipmap MoveMipmapFromBuffer(Bitmap& buffer, uint32_t textureCount, uint32_t width, uint32_t height, const ColorFormat& colorInfo)
+{
+    std::size_t offset = 0;
+    auto mipmap = ReadMipmapFromBuffer(buffer, offset, textureCount, width, height, colorInfo);
+    buffer.erase(buffer.begin(), std::next(buffer.begin(), offset));
+    return mipmap;
+}
+
 template<> inline Mipmap Stream::read<Mipmap, uint32_t, uint32_t, uint32_t, const ColorFormat&>(uint32_t textureCount, uint32_t width, uint32_t height, const ColorFormat& colorInfo) const
 {
     Mipmap mipmap;
@@ -0,0 +1,207 @@
+#include "mipmapgen.h"
+#include "pixelconv.h"
+#include "../utils/threadpool.h"
+
+#include <iterator>
+#include <stdexcept>
+#include <utility>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+# define MIPMAPGEN_SSE2
+# include <emmintrin.h>
+#endif
+
+namespace {
+
+    constexpr std::size_t kRgbaSize = 4;
+
+    /* Downsamples rows [0, dstHeight) of dst with 2x2 box filter from RGBA_8888 src, starting at column x */
+    void DownsampleScalar(const byte_t* src, uint32_t srcWidth, byte_t* dst, uint32_t dstWidth, uint32_t dstHeight, uint32_t x)
+    {
+        const std::size_t srcStride = std::size_t(srcWidth) * kRgbaSize;
+        const std::size_t dstStride = std::size_t(dstWidth) * kRgbaSize;
+        for(uint32_t y = 0; y < dstHeight; y++)
+        {
+            const byte_t* r0 = src + 2 * y * srcStride;
+            const byte_t* r1 = r0 + srcStride;
+            byte_t* d = dst + y * dstStride;
+            for(std::size_t i = std::size_t(x) * kRgbaSize; i < dstStride; i++)
+            {
+                const std::size_t c = (i / kRgbaSize) * 2 * kRgbaSize + i % kRgbaSize;
+                d[i] = byte_t((r0[c] + r0[c + kRgbaSize] + r1[c] + r1[c + kRgbaSize] + 2) >> 2);
+            }
+        }
+    }
+
+#ifdef MIPMAPGEN_SSE2
+    /* Sums 2x2 blocks of 4 source pixels from two rows into 2 pixels with 16 bit channels */
+    inline __m128i BoxSum2(const byte_t* r0, const byte_t* r1)
+    {
+        const __m128i zero = _mm_setzero_si128();
+        const __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(r0));
+        const __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(r1));
+        const __m128i lo = _mm_add_epi16(_mm_unpacklo_epi8(a, zero), _mm_unpacklo_epi8(b, zero)); // px 0, 1
+        const __m128i hi = _mm_add_epi16(_mm_unpackhi_epi8(a, zero), _mm_unpackhi_epi8(b, zero)); // px 2, 3
+        const __m128i s  = _mm_add_epi16(_mm_unpacklo_epi64(lo, hi), _mm_unpackhi_epi64(lo, hi));
+        return _mm_srli_epi16(_mm_add_epi16(s, _mm_set1_epi16(2)), 2);
+    }
+
+    /* Returns number of downsampled columns */
+    uint32_t DownsampleSSE2(const byte_t* src, uint32_t srcWidth, byte_t* dst, uint32_t dstWidth, uint32_t dstHeight)
+    {
+        const std::size_t srcStride = std::size_t(srcWidth) * kRgbaSize;
+        const std::size_t dstStride = std::size_t(dstWidth) * kRgbaSize;
+        const uint32_t nCols = dstWidth & ~3u; // 4 output pixels per iteration
+        for(uint32_t y = 0; y < dstHeight; y++)
+        {
+            const byte_t* r0 = src + 2 * y * srcStride;
+            const byte_t* r1 = r0 + srcStride;
+            byte_t* d = dst + y * dstStride;
+            for(uint32_t x = 0; x < nCols; x += 4)
+            {
+                const std::size_t off = std::size_t(x) * 2 * kRgbaSize;
+                const __m128i s0 = BoxSum2(r0 + off,      r1 + off);
+                const __m128i s1 = BoxSum2(r0 + off + 16, r1 + off + 16);
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(d + std::size_t(x) * kRgbaSize), _mm_packus_epi16(s0, s1));
+            }
+        }
+
+        return nCols;
+    }
+#endif
+
+    void Downsample(const byte_t* src, uint32_t srcWidth, byte_t* dst, uint32_t dstWidth, uint32_t dstHeight)
+    {
+        uint32_t x = 0;
+    #ifdef MIPMAPGEN_SSE2
+        x = DownsampleSSE2(src, srcWidth, dst, dstWidth, dstHeight);
+    #endif
+        if(x < dstWidth) {
+            DownsampleScalar(src, srcWidth, dst, dstWidth, dstHeight, x);
+        }
+    }
+
+    Texture MakeTexture(uint32_t width, uint32_t height, const ColorFormat& format, BitmapPtr bitmap)
+    {
+        Texture tex;
+        tex.setWidth(width)
+           .setHeight(height)
+           .setColorInfo(format)
+           .setRowSize(GetRowSize(width, format.bpp))
+           .setBitmap(std::move(bitmap));
+        return tex;
+    }
+}
+
+uint32_t GetMaxMipmapLevels(uint32_t width, uint32_t height)
+{
+    uint32_t levels = 0;
+    while(width > 0 && height > 0)
+    {
+        levels++;
+        width  >>= 1;
+        height >>= 1;
+    }
+    return levels;
+}
+
+Mipmap MakeMipmap(const Texture& base, uint32_t numLevels)
+{
+    const auto& format  = base.colorInfo();
+    const uint32_t width  = base.width();
+    const uint32_t height = base.height();
+
+    const auto bitmap = base.bitmap();
+    if(!bitmap || width == 0 || height == 0 || bitmap->size() < GetBitmapSize(width, height, format.bpp)) {
+        throw std::invalid_argument("MakeMipmap: base texture has no or invalid bitmap");
+    }
+
+    if(!CanConvertPixels(format, RGBA_8888)) {
+        throw std::invalid_argument("MakeMipmap: unsupported texture color format");
+    }
+
+    const uint32_t maxLevels = GetMaxMipmapLevels(width, height);
+    if(numLevels == 0 || numLevels > maxLevels) {
+        numLevels = maxLevels;
+    }
+
+    Mipmap mipmap;
+    mipmap.reserve(numLevels);
+    mipmap.push_back(base);
+    if(numLevels < 2) {
+        return mipmap;
+    }
+
+    /* Decode base level */
+    Bitmap src(std::size_t(width) * height * kRgbaSize);
+    ConvertPixels(bitmap->data(), format, src.data(), RGBA_8888, std::size_t(width) * height);
+
+    Bitmap dst(std::size_t(width >> 1) * (height >> 1) * kRgbaSize);
+    uint32_t srcWidth = width;
+    for(uint32_t level = 1; level < numLevels; level++)
+    {
+        const uint32_t w = width  >> level;
+        const uint32_t h = height >> level;
+        Downsample(src.data(), srcWidth, dst.data(), w, h);
+
+        /* Encode level to base format */
+        auto levelBitmap = MakeBitmapPtr(GetBitmapSize(w, h, format.bpp));
+        ConvertPixels(dst.data(), RGBA_8888, levelBitmap->data(), format, std::size_t(w) * h);
+        mipmap.push_back(MakeTexture(w, h, format, std::move(levelBitmap)));
+
+        std::swap(src, dst);
+        srcWidth = w;
+    }
+
+    return mipmap;
+}
+
+std::vector<Mipmap> MakeMipmaps(const std::vector<Texture>& bases, uint32_t numLevels, std::size_t numThreads)
+{
+    std::vector<Mipmap> mipmaps(bases.size());
+    if(bases.size() < 2 || numThreads == 1)
+    {
+        for(std::size_t i = 0; i < bases.size(); i++) {
+            mipmaps[i] = MakeMipmap(bases[i], numLevels);
+        }
+        return mipmaps;
+    }
+
+    libim::ThreadPool pool(numThreads);
+    for(std::size_t i = 0; i < bases.size(); i++)
+    {
+        pool.submit([&, i]() {
+            mipmaps[i] = MakeMipmap(bases[i], numLevels);
+        });
+    }
+
+    pool.wait();
+    return mipmaps;
+}
+
+void GenerateMipmaps(std::vector<Material>& materials, uint32_t numLevels, std::size_t numThreads)
+{
+    std::vector<Texture> bases;
+    for(const auto& mat : materials)
+    {
+        for(const auto& mipmap : mat.mipmaps())
+        {
+            if(mipmap.empty()) {
+                throw std::invalid_argument("GenerateMipmaps: material '" + mat.name() + "' has empty mipmap");
+            }
+            bases.push_back(mipmap.at(0));
+        }
+    }
+
+    auto mipmaps = MakeMipmaps(bases, numLevels, numThreads);
+
+    std::size_t idx = 0;
+    for(auto& mat : materials)
+    {
+        const std::size_t nMipmaps = mat.mipmaps().size();
+        std::vector<Mipmap> matMipmaps(std::make_move_iterator(mipmaps.begin() + idx),
+                                       std::make_move_iterator(mipmaps.begin() + idx + nMipmaps));
+        mat.setMipmaps(std::move(matMipmaps));
+        idx += nMipmaps;
+    }
+}
@@ -0,0 +1,30 @@
+#ifndef LIBIM_MIPMAPGEN_H
+#define LIBIM_MIPMAPGEN_H
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "material.h"
+#include "texture.h"
+
+/* Mipmap chain generation with 2x2 box filter.
+   Texture i of generated mipmap has size (width >> i) x (height >> i), which is the layout
+   CopyMipmapFromBuffer and SaveMaterialToFile expect. Base texture is decoded to RGBA_8888 once,
+   every level is downsampled from the previous one and encoded back to the base color format. */
+
+/* Returns number of textures in full mipmap chain, i.e. until one of the sides would become 0 */
+uint32_t GetMaxMipmapLevels(uint32_t width, uint32_t height);
+
+/* Returns mipmap of numLevels textures made from base texture. The first texture is the base.
+   If numLevels is 0 or greater than GetMaxMipmapLevels full chain is made.
+   Throws std::invalid_argument if base texture has no bitmap or its color format is not supported. */
+Mipmap MakeMipmap(const Texture& base, uint32_t numLevels = 0);
+
+/* Makes mipmaps for all base textures in parallel using numThreads threads (0 = all hardware threads) */
+std::vector<Mipmap> MakeMipmaps(const std::vector<Texture>& bases, uint32_t numLevels = 0, std::size_t numThreads = 0);
+
+/* Replaces every mipmap of materials with the chain made from the mipmap's first texture.
+   Work is distributed over all mipmaps of all materials. */
+void GenerateMipmaps(std::vector<Material>& materials, uint32_t numLevels = 0, std::size_t numThreads = 0);
+
+#endif // LIBIM_MIPMAPGEN_H
@@ -0,0 +1,173 @@
+#ifndef LIBIM_PIXELCODEC_H
+#define LIBIM_PIXELCODEC_H
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+#include "colorformat.h"
+#include "common.h"
+
+/* Compile time pixel codecs. PixelCodec<RGB_565> decodes and encodes pixels with shifts
+   and masks known at compile time, so loops over pixels are unrolled and vectorized by compiler.
+   Use DispatchPixelCodec to select codec from runtime ColorFormat. */
+
+struct PixelRgba
+{
+    uint8_t r;
+    uint8_t g;
+    uint8_t b;
+    uint8_t a;
+};
+
+namespace detail {
+
+    /* Factors for expansion of n bit channel to 8 bits by bit replication: c8 = (c * mul) >> shr */
+    constexpr uint32_t ChannelExpandMul(uint32_t bits)
+    {
+        uint32_t mul = 0;
+        for(uint32_t total = 0; bits > 0 && total < 8; total += bits) {
+            mul = (mul << bits) | 1;
+        }
+        return mul;
+    }
+
+    constexpr uint32_t ChannelExpandShr(uint32_t bits)
+    {
+        uint32_t total = 0;
+        while(bits > 0 && total < 8) {
+            total += bits;
+        }
+        return bits > 0 ? total - 8 : 0;
+    }
+
+    template<uint32_t Bits, uint32_t Shl>
+    struct ChannelCodec
+    {
+        static_assert(Bits <= 8, "Channel can have at most 8 bits");
+        static constexpr uint32_t mask = (1u << Bits) - 1;
+        static constexpr uint32_t mul  = ChannelExpandMul(Bits);
+        static constexpr uint32_t shr  = ChannelExpandShr(Bits);
+
+        /* Returns 8 bit channel value or missing if channel is not present */
+        static constexpr uint8_t decode(uint32_t pixel, uint8_t missing)
+        {
+            return Bits == 0 ? missing : uint8_t((((pixel >> Shl) & mask) * mul) >> shr);
+        }
+
+        static constexpr uint32_t encode(uint8_t c)
+        {
+            return Bits == 0 ? 0 : (uint32_t(c) >> (8 - Bits)) << Shl;
+        }
+    };
+}
+
+template<uint32_t Bpp,
+         uint32_t RBits, uint32_t RShl,
+         uint32_t GBits, uint32_t GShl,
+         uint32_t BBits, uint32_t BShl,
+         uint32_t ABits, uint32_t AShl>
+struct BasicPixelCodec
+{
+    static_assert(Bpp == 16 || Bpp == 32, "Only 16 and 32 bit pixels are supported");
+
+    using Pixel = std::conditional_t<Bpp == 16, uint16_t, uint32_t>;
+    static constexpr std::size_t pixelSize = Bpp / 8;
+    static constexpr bool hasAlpha = ABits > 0;
+
+    using Red   = detail::ChannelCodec<RBits, RShl>;
+    using Green = detail::ChannelCodec<GBits, GShl>;
+    using Blue  = detail::ChannelCodec<BBits, BShl>;
+    using Alpha = detail::ChannelCodec<ABits, AShl>;
+
+    /* Missing color channel decodes as 0 and missing alpha as opaque */
+    static constexpr PixelRgba decode(Pixel p)
+    {
+        return { Red::decode(p, 0), Green::decode(p, 0), Blue::decode(p, 0), Alpha::decode(p, 0xFF) };
+    }
+
+    static constexpr Pixel encode(const PixelRgba& c)
+    {
+        return Pixel(Red::encode(c.r) | Green::encode(c.g) | Blue::encode(c.b) | Alpha::encode(c.a));
+    }
+
+    static Pixel load(const byte_t* src)
+    {
+        Pixel p;
+        std::memcpy(&p, src, sizeof(p));
+        return p;
+    }
+
+    static void store(byte_t* dst, Pixel p)
+    {
+        std::memcpy(dst, &p, sizeof(p));
+    }
+
+    static PixelRgba decodeAt(const byte_t* src, std::size_t idx)
+    {
+        return decode(load(src + idx * pixelSize));
+    }
+
+    static void encodeAt(byte_t* dst, std::size_t idx, const PixelRgba& c)
+    {
+        store(dst + idx * pixelSize, encode(c));
+    }
+};
+
+template<const ColorFormat& F>
+using PixelCodec = BasicPixelCodec<F.bpp,
+                                   F.redBPP,   F.RedShl,
+                                   F.greenBPP, F.GreenShl,
+                                   F.blueBPP,  F.BlueShl,
+                                   F.alphaBPP, F.AlphaShl>;
+
+/* Returns true if pixels of both formats have the same memory layout */
+inline bool IsSamePixelLayout(const ColorFormat& lhs, const ColorFormat& rhs)
+{
+    return lhs.bpp      == rhs.bpp      &&
+           lhs.redBPP   == rhs.redBPP   && lhs.RedShl   == rhs.RedShl   &&
+           lhs.greenBPP == rhs.greenBPP && lhs.GreenShl == rhs.GreenShl &&
+           lhs.blueBPP  == rhs.blueBPP  && lhs.BlueShl  == rhs.BlueShl  &&
+           lhs.alphaBPP == rhs.alphaBPP && lhs.AlphaShl == rhs.AlphaShl;
+}
+
+/* Calls f with instance of PixelCodec matching format.
+   Returns false if there is no compile time codec for format and f was not called. */
+template<typename F>
+bool DispatchPixelCodec(const ColorFormat& format, F&& f)
+{
+    if(IsSamePixelLayout(format, RGB_565)) {
+        f(PixelCodec<RGB_565>{});
+    }
+    else if(IsSamePixelLayout(format, RGBA_4444)) {
+        f(PixelCodec<RGBA_4444>{});
+    }
+    else if(IsSamePixelLayout(format, ARGB_4444)) {
+        f(PixelCodec<ARGB_4444>{});
+    }
+    else if(IsSamePixelLayout(format, ARGB_5551)) {
+        f(PixelCodec<ARGB_5551>{});
+    }
+    else if(IsSamePixelLayout(format, RGBA_8888)) {
+        f(PixelCodec<RGBA_8888>{});
+    }
+    else if(IsSamePixelLayout(format, BGRA_8888)) {
+        f(PixelCodec<BGRA_8888>{});
+    }
+    else {
+        return false;
+    }
+
+    return true;
+}
+
+/* Converts numPixels pixels from SrcCodec to DstCodec */
+template<typename SrcCodec, typename DstCodec>
+void TranscodePixels(const byte_t* src, byte_t* dst, std::size_t numPixels)
+{
+    for(std::size_t i = 0; i < numPixels; i++) {
+        DstCodec::encodeAt(dst, i, SrcCodec::decodeAt(src, i));
+    }
+}
+
+#endif // LIBIM_PIXELCODEC_H
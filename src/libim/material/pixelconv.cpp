@@ -0,0 +1,542 @@
+#include "pixelconv.h"
+#include "pixelcodec.h"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+# if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#  define PIXELCONV_SSE2
+#  include <emmintrin.h>
+# endif
+# if defined(__GNUC__) || defined(__clang__)
+#  define PIXELCONV_AVX2
+#  define PIXELCONV_AVX2_RUNTIME_CHECK  // AVX2 kernels are compiled with target attribute and enabled by cpuid
+#  define PIXELCONV_AVX2_TARGET __attribute__((target("avx2")))
+#  include <immintrin.h>
+# elif defined(__AVX2__)
+#  define PIXELCONV_AVX2
+#  define PIXELCONV_AVX2_TARGET
+#  include <immintrin.h>
+# endif
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+# define PIXELCONV_NEON
+# include <arm_neon.h>
+#endif
+
+namespace {
+
+    constexpr std::size_t kNumChannels = 4; // R, G, B, A
+
+    struct Channel
+    {
+        uint32_t bits = 0;
+        uint32_t shl  = 0;
+    };
+
+    struct Channels
+    {
+        Channel ch[kNumChannels];
+        uint32_t bpp;
+    };
+
+    Channels GetChannels(const ColorFormat& cf)
+    {
+        Channels c;
+        c.ch[0] = { uint32_t(cf.redBPP),   uint32_t(cf.RedShl)   };
+        c.ch[1] = { uint32_t(cf.greenBPP), uint32_t(cf.GreenShl) };
+        c.ch[2] = { uint32_t(cf.blueBPP),  uint32_t(cf.BlueShl)  };
+        c.ch[3] = { uint32_t(cf.alphaBPP), uint32_t(cf.AlphaShl) };
+        c.bpp   = uint32_t(cf.bpp);
+        return c;
+    }
+
+    inline uint32_t LoadPixel(const byte_t* src, uint32_t bpp)
+    {
+        if(bpp == 16)
+        {
+            uint16_t p;
+            std::memcpy(&p, src, sizeof(p));
+            return p;
+        }
+
+        uint32_t p;
+        std::memcpy(&p, src, sizeof(p));
+        return p;
+    }
+
+    inline void StorePixel(byte_t* dst, uint32_t bpp, uint32_t p)
+    {
+        if(bpp == 16)
+        {
+            const uint16_t p16 = static_cast<uint16_t>(p);
+            std::memcpy(dst, &p16, sizeof(p16));
+        }
+        else {
+            std::memcpy(dst, &p, sizeof(p));
+        }
+    }
+
+    /* Per channel conversion parameters shared by scalar and SIMD kernels */
+    struct ConvParams
+    {
+        struct
+        {
+            uint32_t srcShl;
+            uint32_t srcMask;
+            uint32_t mul;     // expansion to 8 bits
+            uint32_t mulShr;
+            uint32_t narShr;  // narrowing from 8 bits
+            uint32_t dstShl;
+        } ch[kNumChannels];
+
+        std::size_t numChannels = 0; // channels present in both formats
+        uint32_t constant = 0;       // opaque alpha bits when source has no alpha channel
+        uint32_t srcBpp = 0;
+        uint32_t dstBpp = 0;
+        bool bExpand = false;        // 16 -> 32 bit with 8 bit destination channels
+        bool bNarrow = false;        // 32 bit with 8 bit source channels -> 16 bit
+    };
+
+    ConvParams MakeConvParams(const ColorFormat& srcFormat, const ColorFormat& dstFormat)
+    {
+        const auto src = GetChannels(srcFormat);
+        const auto dst = GetChannels(dstFormat);
+
+        ConvParams p;
+        p.srcBpp = src.bpp;
+        p.dstBpp = dst.bpp;
+
+        bool bDst8 = true;
+        bool bSrc8 = true;
+        for(std::size_t i = 0; i < kNumChannels; i++)
+        {
+            const auto& s = src.ch[i];
+            const auto& d = dst.ch[i];
+            if(d.bits == 0) {
+                continue;
+            }
+
+            bDst8 = bDst8 && d.bits == 8;
+            if(s.bits == 0)
+            {
+                /* Channel not present in source, rgb is 0 and alpha is opaque */
+                if(i == 3) {
+                    p.constant |= ((1u << d.bits) - 1) << d.shl;
+                }
+                continue;
+            }
+
+            bSrc8 = bSrc8 && s.bits == 8;
+
+            auto& c  = p.ch[p.numChannels++];
+            c.srcShl  = s.shl;
+            c.srcMask = (1u << s.bits) - 1;
+            c.mul     = detail::ChannelExpandMul(s.bits);
+            c.mulShr  = detail::ChannelExpandShr(s.bits);
+            c.narShr  = 8 - d.bits;
+            c.dstShl  = d.shl;
+        }
+
+        p.bExpand = src.bpp == 16 && dst.bpp == 32 && bDst8;
+        p.bNarrow = src.bpp == 32 && dst.bpp == 16 && bSrc8;
+        return p;
+    }
+
+    /* Converts pixels of any valid format with shifts and masks read at runtime */
+    void ConvertGeneric(const byte_t* src, byte_t* dst, std::size_t numPixels, const ConvParams& p)
+    {
+        const std::size_t srcStep = BBS(p.srcBpp);
+        const std::size_t dstStep = BBS(p.dstBpp);
+        for(std::size_t i = 0; i < numPixels; i++)
+        {
+            const uint32_t v = LoadPixel(src + i * srcStep, p.srcBpp);
+            uint32_t r = p.constant;
+            for(std::size_t c = 0; c < p.numChannels; c++)
+            {
+                const auto& ch = p.ch[c];
+                const uint32_t c8 = (((v >> ch.srcShl) & ch.srcMask) * ch.mul) >> ch.mulShr;
+                r |= (c8 >> ch.narShr) << ch.dstShl;
+            }
+            StorePixel(dst + i * dstStep, p.dstBpp, r);
+        }
+    }
+
+    void ConvertScalar(const byte_t* src, const ColorFormat& srcFormat, byte_t* dst, const ColorFormat& dstFormat, std::size_t numPixels, const ConvParams& p)
+    {
+        /* Use compile time codecs for known formats and fall back to generic conversion for the rest */
+        bool bConverted = false;
+        DispatchPixelCodec(srcFormat, [&](auto srcCodec) {
+            bConverted = DispatchPixelCodec(dstFormat, [&](auto dstCodec) {
+                TranscodePixels<decltype(srcCodec), decltype(dstCodec)>(src, dst, numPixels);
+            });
+        });
+
+        if(!bConverted) {
+            ConvertGeneric(src, dst, numPixels, p);
+        }
+    }
+
+#ifdef PIXELCONV_SSE2
+    std::size_t ExpandSSE2(const byte_t* src, byte_t* dst, std::size_t numPixels, const ConvParams& p)
+    {
+        __m128i srcShl[kNumChannels], mask[kNumChannels], mul[kNumChannels], mulShr[kNumChannels], dstShl[kNumChannels];
+        for(std::size_t c = 0; c < p.numChannels; c++)
+        {
+            srcShl[c] = _mm_cvtsi32_si128(int(p.ch[c].srcShl));
+            mask[c]   = _mm_set1_epi16(short(p.ch[c].srcMask));
+            mul[c]    = _mm_set1_epi16(short(p.ch[c].mul));
+            mulShr[c] = _mm_cvtsi32_si128(int(p.ch[c].mulShr));
+            dstShl[c] = _mm_cvtsi32_si128(int(p.ch[c].dstShl));
+        }
+
+        const __m128i zero     = _mm_setzero_si128();
+        const __m128i constant = _mm_set1_epi32(int(p.constant));
+
+        std::size_t i = 0;
+        for(; i + 8 <= numPixels; i += 8)
+        {
+            const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i * 2));
+            __m128i lo = constant;
+            __m128i hi = constant;
+            for(std::size_t c = 0; c < p.numChannels; c++)
+            {
+                __m128i x = _mm_and_si128(_mm_srl_epi16(v, srcShl[c]), mask[c]);
+                x  = _mm_srl_epi16(_mm_mullo_epi16(x, mul[c]), mulShr[c]);
+                lo = _mm_or_si128(lo, _mm_sll_epi32(_mm_unpacklo_epi16(x, zero), dstShl[c]));
+                hi = _mm_or_si128(hi, _mm_sll_epi32(_mm_unpackhi_epi16(x, zero), dstShl[c]));
+            }
+
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i * 4), lo);
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i * 4 + 16), hi);
+        }
+
+        return i;
+    }
+
+    std::size_t NarrowSSE2(const byte_t* src, byte_t* dst, std::size_t numPixels, const ConvParams& p)
+    {
+        __m128i srcShl[kNumChannels], narShr[kNumChannels], dstShl[kNumChannels];
+        for(std::size_t c = 0; c < p.numChannels; c++)
+        {
+            srcShl[c] = _mm_cvtsi32_si128(int(p.ch[c].srcShl));
+            narShr[c] = _mm_cvtsi32_si128(int(p.ch[c].narShr));
+            dstShl[c] = _mm_cvtsi32_si128(int(p.ch[c].dstShl));
+        }
+
+        const __m128i mask     = _mm_set1_epi32(0xFF);
+        const __m128i constant = _mm_set1_epi32(int(p.constant));
+
+        std::size_t i = 0;
+        for(; i + 8 <= numPixels; i += 8)
+        {
+            const __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i * 4));
+            const __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i * 4 + 16));
+            __m128i ra = constant;
+            __m128i rb = constant;
+            for(std::size_t c = 0; c < p.numChannels; c++)
+            {
+                const __m128i xa = _mm_srl_epi32(_mm_and_si128(_mm_srl_epi32(a, srcShl[c]), mask), narShr[c]);
+                const __m128i xb = _mm_srl_epi32(_mm_and_si128(_mm_srl_epi32(b, srcShl[c]), mask), narShr[c]);
+                ra = _mm_or_si128(ra, _mm_sll_epi32(xa, dstShl[c]));
+                rb = _mm_or_si128(rb, _mm_sll_epi32(xb, dstShl[c]));
+            }
+
+            /* Sign extend low 16 bits so signed saturating pack keeps them unchanged */
+            ra = _mm_srai_epi32(_mm_slli_epi32(ra, 16), 16);
+            rb = _mm_srai_epi32(_mm_slli_epi32(rb, 16), 16);
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i * 2), _mm_packs_epi32(ra, rb));
+        }
+
+        return i;
+    }
+#endif // PIXELCONV_SSE2
+
+#ifdef PIXELCONV_AVX2
+    PIXELCONV_AVX2_TARGET
+    std::size_t ExpandAVX2(const byte_t* src, byte_t* dst, std::size_t numPixels, const ConvParams& p)
+    {
+        __m128i srcShl[kNumChannels], mulShr[kNumChannels], dstShl[kNumChannels];
+        __m256i mask[kNumChannels], mul[kNumChannels];
+        for(std::size_t c = 0; c < p.numChannels; c++)
+        {
+            srcShl[c] = _mm_cvtsi32_si128(int(p.ch[c].srcShl));
+            mask[c]   = _mm256_set1_epi16(short(p.ch[c].srcMask));
+            mul[c]    = _mm256_set1_epi16(short(p.ch[c].mul));
+            mulShr[c] = _mm_cvtsi32_si128(int(p.ch[c].mulShr));
+            dstShl[c] = _mm_cvtsi32_si128(int(p.ch[c].dstShl));
+        }
+
+        const __m256i zero     = _mm256_setzero_si256();
+        const __m256i constant = _mm256_set1_epi32(int(p.constant));
+
+        std::size_t i = 0;
+        for(; i + 16 <= numPixels; i += 16)
+        {
+            const __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i * 2));
+            __m256i lo = constant; // pixels 0-3, 8-11
+            __m256i hi = constant; // pixels 4-7, 12-15
+            for(std::size_t c = 0; c < p.numChannels; c++)
+            {
+                __m256i x = _mm256_and_si256(_mm256_srl_epi16(v, srcShl[c]), mask[c]);
+                x  = _mm256_srl_epi16(_mm256_mullo_epi16(x, mul[c]), mulShr[c]);
+                lo = _mm256_or_si256(lo, _mm256_sll_epi32(_mm256_unpacklo_epi16(x, zero), dstShl[c]));
+                hi = _mm256_or_si256(hi, _mm256_sll_epi32(_mm256_unpackhi_epi16(x, zero), dstShl[c]));
+            }
+
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i * 4),      _mm256_permute2x128_si256(lo, hi, 0x20));
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i * 4 + 32), _mm256_permute2x128_si256(lo, hi, 0x31));
+        }
+
+        return i;
+    }
+
+    PIXELCONV_AVX2_TARGET
+    std::size_t NarrowAVX2(const byte_t* src, byte_t* dst, std::size_t numPixels, const ConvParams& p)
+    {
+        __m128i srcShl[kNumChannels], narShr[kNumChannels], dstShl[kNumChannels];
+        for(std::size_t c = 0; c < p.numChannels; c++)
+        {
+            srcShl[c] = _mm_cvtsi32_si128(int(p.ch[c].srcShl));
+            narShr[c] = _mm_cvtsi32_si128(int(p.ch[c].narShr));
+            dstShl[c] = _mm_cvtsi32_si128(int(p.ch[c].dstShl));
+        }
+
+        const __m256i mask     = _mm256_set1_epi32(0xFF);
+        const __m256i constant = _mm256_set1_epi32(int(p.constant));
+
+        std::size_t i = 0;
+        for(; i + 16 <= numPixels; i += 16)
+        {
+            const __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i * 4));
+            const __m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i * 4 + 32));
+            __m256i ra = constant;
+            __m256i rb = constant;
+            for(std::size_t c = 0; c < p.numChannels; c++)
+            {
+                const __m256i xa = _mm256_srl_epi32(_mm256_and_si256(_mm256_srl_epi32(a, srcShl[c]), mask), narShr[c]);
+                const __m256i xb = _mm256_srl_epi32(_mm256_and_si256(_mm256_srl_epi32(b, srcShl[c]), mask), narShr[c]);
+                ra = _mm256_or_si256(ra, _mm256_sll_epi32(xa, dstShl[c]));
+                rb = _mm256_or_si256(rb, _mm256_sll_epi32(xb, dstShl[c]));
+            }
+
+            ra = _mm256_srai_epi32(_mm256_slli_epi32(ra, 16), 16);
+            rb = _mm256_srai_epi32(_mm256_slli_epi32(rb, 16), 16);
+
+            /* Pack works per 128 bit lane, restore pixel order */
+            const __m256i r = _mm256_permute4x64_epi64(_mm256_packs_epi32(ra, rb), 0xD8);
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i * 2), r);
+        }
+
+        return i;
+    }
+#endif // PIXELCONV_AVX2
+
+#ifdef PIXELCONV_NEON
+    std::size_t ExpandNEON(const byte_t* src, byte_t* dst, std::size_t numPixels, const ConvParams& p)
+    {
+        int16x8_t srcShr[kNumChannels], mulShr[kNumChannels];
+        uint16x8_t mask[kNumChannels], mul[kNumChannels];
+        int32x4_t dstShl[kNumChannels];
+        for(std::size_t c = 0; c < p.numChannels; c++)
+        {
+            srcShr[c] = vdupq_n_s16(-int16_t(p.ch[c].srcShl)); // negative shift = shift right
+            mask[c]   = vdupq_n_u16(uint16_t(p.ch[c].srcMask));
+            mul[c]    = vdupq_n_u16(uint16_t(p.ch[c].mul));
+            mulShr[c] = vdupq_n_s16(-int16_t(p.ch[c].mulShr));
+            dstShl[c] = vdupq_n_s32(int32_t(p.ch[c].dstShl));
+        }
+
+        const uint32x4_t constant = vdupq_n_u32(p.constant);
+
+        std::size_t i = 0;
+        for(; i + 8 <= numPixels; i += 8)
+        {
+            const uint16x8_t v = vreinterpretq_u16_u8(vld1q_u8(src + i * 2));
+            uint32x4_t lo = constant;
+            uint32x4_t hi = constant;
+            for(std::size_t c = 0; c < p.numChannels; c++)
+            {
+                uint16x8_t x = vandq_u16(vshlq_u16(v, srcShr[c]), mask[c]);
+                x  = vshlq_u16(vmulq_u16(x, mul[c]), mulShr[c]);
+                lo = vorrq_u32(lo, vshlq_u32(vmovl_u16(vget_low_u16(x)),  dstShl[c]));
+                hi = vorrq_u32(hi, vshlq_u32(vmovl_u16(vget_high_u16(x)), dstShl[c]));
+            }
+
+            vst1q_u8(dst + i * 4,      vreinterpretq_u8_u32(lo));
+            vst1q_u8(dst + i * 4 + 16, vreinterpretq_u8_u32(hi));
+        }
+
+        return i;
+    }
+
+    std::size_t NarrowNEON(const byte_t* src, byte_t* dst, std::size_t numPixels, const ConvParams& p)
+    {
+        int32x4_t srcShr[kNumChannels], narShr[kNumChannels], dstShl[kNumChannels];
+        for(std::size_t c = 0; c < p.numChannels; c++)
+        {
+            srcShr[c] = vdupq_n_s32(-int32_t(p.ch[c].srcShl));
+            narShr[c] = vdupq_n_s32(-int32_t(p.ch[c].narShr));
+            dstShl[c] = vdupq_n_s32(int32_t(p.ch[c].dstShl));
+        }
+
+        const uint32x4_t mask     = vdupq_n_u32(0xFF);
+        const uint32x4_t constant = vdupq_n_u32(p.constant);
+
+        std::size_t i = 0;
+        for(; i + 8 <= numPixels; i += 8)
+        {
+            const uint32x4_t a = vreinterpretq_u32_u8(vld1q_u8(src + i * 4));
+            const uint32x4_t b = vreinterpretq_u32_u8(vld1q_u8(src + i * 4 + 16));
+            uint32x4_t ra = constant;
+            uint32x4_t rb = constant;
+            for(std::size_t c = 0; c < p.numChannels; c++)
+            {
+                const uint32x4_t xa = vshlq_u32(vandq_u32(vshlq_u32(a, srcShr[c]), mask), narShr[c]);
+                const uint32x4_t xb = vshlq_u32(vandq_u32(vshlq_u32(b, srcShr[c]), mask), narShr[c]);
+                ra = vorrq_u32(ra, vshlq_u32(xa, dstShl[c]));
+                rb = vorrq_u32(rb, vshlq_u32(xb, dstShl[c]));
+            }
+
+            vst1q_u8(dst + i * 2, vreinterpretq_u8_u16(vcombine_u16(vmovn_u32(ra), vmovn_u32(rb))));
+        }
+
+        return i;
+    }
+#endif // PIXELCONV_NEON
+
+    bool IsIsaAvailable(PixelConvIsa isa)
+    {
+        switch(isa)
+        {
+        case PixelConvIsa::Scalar:
+            return true;
+    #ifdef PIXELCONV_SSE2
+        case PixelConvIsa::SSE2:
+            return true;
+    #endif
+    #ifdef PIXELCONV_AVX2
+        case PixelConvIsa::AVX2:
+        {
+        #ifdef PIXELCONV_AVX2_RUNTIME_CHECK
+            static const bool bAvx2 = __builtin_cpu_supports("avx2");
+            return bAvx2;
+        #else
+            return true;
+        #endif
+        }
+    #endif
+    #ifdef PIXELCONV_NEON
+        case PixelConvIsa::NEON:
+            return true;
+    #endif
+        default:
+            return false;
+        }
+    }
+
+    bool IsValidFormat(const ColorFormat& cf)
+    {
+        if(cf.bpp != 16 && cf.bpp != 32) {
+            return false;
+        }
+
+        const auto c = GetChannels(cf);
+        for(const auto& ch : c.ch)
+        {
+            if(ch.bits > 8 || (ch.bits > 0 && ch.shl + ch.bits > c.bpp)) {
+                return false;
+            }
+        }
+
+        return c.ch[0].bits + c.ch[1].bits + c.ch[2].bits > 0;
+    }
+}
+
+PixelConvIsa GetPixelConvIsa()
+{
+    for(auto isa : { PixelConvIsa::AVX2, PixelConvIsa::NEON, PixelConvIsa::SSE2 })
+    {
+        if(IsIsaAvailable(isa)) {
+            return isa;
+        }
+    }
+
+    return PixelConvIsa::Scalar;
+}
+
+const char* GetPixelConvIsaName(PixelConvIsa isa)
+{
+    switch(isa)
+    {
+    case PixelConvIsa::SSE2: return "SSE2";
+    case PixelConvIsa::AVX2: return "AVX2";
+    case PixelConvIsa::NEON: return "NEON";
+    default:                 return "Scalar";
+    }
+}
+
+bool CanConvertPixels(const ColorFormat& srcFormat, const ColorFormat& dstFormat)
+{
+    return IsValidFormat(srcFormat) && IsValidFormat(dstFormat);
+}
+
+void ConvertPixels(const byte_t* src, const ColorFormat& srcFormat, byte_t* dst, const ColorFormat& dstFormat, std::size_t numPixels)
+{
+    static const PixelConvIsa isa = GetPixelConvIsa();
+    ConvertPixels(src, srcFormat, dst, dstFormat, numPixels, isa);
+}
+
+void ConvertPixels(const byte_t* src, const ColorFormat& srcFormat, byte_t* dst, const ColorFormat& dstFormat, std::size_t numPixels, PixelConvIsa isa)
+{
+    if(!CanConvertPixels(srcFormat, dstFormat)) {
+        throw std::invalid_argument("Unsupported pixel format conversion");
+    }
+
+    const auto p = MakeConvParams(srcFormat, dstFormat);
+    if(!IsIsaAvailable(isa)) {
+        isa = PixelConvIsa::Scalar;
+    }
+
+    /* SIMD kernels convert bulk of pixels and return the number of converted pixels */
+    std::size_t nDone = 0;
+    switch(isa)
+    {
+#ifdef PIXELCONV_SSE2
+    case PixelConvIsa::SSE2:
+        nDone = p.bExpand ? ExpandSSE2(src, dst, numPixels, p) :
+                p.bNarrow ? NarrowSSE2(src, dst, numPixels, p) : 0;
+        break;
+#endif
+#ifdef PIXELCONV_AVX2
+    case PixelConvIsa::AVX2:
+        nDone = p.bExpand ? ExpandAVX2(src, dst, numPixels, p) :
+                p.bNarrow ? NarrowAVX2(src, dst, numPixels, p) : 0;
+        break;
+#endif
+#ifdef PIXELCONV_NEON
+    case PixelConvIsa::NEON:
+        nDone = p.bExpand ? ExpandNEON(src, dst, numPixels, p) :
+                p.bNarrow ? NarrowNEON(src, dst, numPixels, p) : 0;
+        break;
+#endif
+    default:
+        break;
+    }
+
+    /* Convert the rest */
+    ConvertScalar(src + nDone * BBS(p.srcBpp), srcFormat, dst + nDone * BBS(p.dstBpp), dstFormat, numPixels - nDone, p);
+}
+
+BitmapPtr ConvertBitmap(const Bitmap& bitmap, uint32_t width, uint32_t height, const ColorFormat& srcFormat, const ColorFormat& dstFormat)
+{
+    const std::size_t numPixels = std::size_t(width) * height;
+    if(bitmap.size() < numPixels * BBS(srcFormat.bpp)) {
+        throw std::invalid_argument("Bitmap is too small for given dimensions");
+    }
+
+    auto result = MakeBitmapPtr(numPixels * BBS(dstFormat.bpp));
+    ConvertPixels(bitmap.data(), srcFormat, result->data(), dstFormat, numPixels);
+    return result;
+}
@@ -0,0 +1,44 @@
+#ifndef LIBIM_PIXELCONV_H
+#define LIBIM_PIXELCONV_H
+#include <cstddef>
+#include <cstdint>
+
+#include "colorformat.h"
+#include "common.h"
+
+/* Pixel format conversion between 16 bit formats (RGB_565, RGBA_4444, ARGB_4444, ARGB_5551 ...)
+   and 32 bit formats with 8 bit channels (RGBA_8888, BGRA_8888), driven by the ColorFormat
+   bpp and shift fields. Channels are expanded to 8 bits by bit replication and narrowed by
+   truncation so 16 -> 32 -> 16 bit conversion is lossless. If source format has no alpha
+   channel the converted alpha is opaque.
+
+   Conversions between these formats are done by SIMD kernels (SSE2, AVX2 or NEON) when
+   available, any other pair of formats is converted by the generic scalar path. */
+
+enum class PixelConvIsa
+{
+    Scalar,
+    SSE2,
+    AVX2,
+    NEON
+};
+
+/* Returns the best instruction set available on the running CPU */
+PixelConvIsa GetPixelConvIsa();
+const char* GetPixelConvIsaName(PixelConvIsa isa);
+
+/* Returns true if pixels can be converted from srcFormat to dstFormat. Both formats have to be
+   16 or 32 bits per pixel and each channel can be 8 bits at most */
+bool CanConvertPixels(const ColorFormat& srcFormat, const ColorFormat& dstFormat);
+
+/* Converts numPixels pixels from src in srcFormat to dst in dstFormat.
+   src and dst must not overlap. Throws std::invalid_argument if formats can't be converted. */
+void ConvertPixels(const byte_t* src, const ColorFormat& srcFormat, byte_t* dst, const ColorFormat& dstFormat, std::size_t numPixels);
+
+/* Same as above but uses isa kernels. If isa is not available on the running CPU the scalar path is used. */
+void ConvertPixels(const byte_t* src, const ColorFormat& srcFormat, byte_t* dst, const ColorFormat& dstFormat, std::size_t numPixels, PixelConvIsa isa);
+
+/* Returns new bitmap of width * height pixels converted from srcFormat to dstFormat */
+BitmapPtr ConvertBitmap(const Bitmap& bitmap, uint32_t width, uint32_t height, const ColorFormat& srcFormat, const ColorFormat& dstFormat);
+
+#endif // LIBIM_PIXELCONV_H
@@ -7,6 +7,7 @@
 
 #include "bmp.h"
 #include "colorformat.h"
+#include "pixelconv.h"
 #include "common.h"
 #include "io/stream.h"
 
@@ -137,7 +138,13 @@ public:
 
     Bmp toBmp() const
     {
-        uint32_t matBitdataSize = GetBitmapSize(width(), height(), m_colorInfo.bpp);
+        return toBmp(m_colorInfo);
+    }
+
+    /* Returns bmp with pixel data converted to format, e.g. BGRA_8888 for 32 bit bmp */
+    Bmp toBmp(const ColorFormat& format) const
+    {
+        uint32_t matBitdataSize = GetBitmapSize(width(), height(), format.bpp);
 
         Bmp bmp;
         bmp.header.type    = BMP_TYPE;
@@ -148,15 +155,15 @@ public:
         bmp.info.width       = width();
         bmp.info.height      = - (height()); // flip image
         bmp.info.planes      = 1;
-        bmp.info.bitCount    = m_colorInfo.bpp;
-        bmp.info.compression = BI_BITFIELDS; //m_colorInfo.colorMode ? BI_BITFIELDS : BI_ALPHABITFIELDS;
+        bmp.info.bitCount    = format.bpp;
+        bmp.info.compression = BI_BITFIELDS; //format.colorMode ? BI_BITFIELDS : BI_ALPHABITFIELDS;
         bmp.info.sizeImage   = matBitdataSize;
-        bmp.info.redMask     = RGBMask(m_colorInfo.redBPP  , m_colorInfo.RedShl);
-        bmp.info.greenMask   = RGBMask(m_colorInfo.greenBPP, m_colorInfo.GreenShl);
-        bmp.info.blueMask    = RGBMask(m_colorInfo.blueBPP , m_colorInfo.BlueShl);
-        bmp.info.alphaMask   = RGBMask(m_colorInfo.alphaBPP, m_colorInfo.AlphaShl);
+        bmp.info.redMask     = RGBMask(format.redBPP  , format.RedShl);
+        bmp.info.greenMask   = RGBMask(format.greenBPP, format.GreenShl);
+        bmp.info.blueMask    = RGBMask(format.blueBPP , format.BlueShl);
+        bmp.info.alphaMask   = RGBMask(format.alphaBPP, format.AlphaShl);
 
-        bmp.pixelData = m_bitmap;
+        bmp.pixelData = format == m_colorInfo ? m_bitmap : ConvertBitmap(*m_bitmap, width(), height(), m_colorInfo, format);
         return bmp;
     }
 
@@ -0,0 +1,152 @@
+#include "probe.h"
+#include "io/compressedstream.h"
+#include "io/filestream.h"
+#include "io/mappedfilestream.h"
+#include "utils/stats.h"
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstring>
+#include <exception>
+
+using namespace libim;
+
+namespace {
+    /* Signature of CompressedStream container */
+    constexpr std::array<char, 4> kCompressedSignature = {{'L', 'I', 'M', 'Z'}};
+
+    bool HasSignature(const byte_t* data, std::size_t size, const std::array<char, 4>& signature)
+    {
+        return size >= signature.size() && memcmp(data, signature.data(), signature.size()) == 0;
+    }
+
+    template<typename T>
+    T ReadHeader(const byte_t* data)
+    {
+        T header;
+        memcpy(&header, data, sizeof(T));
+        return header;
+    }
+}
+
+const char* libim::GetFileTypeName(FileType type)
+{
+    switch(type)
+    {
+    case FileType::Unknown: return "unknown";
+    case FileType::Gob:     return "GOB";
+    case FileType::Cnd:     return "CND";
+    case FileType::Mat:     return "MAT";
+    }
+    return "";
+}
+
+FileProbe libim::ProbeBuffer(const byte_t* data, std::size_t size, std::size_t fileSize)
+{
+    FileProbe probe;
+    probe.size = fileSize;
+
+    if(HasSignature(data, size, GOB_FILE_SIGNATURE))
+    {
+        probe.type = FileType::Gob;
+        if(size < sizeof(GobFileHeader)) {
+            probe.error = "GOB file header is truncated";
+            return probe;
+        }
+
+        probe.gob = ReadHeader<GobFileHeader>(data);
+        if(probe.gob.version != GOB_FILE_VERSION) {
+            probe.error = "wrong GOB file version: " + std::to_string(probe.gob.version);
+        }
+        else if(std::size_t(probe.gob.directoryOffset) + sizeof(uint32_t) > fileSize) {
+            probe.error = "GOB directory is out of file bounds";
+        }
+    }
+    else if(HasSignature(data, size, MAT_FILE_SIG))
+    {
+        probe.type = FileType::Mat;
+        if(size < sizeof(MatHeader)) {
+            probe.error = "MAT file header is truncated";
+            return probe;
+        }
+
+        probe.mat = ReadHeader<MatHeader>(data);
+        if(probe.mat.version != int(MAT_VERSION)) {
+            probe.error = "wrong MAT file version: " + std::to_string(probe.mat.version);
+        }
+    }
+    else if(size >= sizeof(CND::CndHeader) &&
+            CND::HasCopyrightNotice(reinterpret_cast<const char*>(data) + offsetof(CND::CndHeader, copyright)))
+    {
+        /* CND file has no signature, copyright notice follows the file size field */
+        probe.type = FileType::Cnd;
+        probe.cnd  = ReadHeader<CND::CndHeader>(data);
+        try
+        {
+            CND::VerifyHeader(probe.cnd);
+            if(CND::GetMatSectionOffset(probe.cnd) > fileSize) {
+                probe.error = "CND material section is out of file bounds";
+            }
+        }
+        catch(const std::exception& e) {
+            probe.error = e.what();
+        }
+    }
+
+    return probe;
+}
+
+FileProbe libim::ProbeStream(const StreamPtr<InputStream>& istream)
+{
+    LIBIM_STATS_SCOPED_TIMER("ProbeStream");
+    std::array<byte_t, PROBE_PREFIX_SIZE> prefix;
+    const std::size_t size  = istream->size();
+    const std::size_t nRead = size > 0 ? istream->readAt(0, prefix.data(), std::min(prefix.size(), size)) : 0;
+
+    if(!HasSignature(prefix.data(), nRead, kCompressedSignature)) {
+        return ProbeBuffer(prefix.data(), nRead, size);
+    }
+
+    FileProbe probe;
+    try
+    {
+        probe = ProbeStream(MakeStreamPtr<CompressedStream>(istream));
+    }
+    catch(const std::exception& e)
+    {
+        probe = FileProbe();
+        probe.size  = size;
+        probe.error = std::string("invalid compressed container: ") + e.what();
+    }
+
+    probe.compressed = true;
+    return probe;
+}
+
+FileProbe libim::ProbeFile(const std::string& path)
+{
+    try
+    {
+        std::array<byte_t, PROBE_PREFIX_SIZE> prefix;
+        std::size_t size  = 0;
+        std::size_t nRead = 0;
+        {
+            InputFileStream ifs(path);
+            size  = ifs.size();
+            nRead = size > 0 ? ifs.readAt(0, prefix.data(), std::min(prefix.size(), size)) : 0;
+        }
+
+        if(!HasSignature(prefix.data(), nRead, kCompressedSignature)) {
+            return ProbeBuffer(prefix.data(), nRead, size);
+        }
+
+        return ProbeStream(MakeStreamPtr<MappedFileStream>(path));
+    }
+    catch(const std::exception& e)
+    {
+        FileProbe probe;
+        probe.error = e.what();
+        return probe;
+    }
+}
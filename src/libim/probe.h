@@ -0,0 +1,60 @@
+#ifndef LIBIM_PROBE_H
+#define LIBIM_PROBE_H
+#include <cstddef>
+#include <string>
+
+#include "cnd.h"
+#include "gob.h"
+#include "material/mat.h"
+#include "io/stream.h"
+
+namespace libim {
+
+enum class FileType
+{
+    Unknown,
+    Gob,
+    Cnd,
+    Mat
+};
+
+const char* GetFileTypeName(FileType type);
+
+/* Result of file probe. Header of detected file type is parsed and validated once,
+   so it can be passed on instead of being read again, e.g. to CND::LoadMaterials. */
+struct FileProbe
+{
+    FileType type = FileType::Unknown;
+    bool compressed  = false; // file is compressed container (see CompressedStream), type and header are of its content
+    std::size_t size = 0;     // size of file, uncompressed size if compressed
+    std::string error;        // reason why file of detected type is not valid, empty if valid
+
+    GobFileHeader  gob {};    // set if type is Gob
+    CND::CndHeader cnd {};    // set if type is Cnd
+    MatHeader      mat {};    // set if type is Mat
+
+    bool valid() const
+    {
+        return type != FileType::Unknown && error.empty();
+    }
+};
+
+/* Size of file prefix needed to probe any file type, i.e. size of the biggest probed header */
+static constexpr std::size_t PROBE_PREFIX_SIZE = sizeof(CND::CndHeader);
+
+/* Identifies file type from prefix data of size bytes of file with fileSize bytes.
+   GOB and MAT files are detected by signature, CND file by copyright notice compared with SIMD instructions.
+   Compressed container is not detected, see ProbeStream. */
+FileProbe ProbeBuffer(const byte_t* data, std::size_t size, std::size_t fileSize);
+
+/* Identifies type of file stored in istream. Prefix is read with one readAt, stream position is not changed.
+   Content of compressed container is identified by decompressing its first chunk. */
+FileProbe ProbeStream(const StreamPtr<InputStream>& istream);
+
+/* Identifies type of file. Only prefix is read from the file with one positional read,
+   compressed container is mapped to identify its content. A file that can't be opened is reported as
+   Unknown type with error set. */
+FileProbe ProbeFile(const std::string& path);
+
+}
+#endif // LIBIM_PROBE_H
@@ -0,0 +1,62 @@
+#include "arena.h"
+
+#include <algorithm>
+
+using namespace libim;
+
+Arena::Arena(std::size_t initialCapacity, std::size_t blockSize) :
+    m_blockSize(std::max<std::size_t>(blockSize, 1))
+{
+    if(initialCapacity > 0) {
+        addBlock(initialCapacity);
+    }
+}
+
+Arena::~Arena()
+{
+    for(auto& block : m_blocks) {
+        ::operator delete(block.data);
+    }
+}
+
+void Arena::addBlock(std::size_t size)
+{
+    m_blocks.push_back({ ::operator new(size), size });
+    m_capacity += size;
+    m_offset    = 0;
+}
+
+void* Arena::allocate(std::size_t size, std::size_t alignment)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    auto alignedOffset = [&]() {
+        return (m_offset + alignment - 1) & ~(alignment - 1);
+    };
+
+    if(m_blocks.empty() || alignedOffset() + size > m_blocks.back().size) {
+        addBlock(std::max(size + alignment, m_blockSize));
+    }
+
+    const std::size_t offset = alignedOffset();
+    m_offset = offset + size;
+    m_size  += size;
+    return static_cast<char*>(m_blocks.back().data) + offset;
+}
+
+void Arena::deallocate(void* /*ptr*/, std::size_t /*size*/) noexcept
+{
+    // Memory is released when arena is destroyed
+}
+
+std::size_t Arena::size() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_size;
+}
+
+std::size_t Arena::capacity() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_capacity;
+}
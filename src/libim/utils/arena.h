@@ -0,0 +1,121 @@
+#ifndef LIBIM_ARENA_H
+#define LIBIM_ARENA_H
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <type_traits>
+#include <vector>
+
+namespace libim {
+
+/* Monotonic memory arena. Memory is carved from large blocks and released all at once
+   when the arena is destroyed, deallocate() doesn't free anything.
+   Allocation from multiple threads is safe. */
+class Arena
+{
+public:
+    static constexpr std::size_t DEFAULT_BLOCK_SIZE = 1024 * 1024;
+
+    /* Creates arena with the first block of initialCapacity bytes (0 = no block until first allocation).
+       Following blocks are at least blockSize bytes. */
+    explicit Arena(std::size_t initialCapacity = 0, std::size_t blockSize = DEFAULT_BLOCK_SIZE);
+    ~Arena();
+
+    Arena(const Arena&) = delete;
+    Arena& operator = (const Arena&) = delete;
+
+    void* allocate(std::size_t size, std::size_t alignment = alignof(std::max_align_t));
+    void deallocate(void* ptr, std::size_t size) noexcept;
+
+    /* Returns number of bytes handed out by allocate */
+    std::size_t size() const;
+
+    /* Returns total size of all blocks */
+    std::size_t capacity() const;
+
+private:
+    void addBlock(std::size_t size);
+
+private:
+    struct Block
+    {
+        void* data;
+        std::size_t size;
+    };
+
+    std::vector<Block> m_blocks;
+    std::size_t m_blockSize;
+    std::size_t m_offset   = 0; // offset in the last block
+    std::size_t m_size     = 0;
+    std::size_t m_capacity = 0;
+    mutable std::mutex m_mutex;
+};
+
+/* Stateful allocator which allocates from shared Arena. Allocator without arena allocates from heap.
+   Containers copied from arena allocated containers allocate from heap so copies don't extend arena's lifetime. */
+template<typename T>
+class ArenaAllocator
+{
+public:
+    using value_type = T;
+    using propagate_on_container_copy_assignment = std::false_type;
+    using propagate_on_container_move_assignment = std::true_type;
+    using propagate_on_container_swap            = std::true_type;
+
+    ArenaAllocator() noexcept = default;
+    ArenaAllocator(std::shared_ptr<Arena> arena) noexcept :
+        m_arena(std::move(arena))
+    {}
+
+    template<typename U>
+    ArenaAllocator(const ArenaAllocator<U>& other) noexcept :
+        m_arena(other.arena())
+    {}
+
+    T* allocate(std::size_t n)
+    {
+        if(!m_arena) {
+            return static_cast<T*>(::operator new(n * sizeof(T)));
+        }
+        return static_cast<T*>(m_arena->allocate(n * sizeof(T), alignof(T)));
+    }
+
+    void deallocate(T* ptr, std::size_t n) noexcept
+    {
+        if(!m_arena) {
+            ::operator delete(ptr);
+        }
+        else {
+            m_arena->deallocate(ptr, n * sizeof(T));
+        }
+    }
+
+    ArenaAllocator select_on_container_copy_construction() const
+    {
+        return ArenaAllocator();
+    }
+
+    const std::shared_ptr<Arena>& arena() const
+    {
+        return m_arena;
+    }
+
+private:
+    std::shared_ptr<Arena> m_arena;
+};
+
+template<typename T, typename U>
+inline bool operator == (const ArenaAllocator<T>& lhs, const ArenaAllocator<U>& rhs) noexcept
+{
+    return lhs.arena() == rhs.arena();
+}
+
+template<typename T, typename U>
+inline bool operator != (const ArenaAllocator<T>& lhs, const ArenaAllocator<U>& rhs) noexcept
+{
+    return !(lhs == rhs);
+}
+
+}
+#endif // LIBIM_ARENA_H
@@ -0,0 +1,194 @@
+#include "hash.h"
+
+#include <algorithm>
+#include <cstring>
+
+using namespace libim;
+
+namespace {
+    constexpr uint64_t PRIME64_1 = 0x9E3779B185EBCA87ULL;
+    constexpr uint64_t PRIME64_2 = 0xC2B2AE3D27D4EB4FULL;
+    constexpr uint64_t PRIME64_3 = 0x165667B19E3779F9ULL;
+    constexpr uint64_t PRIME64_4 = 0x85EBCA77C2B2AE63ULL;
+    constexpr uint64_t PRIME64_5 = 0x27D4EB2F165667C5ULL;
+
+    inline uint64_t Rotl(uint64_t x, int r)
+    {
+        return (x << r) | (x >> (64 - r));
+    }
+
+    /* Reads little endian value */
+    inline uint64_t Read64(const unsigned char* p)
+    {
+        uint64_t v = 0;
+        for(int i = 7; i >= 0; i--) {
+            v = (v << 8) | p[i];
+        }
+        return v;
+    }
+
+    inline uint32_t Read32(const unsigned char* p)
+    {
+        return uint32_t(p[0]) | uint32_t(p[1]) << 8 | uint32_t(p[2]) << 16 | uint32_t(p[3]) << 24;
+    }
+
+    inline uint64_t Round(uint64_t acc, uint64_t input)
+    {
+        acc += input * PRIME64_2;
+        acc  = Rotl(acc, 31);
+        return acc * PRIME64_1;
+    }
+
+    inline uint64_t MergeRound(uint64_t acc, uint64_t val)
+    {
+        acc ^= Round(0, val);
+        return acc * PRIME64_1 + PRIME64_4;
+    }
+
+    /* Processes 32 byte stripes, returns pointer past the last processed stripe */
+    inline const unsigned char* Consume(uint64_t acc[4], const unsigned char* p, const unsigned char* end)
+    {
+        while(end - p >= 32)
+        {
+            acc[0] = Round(acc[0], Read64(p));
+            acc[1] = Round(acc[1], Read64(p + 8));
+            acc[2] = Round(acc[2], Read64(p + 16));
+            acc[3] = Round(acc[3], Read64(p + 24));
+            p += 32;
+        }
+        return p;
+    }
+
+    /* Mixes in remaining tail bytes (< 32) and avalanches the hash */
+    uint64_t Finalize(uint64_t h, const unsigned char* p, std::size_t length)
+    {
+        while(length >= 8)
+        {
+            h ^= Round(0, Read64(p));
+            h  = Rotl(h, 27) * PRIME64_1 + PRIME64_4;
+            p += 8;
+            length -= 8;
+        }
+
+        if(length >= 4)
+        {
+            h ^= uint64_t(Read32(p)) * PRIME64_1;
+            h  = Rotl(h, 23) * PRIME64_2 + PRIME64_3;
+            p += 4;
+            length -= 4;
+        }
+
+        while(length > 0)
+        {
+            h ^= (*p++) * PRIME64_5;
+            h  = Rotl(h, 11) * PRIME64_1;
+            length--;
+        }
+
+        h ^= h >> 33;
+        h *= PRIME64_2;
+        h ^= h >> 29;
+        h *= PRIME64_3;
+        h ^= h >> 32;
+        return h;
+    }
+
+    inline uint64_t MergeAccumulators(const uint64_t acc[4])
+    {
+        uint64_t h = Rotl(acc[0], 1) + Rotl(acc[1], 7) + Rotl(acc[2], 12) + Rotl(acc[3], 18);
+        h = MergeRound(h, acc[0]);
+        h = MergeRound(h, acc[1]);
+        h = MergeRound(h, acc[2]);
+        h = MergeRound(h, acc[3]);
+        return h;
+    }
+
+    inline void InitAccumulators(uint64_t acc[4], uint64_t seed)
+    {
+        acc[0] = seed + PRIME64_1 + PRIME64_2;
+        acc[1] = seed + PRIME64_2;
+        acc[2] = seed;
+        acc[3] = seed - PRIME64_1;
+    }
+}
+
+uint64_t libim::XXH64(const void* data, std::size_t length, uint64_t seed)
+{
+    auto p = static_cast<const unsigned char*>(data);
+    const auto end = p + length;
+
+    uint64_t h;
+    if(length >= 32)
+    {
+        uint64_t acc[4];
+        InitAccumulators(acc, seed);
+        p = Consume(acc, p, end);
+        h = MergeAccumulators(acc);
+    }
+    else {
+        h = seed + PRIME64_5;
+    }
+
+    h += uint64_t(length);
+    return Finalize(h, p, std::size_t(end - p));
+}
+
+XXH64Hasher::XXH64Hasher(uint64_t seed)
+{
+    reset(seed);
+}
+
+void XXH64Hasher::reset(uint64_t seed)
+{
+    InitAccumulators(m_acc, seed);
+    m_seed        = seed;
+    m_totalLength = 0;
+    m_bufferSize  = 0;
+}
+
+void XXH64Hasher::update(const void* data, std::size_t length)
+{
+    auto p = static_cast<const unsigned char*>(data);
+    const auto end = p + length;
+    m_totalLength += length;
+
+    /* Fill buffered stripe first */
+    if(m_bufferSize > 0)
+    {
+        const std::size_t n = std::min(sizeof(m_buffer) - m_bufferSize, length);
+        memcpy(m_buffer + m_bufferSize, p, n);
+        m_bufferSize += n;
+        p += n;
+
+        if(m_bufferSize < sizeof(m_buffer)) {
+            return;
+        }
+
+        Consume(m_acc, m_buffer, m_buffer + sizeof(m_buffer));
+        m_bufferSize = 0;
+    }
+
+    p = Consume(m_acc, p, end);
+    if(p < end)
+    {
+        m_bufferSize = std::size_t(end - p);
+        memcpy(m_buffer, p, m_bufferSize);
+    }
+}
+
+uint64_t XXH64Hasher::digest() const
+{
+    uint64_t h = m_totalLength >= 32 ? MergeAccumulators(m_acc) : m_seed + PRIME64_5;
+    h += m_totalLength;
+    return Finalize(h, m_buffer, m_bufferSize);
+}
+
+std::string libim::HashToHex(uint64_t hash)
+{
+    static constexpr char digits[] = "0123456789abcdef";
+    std::string hex(16, '0');
+    for(int i = 15; i >= 0; i--, hash >>= 4) {
+        hex[std::size_t(i)] = digits[hash & 0xF];
+    }
+    return hex;
+}
@@ -0,0 +1,36 @@
+#ifndef LIBIM_HASH_H
+#define LIBIM_HASH_H
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace libim {
+
+/* XXH64 non-cryptographic hash, https://github.com/Cyan4973/xxHash.
+   Output is identical to the reference implementation on all platforms. */
+uint64_t XXH64(const void* data, std::size_t length, uint64_t seed = 0);
+
+/* Incremental XXH64. Hash of data fed in any number of update calls
+   equals XXH64 of the concatenated data. */
+class XXH64Hasher
+{
+public:
+    explicit XXH64Hasher(uint64_t seed = 0);
+
+    void reset(uint64_t seed = 0);
+    void update(const void* data, std::size_t length);
+    uint64_t digest() const;
+
+private:
+    uint64_t m_acc[4];
+    uint64_t m_seed;
+    uint64_t m_totalLength;
+    unsigned char m_buffer[32];
+    std::size_t m_bufferSize;
+};
+
+/* Returns hash as 16 lower case hex digits */
+std::string HashToHex(uint64_t hash);
+
+}
+#endif // LIBIM_HASH_H
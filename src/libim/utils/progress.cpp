@@ -0,0 +1,81 @@
+#include "progress.h"
+
+#include <algorithm>
+
+using namespace libim;
+
+ProgressMeter::ProgressMeter()
+{
+    reset();
+}
+
+void ProgressMeter::onBegin(std::size_t numItems, std::size_t numBytes)
+{
+    m_totalItems.fetch_add(numItems, std::memory_order_relaxed);
+    m_totalBytes.fetch_add(numBytes, std::memory_order_relaxed);
+}
+
+void ProgressMeter::onItem(const std::string& /*name*/, std::size_t size)
+{
+    m_doneBytes.fetch_add(size, std::memory_order_relaxed);
+    m_doneItems.fetch_add(1, std::memory_order_relaxed);
+}
+
+void ProgressMeter::reset()
+{
+    m_totalItems = 0;
+    m_totalBytes = 0;
+    m_doneItems  = 0;
+    m_doneBytes  = 0;
+    m_start      = Clock::now().time_since_epoch().count();
+}
+
+std::size_t ProgressMeter::totalItems() const
+{
+    return m_totalItems.load(std::memory_order_relaxed);
+}
+
+std::size_t ProgressMeter::totalBytes() const
+{
+    return m_totalBytes.load(std::memory_order_relaxed);
+}
+
+std::size_t ProgressMeter::doneItems() const
+{
+    return m_doneItems.load(std::memory_order_relaxed);
+}
+
+std::size_t ProgressMeter::doneBytes() const
+{
+    return m_doneBytes.load(std::memory_order_relaxed);
+}
+
+double ProgressMeter::elapsed() const
+{
+    const Clock::duration d(Clock::now().time_since_epoch().count() - m_start.load());
+    return std::chrono::duration<double>(d).count();
+}
+
+double ProgressMeter::itemsPerSecond() const
+{
+    const double t = elapsed();
+    return t > 0.0 ? double(doneItems()) / t : 0.0;
+}
+
+double ProgressMeter::bytesPerSecond() const
+{
+    const double t = elapsed();
+    return t > 0.0 ? double(doneBytes()) / t : 0.0;
+}
+
+double ProgressMeter::eta() const
+{
+    if(totalBytes() > 0)
+    {
+        const double rate = bytesPerSecond();
+        return rate > 0.0 ? double(totalBytes() - std::min(doneBytes(), totalBytes())) / rate : -1.0;
+    }
+
+    const double rate = itemsPerSecond();
+    return rate > 0.0 ? double(totalItems() - std::min(doneItems(), totalItems())) / rate : -1.0;
+}
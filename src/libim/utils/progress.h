@@ -0,0 +1,66 @@
+#ifndef LIBIM_PROGRESS_H
+#define LIBIM_PROGRESS_H
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <string>
+
+namespace libim {
+
+/* Receiver of progress events of long running operations, e.g. extraction of many files.
+   Operation announces the work it is going to do with onBegin and reports every finished item with onItem.
+   Events can be sent from several threads at the same time, so listener has to be thread-safe.
+   Handlers are called on the working thread and should return quickly. */
+class ProgressListener
+{
+public:
+    virtual ~ProgressListener() = default;
+
+    /* Announces numItems items of numBytes bytes in total which are going to be processed.
+       Called once per operation, several operations can report to the same listener. */
+    virtual void onBegin(std::size_t numItems, std::size_t numBytes) { (void)numItems; (void)numBytes; }
+
+    /* Item name of size bytes has been processed */
+    virtual void onItem(const std::string& name, std::size_t size) { (void)name; (void)size; }
+};
+
+/* Progress listener which counts announced and processed items and bytes with atomic counters,
+   and computes throughput and estimated time left from time elapsed since meter was made or reset. */
+class ProgressMeter : public ProgressListener
+{
+public:
+    using Clock = std::chrono::steady_clock;
+
+    ProgressMeter();
+
+    virtual void onBegin(std::size_t numItems, std::size_t numBytes) override;
+    virtual void onItem(const std::string& name, std::size_t size) override;
+
+    /* Clears counters and restarts timer */
+    void reset();
+
+    std::size_t totalItems() const;
+    std::size_t totalBytes() const;
+    std::size_t doneItems() const;
+    std::size_t doneBytes() const;
+
+    /* Seconds since meter was made or reset */
+    double elapsed() const;
+
+    double itemsPerSecond() const;
+    double bytesPerSecond() const;
+
+    /* Estimated seconds left, from byte throughput or item throughput if no bytes were announced.
+       Returns negative value if nothing has been processed yet. */
+    double eta() const;
+
+private:
+    std::atomic<std::size_t> m_totalItems { 0 };
+    std::atomic<std::size_t> m_totalBytes { 0 };
+    std::atomic<std::size_t> m_doneItems  { 0 };
+    std::atomic<std::size_t> m_doneBytes  { 0 };
+    std::atomic<Clock::rep>  m_start      { 0 };
+};
+
+}
+#endif // LIBIM_PROGRESS_H
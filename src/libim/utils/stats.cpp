@@ -0,0 +1,158 @@
+#include "stats.h"
+
+#ifdef LIBIM_ENABLE_STATS
+#include <array>
+#include <sstream>
+
+namespace libim { namespace stats {
+
+    namespace {
+        constexpr std::size_t kNumCounters   = static_cast<std::size_t>(Counter::NumCounters);
+        constexpr std::size_t kNumHistograms = static_cast<std::size_t>(Histogram::NumHistograms);
+
+        const char* const kCounterNames[kNumCounters] = {
+            "stream_bytes_read",
+            "stream_bytes_written",
+            "stream_reads",
+            "stream_writes",
+            "file_bytes_read",
+            "file_bytes_written",
+            "file_bytes_copied",
+            "file_read_syscalls",
+            "file_write_syscalls",
+            "file_seek_syscalls",
+            "file_copy_syscalls",
+            "mapped_bytes_read",
+            "async_bytes_read",
+            "async_bytes_written",
+            "async_requests",
+            "async_submit_syscalls"
+        };
+
+        const char* const kHistogramNames[kNumHistograms] = {
+            "stream_read_size",
+            "stream_write_size"
+        };
+
+        std::array<std::atomic<uint64_t>, kNumCounters> g_counters {};
+        std::array<std::array<std::atomic<uint64_t>, HISTOGRAM_BUCKETS>, kNumHistograms> g_histograms {};
+        std::atomic<Timer*> g_timers { nullptr };
+
+        std::size_t BucketIndex(uint64_t value)
+        {
+            std::size_t idx = 0;
+            while(value != 0 && idx < HISTOGRAM_BUCKETS - 1)
+            {
+                value >>= 1;
+                idx++;
+            }
+            return idx;
+        }
+
+        /* Returns lower bound of values counted in bucket */
+        uint64_t BucketLowerBound(std::size_t idx)
+        {
+            return idx == 0 ? 0 : uint64_t(1) << (idx - 1);
+        }
+    }
+
+    Timer::Timer(const char* n) : name(n)
+    {
+        /* Push timer to the front of global list */
+        next = g_timers.load(std::memory_order_relaxed);
+        while(!g_timers.compare_exchange_weak(next, this, std::memory_order_release, std::memory_order_relaxed))
+        {}
+    }
+
+    void Timer::record(uint64_t ns)
+    {
+        calls.fetch_add(1, std::memory_order_relaxed);
+        totalNs.fetch_add(ns, std::memory_order_relaxed);
+
+        uint64_t curMax = maxNs.load(std::memory_order_relaxed);
+        while(ns > curMax && !maxNs.compare_exchange_weak(curMax, ns, std::memory_order_relaxed))
+        {}
+    }
+
+    void Add(Counter counter, uint64_t value)
+    {
+        g_counters[static_cast<std::size_t>(counter)].fetch_add(value, std::memory_order_relaxed);
+    }
+
+    void Record(Histogram hist, uint64_t value)
+    {
+        g_histograms[static_cast<std::size_t>(hist)][BucketIndex(value)].fetch_add(1, std::memory_order_relaxed);
+    }
+
+    uint64_t Get(Counter counter)
+    {
+        return g_counters[static_cast<std::size_t>(counter)].load(std::memory_order_relaxed);
+    }
+
+    void Reset()
+    {
+        for(auto& c : g_counters) {
+            c.store(0, std::memory_order_relaxed);
+        }
+
+        for(auto& h : g_histograms)
+        {
+            for(auto& b : h) {
+                b.store(0, std::memory_order_relaxed);
+            }
+        }
+
+        for(Timer* t = g_timers.load(std::memory_order_acquire); t != nullptr; t = t->next)
+        {
+            t->calls.store(0, std::memory_order_relaxed);
+            t->totalNs.store(0, std::memory_order_relaxed);
+            t->maxNs.store(0, std::memory_order_relaxed);
+        }
+    }
+
+    std::string ToJson()
+    {
+        std::ostringstream ss;
+        ss << "{\n  \"counters\": {";
+        for(std::size_t i = 0; i < kNumCounters; i++)
+        {
+            ss << (i ? "," : "") << "\n    \"" << kCounterNames[i] << "\": "
+               << g_counters[i].load(std::memory_order_relaxed);
+        }
+
+        ss << "\n  },\n  \"histograms\": {";
+        for(std::size_t i = 0; i < kNumHistograms; i++)
+        {
+            ss << (i ? "," : "") << "\n    \"" << kHistogramNames[i] << "\": {";
+            bool bFirst = true;
+            for(std::size_t b = 0; b < HISTOGRAM_BUCKETS; b++)
+            {
+                const auto count = g_histograms[i][b].load(std::memory_order_relaxed);
+                if(count == 0) {
+                    continue;
+                }
+
+                ss << (bFirst ? "" : ",") << "\n      \"" << BucketLowerBound(b) << "\": " << count;
+                bFirst = false;
+            }
+            ss << (bFirst ? "}" : "\n    }");
+        }
+
+        ss << "\n  },\n  \"timers\": {";
+        bool bFirst = true;
+        for(Timer* t = g_timers.load(std::memory_order_acquire); t != nullptr; t = t->next)
+        {
+            ss << (bFirst ? "" : ",") << "\n    \"" << t->name << "\": { "
+               << "\"calls\": "     << t->calls.load(std::memory_order_relaxed)   << ", "
+               << "\"total_ns\": "  << t->totalNs.load(std::memory_order_relaxed) << ", "
+               << "\"max_ns\": "    << t->maxNs.load(std::memory_order_relaxed)   << " }";
+            bFirst = false;
+        }
+
+        ss << (bFirst ? "}" : "\n  }") << "\n}\n";
+        return ss.str();
+    }
+
+}} // namespace libim::stats
+
+#endif // LIBIM_ENABLE_STATS
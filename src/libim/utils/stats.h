@@ -0,0 +1,121 @@
+#ifndef LIBIM_STATS_H
+#define LIBIM_STATS_H
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+/* Optional instrumentation of libim hot paths.
+   When libim is built without LIBIM_ENABLE_STATS all LIBIM_STATS_* macros expand to nothing
+   and no counter is touched. With stats enabled counters are process wide, lock free and
+   can be dumped as JSON with libim::stats::ToJson().
+   Stream counters are incremented by every stream in a decorator chain (e.g. BufferedOutputStream
+   and the FileStream underneath), while File counters count only the actual system calls. */
+
+#ifdef LIBIM_ENABLE_STATS
+
+namespace libim { namespace stats {
+
+    enum class Counter : std::size_t
+    {
+        StreamBytesRead,    // bytes read through Stream::read
+        StreamBytesWritten, // bytes written through Stream::write
+        StreamReads,        // Stream::read calls
+        StreamWrites,       // Stream::write calls
+        FileBytesRead,      // bytes read from files by read syscall
+        FileBytesWritten,   // bytes written to files by write syscall
+        FileBytesCopied,    // bytes copied between files in kernel
+        FileReadSyscalls,
+        FileWriteSyscalls,
+        FileSeekSyscalls,
+        FileCopySyscalls,
+        MappedBytesRead,    // bytes read from memory mapped files
+        AsyncBytesRead,     // bytes read by AsyncIO requests
+        AsyncBytesWritten,  // bytes written by AsyncIO requests
+        AsyncRequests,      // AsyncIO read and write requests
+        AsyncSubmitSyscalls, // io_uring_enter calls
+        NumCounters
+    };
+
+    enum class Histogram : std::size_t
+    {
+        StreamReadSize,
+        StreamWriteSize,
+        NumHistograms
+    };
+
+    /* Number of log2 buckets in histogram. Bucket i counts sizes in range [2^(i-1), 2^i), bucket 0 counts size 0. */
+    static constexpr std::size_t HISTOGRAM_BUCKETS = 64;
+
+    /* Named timing site, registered on first use */
+    struct Timer
+    {
+        explicit Timer(const char* name);
+
+        const char* const name;
+        std::atomic<uint64_t> calls { 0 };
+        std::atomic<uint64_t> totalNs { 0 };
+        std::atomic<uint64_t> maxNs { 0 };
+        Timer* next = nullptr;
+
+        void record(uint64_t ns);
+    };
+
+    class ScopedTimer
+    {
+    public:
+        explicit ScopedTimer(Timer& timer) :
+            m_timer(timer),
+            m_start(std::chrono::steady_clock::now())
+        {}
+
+        ~ScopedTimer()
+        {
+            const auto elapsed = std::chrono::steady_clock::now() - m_start;
+            m_timer.record(static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count()));
+        }
+
+        ScopedTimer(const ScopedTimer&) = delete;
+        ScopedTimer& operator = (const ScopedTimer&) = delete;
+
+    private:
+        Timer& m_timer;
+        std::chrono::steady_clock::time_point m_start;
+    };
+
+    void Add(Counter counter, uint64_t value);
+    void Record(Histogram hist, uint64_t value);
+
+    uint64_t Get(Counter counter);
+
+    /* Resets all counters, histograms and timers to 0 */
+    void Reset();
+
+    /* Returns all counters, non empty histogram buckets and timers as JSON object */
+    std::string ToJson();
+
+}} // namespace libim::stats
+
+#define LIBIM_STATS_CONCAT_(a, b) a##b
+#define LIBIM_STATS_CONCAT(a, b) LIBIM_STATS_CONCAT_(a, b)
+
+#define LIBIM_STATS_ADD(counter, value) \
+    ::libim::stats::Add(::libim::stats::Counter::counter, static_cast<uint64_t>(value))
+
+#define LIBIM_STATS_RECORD(hist, value) \
+    ::libim::stats::Record(::libim::stats::Histogram::hist, static_cast<uint64_t>(value))
+
+/* Times the rest of enclosing scope under name */
+#define LIBIM_STATS_SCOPED_TIMER(name)                                                \
+    static ::libim::stats::Timer LIBIM_STATS_CONCAT(libimStatsTimer_, __LINE__)(name); \
+    ::libim::stats::ScopedTimer LIBIM_STATS_CONCAT(libimStatsScope_, __LINE__)(LIBIM_STATS_CONCAT(libimStatsTimer_, __LINE__))
+
+#else // !LIBIM_ENABLE_STATS
+
+#define LIBIM_STATS_ADD(counter, value)  ((void)0)
+#define LIBIM_STATS_RECORD(hist, value)  ((void)0)
+#define LIBIM_STATS_SCOPED_TIMER(name)   ((void)0)
+
+#endif // LIBIM_ENABLE_STATS
+#endif // LIBIM_STATS_H
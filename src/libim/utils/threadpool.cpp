@@ -0,0 +1,151 @@
+#include "threadpool.h"
+
+using namespace libim;
+
+namespace {
+    /* Pool and queue index of the current worker thread */
+    thread_local const ThreadPool* t_pool = nullptr;
+    thread_local std::size_t t_queueIdx   = 0;
+}
+
+ThreadPool::ThreadPool(std::size_t numThreads)
+{
+    if(numThreads == 0) {
+        numThreads = hardwareConcurrency();
+    }
+
+    m_queues.reserve(numThreads);
+    for(std::size_t i = 0; i < numThreads; i++) {
+        m_queues.emplace_back(new TaskQueue);
+    }
+
+    m_workers.reserve(numThreads);
+    for(std::size_t i = 0; i < numThreads; i++) {
+        m_workers.emplace_back(&ThreadPool::run, this, i);
+    }
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_bStop = true;
+    }
+
+    m_cvTask.notify_all();
+    for(auto& worker : m_workers) {
+        worker.join();
+    }
+}
+
+void ThreadPool::submit(Task task)
+{
+    const std::size_t idx = t_pool == this ? t_queueIdx : m_nextQueue++ % m_queues.size();
+    m_nPending++;
+    {
+        auto& queue = *m_queues[idx];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        queue.tasks.emplace_back(std::move(task));
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_nQueued++;
+    }
+
+    m_cvTask.notify_one();
+}
+
+void ThreadPool::wait()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_cvDone.wait(lock, [&]{ return m_nPending == 0; });
+
+    if(m_error)
+    {
+        auto error = m_error;
+        m_error = nullptr;
+        std::rethrow_exception(error);
+    }
+}
+
+std::size_t ThreadPool::size() const
+{
+    return m_workers.size();
+}
+
+std::size_t ThreadPool::hardwareConcurrency()
+{
+    const auto n = std::thread::hardware_concurrency();
+    return n > 0 ? n : 1;
+}
+
+bool ThreadPool::pop(std::size_t idx, Task& task)
+{
+    auto& queue = *m_queues[idx];
+    std::lock_guard<std::mutex> lock(queue.mutex);
+    if(queue.tasks.empty()) {
+        return false;
+    }
+
+    /* Own queue is used as stack, the most recently submitted task is likely still hot in cache */
+    task = std::move(queue.tasks.back());
+    queue.tasks.pop_back();
+    return true;
+}
+
+bool ThreadPool::steal(std::size_t idx, Task& task)
+{
+    for(std::size_t i = 1; i < m_queues.size(); i++)
+    {
+        auto& queue = *m_queues[(idx + i) % m_queues.size()];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        if(!queue.tasks.empty())
+        {
+            task = std::move(queue.tasks.front());
+            queue.tasks.pop_front();
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void ThreadPool::run(std::size_t idx)
+{
+    t_pool     = this;
+    t_queueIdx = idx;
+
+    while(true)
+    {
+        Task task;
+        if(!pop(idx, task) && !steal(idx, task))
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_cvTask.wait(lock, [&]{ return m_bStop || m_nQueued > 0; });
+            if(m_bStop && m_nQueued <= 0) {
+                return; // stopped and no more work
+            }
+            continue;
+        }
+
+        m_nQueued--;
+        try {
+            task();
+        }
+        catch(...)
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if(!m_error) {
+                m_error = std::current_exception();
+            }
+        }
+
+        task = nullptr; // release captured state before task is reported as done
+        if(--m_nPending == 0)
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_cvDone.notify_all();
+        }
+    }
+}
@@ -0,0 +1,67 @@
+#ifndef LIBIM_THREADPOOL_H
+#define LIBIM_THREADPOOL_H
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace libim {
+
+/* Fixed size work-stealing pool of worker threads executing submitted tasks.
+   Each worker has its own task queue. Tasks submitted from outside the pool are distributed
+   round-robin, tasks submitted from a worker go to its own queue. Idle workers steal tasks
+   from the front of other workers' queues.
+   If a task throws, the first exception is rethrown from wait(). */
+class ThreadPool
+{
+public:
+    using Task = std::function<void()>;
+
+    /* Creates pool with numThreads workers. If numThreads is 0 the number of hardware threads is used. */
+    explicit ThreadPool(std::size_t numThreads = 0);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator = (const ThreadPool&) = delete;
+
+    void submit(Task task);
+
+    /* Blocks until all submitted tasks have finished */
+    void wait();
+
+    std::size_t size() const;
+
+    static std::size_t hardwareConcurrency();
+
+private:
+    struct TaskQueue
+    {
+        std::deque<Task> tasks;
+        std::mutex mutex;
+    };
+
+    void run(std::size_t idx);
+    bool pop(std::size_t idx, Task& task);
+    bool steal(std::size_t idx, Task& task);
+
+private:
+    std::vector<std::thread> m_workers;
+    std::vector<std::unique_ptr<TaskQueue>> m_queues;
+    std::atomic<std::size_t> m_nextQueue { 0 };
+    std::atomic<long> m_nQueued { 0 };          // tasks waiting in queues
+    std::atomic<std::size_t> m_nPending { 0 };  // queued and running tasks
+    std::mutex m_mutex;
+    std::condition_variable m_cvTask;
+    std::condition_variable m_cvDone;
+    bool m_bStop = false;
+    std::exception_ptr m_error;
+};
+
+}
+#endif // LIBIM_THREADPOOL_H
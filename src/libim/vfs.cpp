@@ -0,0 +1,330 @@
+#include "vfs.h"
+#include "common.h"
+#include "io/filestream.h"
+#include "io/substream.h"
+
+#include <algorithm>
+#include <atomic>
+#include <unordered_map>
+#include <utility>
+
+#ifndef OS_WINDOWS
+#  include <dirent.h>
+#  include <sys/stat.h>
+#endif
+
+namespace {
+    struct DirFile
+    {
+        std::string path; // relative to mounted directory with '/' as separator
+        std::size_t size;
+    };
+
+    /* Appends all files in root/relDir and its subdirectories to files */
+    void ScanDirectory(const std::string& root, const std::string& relDir, std::vector<DirFile>& files)
+    {
+        const std::string dir = relDir.empty() ? root : root + "/" + relDir;
+#ifdef OS_WINDOWS
+        WIN32_FIND_DATAA fd;
+        HANDLE hFind = FindFirstFileA((dir + "/*").c_str(), &fd);
+        if(hFind == INVALID_HANDLE_VALUE) {
+            throw FileStreamError("Failed to read directory '" + dir + "': " + GetLastErrorAsString());
+        }
+
+        do
+        {
+            const std::string name = fd.cFileName;
+            if(name == "." || name == "..") {
+                continue;
+            }
+
+            const auto relPath = relDir.empty() ? name : relDir + "/" + name;
+            if(fd.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) {
+                ScanDirectory(root, relPath, files);
+            }
+            else {
+                files.push_back({ relPath, (std::size_t(fd.nFileSizeHigh) << 32) | fd.nFileSizeLow });
+            }
+        }
+        while(FindNextFileA(hFind, &fd));
+        FindClose(hFind);
+#else
+        DIR* d = opendir(dir.c_str());
+        if(!d) {
+            throw FileStreamError("Failed to read directory '" + dir + "': " + GetLastErrorAsString());
+        }
+
+        std::vector<std::string> subdirs;
+        while(dirent* de = readdir(d))
+        {
+            const std::string name = de->d_name;
+            if(name == "." || name == "..") {
+                continue;
+            }
+
+            const auto relPath = relDir.empty() ? name : relDir + "/" + name;
+            struct stat st;
+            if(stat((root + "/" + relPath).c_str(), &st) != 0) {
+                continue; // e.g. dangling symlink
+            }
+
+            if(S_ISDIR(st.st_mode)) {
+                subdirs.push_back(relPath);
+            }
+            else if(S_ISREG(st.st_mode)) {
+                files.push_back({ relPath, std::size_t(st.st_size) });
+            }
+        }
+        closedir(d);
+
+        for(const auto& subdir : subdirs) {
+            ScanDirectory(root, subdir, files);
+        }
+#endif
+    }
+}
+
+
+struct VirtualFileSystem::Mount
+{
+    std::string source;
+    int priority  = 0;
+    uint64_t seq  = 0; // mount order
+    std::shared_ptr<const GobArchive> gob;
+    std::shared_ptr<const GobFileDirectory> gobDir;
+    std::vector<DirFile> files; // files of mounted directory
+
+    std::size_t count() const
+    {
+        return gob ? gob->entries().size() : gobDir ? gobDir->entries.size() : files.size();
+    }
+
+    std::string name(std::size_t idx) const
+    {
+        return gob ? GetGobEntryName(gob->entries()[idx]) : gobDir ? GetGobEntryName(gobDir->entries[idx]) : files[idx].path;
+    }
+
+    std::size_t size(std::size_t idx) const
+    {
+        return gob ? gob->entries()[idx].size : gobDir ? gobDir->entries[idx].size : files[idx].size;
+    }
+
+    StreamPtr<InputStream> open(std::size_t idx) const
+    {
+        if(gob) {
+            return gob->openEntry(gob->entries()[idx]);
+        }
+        else if(gobDir)
+        {
+            const auto& entry = gobDir->entries[idx];
+            auto stream = MakeStreamPtr<SubStream>(gobDir->stream, entry.offset, entry.size);
+            stream->setName(GetFileName(GetGobEntryName(entry)));
+            return stream;
+        }
+
+        return MakeStreamPtr<InputFileStream>(source + "/" + files[idx].path);
+    }
+};
+
+struct VirtualFileSystem::Index
+{
+    struct Entry
+    {
+        std::string name;   // normalized name
+        const Mount* mount;
+        std::size_t idx;    // file index in mount
+    };
+
+    std::vector<std::shared_ptr<const Mount>> mounts; // keeps mounts alive while index is in use
+    std::vector<Entry> entries;                       // sorted by name
+    std::unordered_map<std::string, std::size_t> map; // normalized name -> entry index
+
+    const Entry* find(const std::string& name) const
+    {
+        auto it = map.find(NormalizeGobEntryName(name));
+        return it != map.end() ? &entries[it->second] : nullptr;
+    }
+};
+
+
+VirtualFileSystem::VirtualFileSystem() :
+    m_index(std::make_shared<Index>())
+{}
+
+VirtualFileSystem::~VirtualFileSystem()
+{}
+
+std::shared_ptr<const VirtualFileSystem::Index> VirtualFileSystem::index() const
+{
+    return std::atomic_load(&m_index);
+}
+
+void VirtualFileSystem::mountGob(const std::string& gobFile, int priority)
+{
+    mount(std::make_shared<GobArchive>(gobFile), gobFile, priority);
+}
+
+void VirtualFileSystem::mount(std::shared_ptr<const GobArchive> gob, const std::string& source, int priority)
+{
+    if(!gob) {
+        throw StreamError("VirtualFileSystem: GOB archive is null!");
+    }
+
+    auto m = std::make_shared<Mount>();
+    m->source   = source;
+    m->priority = priority;
+    m->gob      = std::move(gob);
+    addMount(std::move(m));
+}
+
+void VirtualFileSystem::mount(std::shared_ptr<const GobFileDirectory> dir, const std::string& source, int priority)
+{
+    if(!dir || !dir->stream) {
+        throw StreamError("VirtualFileSystem: GOB directory is null!");
+    }
+
+    for(const auto& entry : dir->entries)
+    {
+        if(std::size_t(entry.offset) + entry.size > dir->stream->size()) {
+            throw StreamError("Error GOB entry '" + GetGobEntryName(entry) + "' is out of file bounds!");
+        }
+    }
+
+    auto m = std::make_shared<Mount>();
+    m->source   = source;
+    m->priority = priority;
+    m->gobDir   = std::move(dir);
+    addMount(std::move(m));
+}
+
+void VirtualFileSystem::mountDirectory(const std::string& dir, int priority)
+{
+    auto m = std::make_shared<Mount>();
+    m->source   = dir;
+    m->priority = priority;
+    ScanDirectory(dir, "", m->files);
+    addMount(std::move(m));
+}
+
+void VirtualFileSystem::addMount(std::shared_ptr<Mount> mount)
+{
+    std::lock_guard<std::mutex> lock(m_mountMutex);
+    mount->seq = m_nextSeq++;
+    m_mounts.push_back(std::move(mount));
+    rebuildIndex();
+}
+
+bool VirtualFileSystem::unmount(const std::string& source)
+{
+    std::lock_guard<std::mutex> lock(m_mountMutex);
+    auto it = std::remove_if(m_mounts.begin(), m_mounts.end(), [&](const std::shared_ptr<const Mount>& m) {
+        return m->source == source;
+    });
+
+    if(it == m_mounts.end()) {
+        return false;
+    }
+
+    m_mounts.erase(it, m_mounts.end());
+    rebuildIndex();
+    return true;
+}
+
+void VirtualFileSystem::rebuildIndex()
+{
+    /* Merge files of mounts in resolution order, first file with the same name wins */
+    auto index    = std::make_shared<Index>();
+    index->mounts = m_mounts;
+    std::sort(index->mounts.begin(), index->mounts.end(), [](const std::shared_ptr<const Mount>& a, const std::shared_ptr<const Mount>& b) {
+        return a->priority != b->priority ? a->priority > b->priority : a->seq > b->seq;
+    });
+
+    std::size_t nFiles = 0;
+    for(const auto& m : index->mounts) {
+        nFiles += m->count();
+    }
+
+    index->entries.reserve(nFiles);
+    index->map.reserve(nFiles);
+    for(const auto& m : index->mounts)
+    {
+        for(std::size_t i = 0; i < m->count(); i++)
+        {
+            auto name = NormalizeGobEntryName(m->name(i));
+            if(index->map.emplace(name, 0).second) {
+                index->entries.push_back({ std::move(name), m.get(), i });
+            }
+        }
+    }
+
+    std::sort(index->entries.begin(), index->entries.end(), [](const Index::Entry& a, const Index::Entry& b) {
+        return a.name < b.name;
+    });
+
+    for(std::size_t i = 0; i < index->entries.size(); i++) {
+        index->map[index->entries[i].name] = i;
+    }
+
+    /* Readers holding the previous index keep using it until they're done */
+    std::atomic_store(&m_index, std::shared_ptr<const Index>(std::move(index)));
+}
+
+std::size_t VirtualFileSystem::size() const
+{
+    return index()->entries.size();
+}
+
+bool VirtualFileSystem::exists(const std::string& name) const
+{
+    return index()->find(name) != nullptr;
+}
+
+bool VirtualFileSystem::stat(const std::string& name, FileInfo& info) const
+{
+    const auto idx = index();
+    auto entry = idx->find(name);
+    if(!entry) {
+        return false;
+    }
+
+    info.name   = entry->mount->name(entry->idx);
+    info.size   = entry->mount->size(entry->idx);
+    info.source = entry->mount->source;
+    return true;
+}
+
+StreamPtr<InputStream> VirtualFileSystem::open(const std::string& name) const
+{
+    const auto idx = index();
+    auto entry = idx->find(name);
+    if(!entry) {
+        return nullptr;
+    }
+
+    /* Stream of GOB entry holds the archive, so it stays valid after unmount */
+    return entry->mount->open(entry->idx);
+}
+
+std::vector<VirtualFileSystem::FileInfo> VirtualFileSystem::list(const std::string& dir, bool recursive) const
+{
+    auto ndir = NormalizeGobEntryName(dir);
+    if(!ndir.empty() && ndir.back() != '/') {
+        ndir.push_back('/');
+    }
+
+    const auto idx = index();
+    auto it = std::lower_bound(idx->entries.begin(), idx->entries.end(), ndir, [](const Index::Entry& e, const std::string& p) {
+        return e.name < p;
+    });
+
+    std::vector<FileInfo> result;
+    for(; it != idx->entries.end() && it->name.compare(0, ndir.size(), ndir) == 0; ++it)
+    {
+        if(!recursive && it->name.find('/', ndir.size()) != std::string::npos) {
+            continue;
+        }
+        result.push_back({ it->mount->name(it->idx), it->mount->size(it->idx), it->mount->source });
+    }
+
+    return result;
+}
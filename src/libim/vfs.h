@@ -0,0 +1,80 @@
+#ifndef LIBIM_VFS_H
+#define LIBIM_VFS_H
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "gob.h"
+#include "io/stream.h"
+
+/* Virtual file system layering GOB archives and directories, e.g. game GOB files and loose
+   files in the Resource folder. When several mounts contain a file with the same name the file
+   from the mount with the highest priority is used, on equal priority the last mounted wins.
+   File names are resolved the same way as in GobArchive: case insensitive, both '/' and '\\'
+   can be used as path separator.
+   Mounting builds one merged index of all mounts which replaces the previous index atomically, so lookups
+   never scan mounts and don't take a lock. All methods can be called concurrently. Streams returned by open
+   are independent read handles which can be used from different threads at the same time. */
+class VirtualFileSystem
+{
+public:
+    struct FileInfo
+    {
+        std::string name;   // file name as stored in archive or path relative to mounted directory
+        std::size_t size;
+        std::string source; // path of GOB file or directory the file is in
+    };
+
+    VirtualFileSystem();
+    ~VirtualFileSystem();
+
+    VirtualFileSystem(const VirtualFileSystem&) = delete;
+    VirtualFileSystem& operator = (const VirtualFileSystem&) = delete;
+
+    /* Mounts GOB file. Throws StreamError if file is not a valid GOB file. */
+    void mountGob(const std::string& gobFile, int priority = 0);
+    void mount(std::shared_ptr<const GobArchive> gob, const std::string& source, int priority = 0);
+
+    /* Mounts GOB directory e.g. loaded with LoadGobFromFile. Reading its files from several threads is
+       safe if readAt of directory stream is thread-safe (see Stream), which is the case for LoadGobFromFile. */
+    void mount(std::shared_ptr<const GobFileDirectory> dir, const std::string& source, int priority = 0);
+
+    /* Mounts all files in dir and its subdirectories. Files added to dir later are not visible until dir is mounted again.
+       Throws FileStreamError if dir can't be read. */
+    void mountDirectory(const std::string& dir, int priority = 0);
+
+    /* Unmounts all mounts of source. Returns false if source is not mounted. */
+    bool unmount(const std::string& source);
+
+    /* Returns number of files in merged index */
+    std::size_t size() const;
+
+    bool exists(const std::string& name) const;
+    bool stat(const std::string& name, FileInfo& info) const;
+
+    /* Returns read-only stream of file or nullptr if file was not found.
+       Throws StreamError if file exists in index but can't be opened. */
+    StreamPtr<InputStream> open(const std::string& name) const;
+
+    /* Returns files in directory dir e.g.: "mat", sorted by name. If recursive is false only direct children are returned. */
+    std::vector<FileInfo> list(const std::string& dir = "", bool recursive = false) const;
+
+private:
+    struct Mount;
+    struct Index;
+
+    void addMount(std::shared_ptr<Mount> mount);
+    void rebuildIndex(); // must be called with m_mountMutex locked
+    std::shared_ptr<const Index> index() const;
+
+private:
+    std::mutex m_mountMutex;                      // serializes mount and unmount
+    std::vector<std::shared_ptr<const Mount>> m_mounts;
+    uint64_t m_nextSeq = 0;
+    std::shared_ptr<const Index> m_index;         // accessed with std::atomic_load/atomic_store
+};
+
+#endif // LIBIM_VFS_H
@@ -0,0 +1,89 @@
+#include <cstdint>
+#include <cstdio>
+#include <exception>
+#include <limits>
+#include <string>
+#include <vector>
+
+#include "libim/io/filestream.h"
+#include "libim/material/bmpreader.h"
+#include "libim/material/colorformat.h"
+#include "testutils.h"
+
+namespace {
+
+    void Put16(std::vector<char>& b, uint16_t v)
+    {
+        b.push_back(char(v & 0xFF));
+        b.push_back(char(v >> 8));
+    }
+
+    void Put32(std::vector<char>& b, uint32_t v)
+    {
+        Put16(b, uint16_t(v & 0xFFFF));
+        Put16(b, uint16_t(v >> 16));
+    }
+
+    /* Returns BMP with BITMAPINFOHEADER and BI_RGB pixels, pixelDataSize bytes of zero pixel data follow headers */
+    std::vector<char> MakeBmp(int32_t width, int32_t height, uint16_t bitCount, std::size_t pixelDataSize)
+    {
+        constexpr uint32_t kHeadersSize = 14 + 40;
+        std::vector<char> b;
+        Put16(b, BMP_TYPE);
+        Put32(b, uint32_t(kHeadersSize + pixelDataSize));
+        Put32(b, 0);
+        Put32(b, kHeadersSize);
+
+        Put32(b, 40);
+        Put32(b, uint32_t(width));
+        Put32(b, uint32_t(height));
+        Put16(b, 1);
+        Put16(b, bitCount);
+        Put32(b, BI_RGB);
+        for(int i = 0; i < 5; i++) {
+            Put32(b, 0);
+        }
+
+        b.resize(b.size() + pixelDataSize, 0);
+        return b;
+    }
+
+    /* Writes bmp to file and reads it with ReadBmpTexture in format, returns true if BMP was read */
+    bool ReadBmp(const std::vector<char>& bmp, const ColorFormat& format)
+    {
+        const std::string path = "test_bmpreader.bmp";
+        WriteTestFile(path, bmp);
+
+        bool bRead = false;
+        try
+        {
+            InputFileStream ifs(path);
+            auto tex = ReadBmpTexture(ifs, format);
+            bRead = tex.bitmap() != nullptr;
+        }
+        catch(const StreamError&) {}
+
+        std::remove(path.c_str());
+        return bRead;
+    }
+}
+
+int main()
+{
+    for(const ColorFormat* format : { &RGB_565, &RGBA_8888 })
+    {
+        Expect(ReadBmp(MakeBmp(4, 2, 32, 4 * 4 * 2), *format), "valid 4x2 32 bit BMP is read");
+        Expect(ReadBmp(MakeBmp(4, -2, 24, 12 * 2), *format), "valid top-down 4x2 24 bit BMP is read");
+
+        /* Row size wraps to 0 in 32 bits */
+        Expect(!ReadBmp(MakeBmp(1 << 30, 1, 32, 16), *format), "BMP with width 1<<30 is rejected");
+        Expect(!ReadBmp(MakeBmp(1 << 29, 1, 32, 16), *format), "BMP with width 1<<29 is rejected");
+        Expect(!ReadBmp(MakeBmp(1, std::numeric_limits<int32_t>::min(), 32, 16), *format), "BMP with height INT32_MIN is rejected");
+        Expect(!ReadBmp(MakeBmp(1, (1 << 16) + 1, 32, 16), *format), "BMP higher than 1<<16 is rejected");
+        Expect(!ReadBmp(MakeBmp(1 << 16, 1 << 16, 32, 16), *format), "BMP whose pixel data doesn't fit 32 bits is rejected");
+        Expect(!ReadBmp(MakeBmp(64, 64, 32, 16), *format), "BMP with truncated pixel data is rejected");
+        Expect(!ReadBmp(MakeBmp(0, 1, 32, 16), *format), "BMP with width 0 is rejected");
+    }
+
+    return TestResult();
+}
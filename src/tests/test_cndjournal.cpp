@@ -0,0 +1,211 @@
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "libim/cnd.h"
+#include "libim/io/filestream.h"
+#include "libim/utils/hash.h"
+#include "testutils.h"
+
+using namespace libim::CND;
+
+namespace {
+
+    const std::string kCndFile     = "test_cndjournal.cnd";
+    constexpr uint32_t kMatDim     = 16;
+    constexpr uint32_t kJournalMagic = 0x314A4D49; // "IMJ1", see WritePatchJournal
+
+    std::string MaterialName(std::size_t idx)
+    {
+        return "mat_" + std::to_string(idx) + ".mat";
+    }
+
+    /* Writes CND file with numMaterials RGB_565 materials of kMatDim x kMatDim with 4 textures per mipmap */
+    void MakeCnd(std::size_t numMaterials)
+    {
+        std::remove(kCndFile.c_str());
+        OutputFileStream ofs(kCndFile);
+        ofs.setSyncOnClose(false);
+
+        CndHeader header {};
+        header.copyright    = GetCopyrightNotice();
+        header.version      = GetFileVersion();
+        header.numMaterials = static_cast<uint32_t>(numMaterials);
+        ofs.write(reinterpret_cast<const byte_t*>(&header), sizeof(header));
+        ofs.write(uint32_t(0)); // unknown 4 bytes before material section
+
+        std::vector<CndMatHeader> matHeaders(numMaterials);
+        uint32_t nPixelDataSize = 0;
+        for(std::size_t i = 0; i < numMaterials; i++)
+        {
+            auto& mh = matHeaders[i];
+            std::snprintf(mh.name, sizeof(mh.name), "%s", MaterialName(i).c_str());
+            mh.width  = kMatDim;
+            mh.height = kMatDim;
+            mh.mipmapCount       = 1;
+            mh.texturesPerMipmap = 4;
+            mh.colorInfo = RGB_565;
+            nPixelDataSize += GetMaterialPixelDataSize(mh);
+        }
+
+        ofs.write(nPixelDataSize);
+        ofs.write(reinterpret_cast<const byte_t*>(matHeaders.data()), matHeaders.size() * sizeof(CndMatHeader));
+
+        ByteArray pixelData(nPixelDataSize);
+        for(std::size_t i = 0; i < pixelData.size(); i++) {
+            pixelData[i] = byte_t(i * 7 + 3);
+        }
+        ofs.write(pixelData.data(), pixelData.size());
+
+        ByteArray rest(4096, 0x5A); // rest of the level data
+        ofs.write(rest.data(), rest.size());
+
+        const std::size_t fileSize = ofs.tell();
+        ofs.seekBegin();
+        ofs.write(static_cast<uint32_t>(fileSize));
+    }
+
+    /* Returns material of the same size and format as CND materials, filled with value */
+    Material MakeMaterial(const std::string& name, byte_t value)
+    {
+        Material mat(name);
+        mat.setSize(kMatDim, kMatDim);
+        mat.setColorFormat(RGB_565);
+
+        Mipmap mipmap;
+        for(uint32_t texIdx = 0; texIdx < 4; texIdx++)
+        {
+            const uint32_t texDim = kMatDim >> texIdx;
+            auto bitmap = MakeBitmapPtr(GetBitmapSize(texDim, texDim, RGB_565.bpp));
+            std::fill(bitmap->begin(), bitmap->end(), value);
+
+            Texture tex;
+            tex.setWidth(texDim)
+               .setHeight(texDim)
+               .setColorInfo(RGB_565)
+               .setRowSize(GetRowSize(texDim, RGB_565.bpp))
+               .setBitmap(std::move(bitmap));
+            mipmap.push_back(std::move(tex));
+        }
+        mat.addMipmap(std::move(mipmap));
+        return mat;
+    }
+
+    template<typename T>
+    void Append(std::vector<char>& data, const T& value)
+    {
+        const auto* p = reinterpret_cast<const char*>(&value);
+        data.insert(data.end(), p, p + sizeof(value));
+    }
+
+    /* Returns undo journal which restores ranges of original data which differ from patched data */
+    std::vector<char> MakeJournal(const std::vector<char>& original, const std::vector<char>& patched)
+    {
+        std::vector<std::pair<std::size_t, std::size_t>> ranges;
+        for(std::size_t i = 0; i < original.size(); i++)
+        {
+            if(original[i] == patched[i]) {
+                continue;
+            }
+
+            std::size_t end = i;
+            while(end < original.size() && original[end] != patched[end]) {
+                end++;
+            }
+            ranges.emplace_back(i, end - i);
+            i = end;
+        }
+
+        std::vector<char> journal;
+        Append(journal, kJournalMagic);
+        Append(journal, uint64_t(original.size()));
+        Append(journal, uint32_t(ranges.size()));
+        for(const auto& range : ranges)
+        {
+            Append(journal, uint64_t(range.first));
+            Append(journal, uint64_t(range.second));
+            journal.insert(journal.end(), original.begin() + std::ptrdiff_t(range.first), original.begin() + std::ptrdiff_t(range.first + range.second));
+        }
+        Append(journal, libim::XXH64(journal.data(), journal.size()));
+        return journal;
+    }
+
+    /* Patches CND file in place, returns original and patched file data */
+    void PatchCnd(std::vector<char>& original, std::vector<char>& patched)
+    {
+        MakeCnd(4);
+        original = ReadTestFile(kCndFile);
+        Expect(ReplaceMaterials({ MakeMaterial(MaterialName(1), 0xAB), MakeMaterial(MaterialName(3), 0xCD) }, kCndFile, 0, CndPatchMode::InPlace),
+               "in-place patch succeeds");
+        patched = ReadTestFile(kCndFile);
+    }
+
+    /* Leaves patched CND file with journal as after crash, returns true if file was rolled back */
+    bool RecoverWithJournal(const std::vector<char>& patched, const std::vector<char>& journal)
+    {
+        WriteTestFile(kCndFile, patched);
+        WriteTestFile(GetPatchJournalPath(kCndFile), journal);
+        const bool bRestored = RecoverInPlacePatch(kCndFile);
+        Expect(!TestFileExists(GetPatchJournalPath(kCndFile)), "journal is removed by recovery");
+        return bRestored;
+    }
+}
+
+int main()
+{
+    std::vector<char> original, patched;
+    PatchCnd(original, patched);
+    Expect(original.size() == patched.size() && original != patched, "in-place patch keeps file size and changes data");
+    Expect(!TestFileExists(GetPatchJournalPath(kCndFile)), "completed in-place patch leaves no journal");
+    Expect(!RecoverInPlacePatch(kCndFile), "nothing to recover after completed patch");
+    {
+        InputFileStream ifs(kCndFile);
+        const auto mats = LoadMaterials(ifs);
+        Expect(mats.size() == 4 && (*mats.at(1).mipmaps().at(0).at(0).bitmap())[0] == 0xAB, "patched material is stored in file");
+    }
+
+    const auto journal = MakeJournal(original, patched);
+
+    /* Valid journal rolls back interrupted patch */
+    Expect(RecoverWithJournal(patched, journal), "valid journal is rolled back");
+    Expect(ReadTestFile(kCndFile) == original, "rolled back file equals original file");
+
+    /* Truncated journal was not completed before the file was modified, it's dropped */
+    auto truncated = journal;
+    truncated.resize(journal.size() - 5);
+    Expect(!RecoverWithJournal(patched, truncated), "truncated journal is dropped");
+    Expect(ReadTestFile(kCndFile) == patched, "truncated journal leaves file untouched");
+
+    Expect(!RecoverWithJournal(patched, std::vector<char>()), "empty journal is dropped");
+    Expect(ReadTestFile(kCndFile) == patched, "empty journal leaves file untouched");
+
+    /* Journal with bad checksum is dropped */
+    auto corrupted = journal;
+    corrupted[sizeof(uint32_t) + sizeof(uint64_t) + sizeof(uint32_t) + 2 * sizeof(uint64_t)] ^= 0x01; // first byte of range data
+    Expect(!RecoverWithJournal(patched, corrupted), "journal with bad checksum is dropped");
+    Expect(ReadTestFile(kCndFile) == patched, "journal with bad checksum leaves file untouched");
+
+    /* Journal of file with different size is stale */
+    auto grown = patched;
+    grown.resize(patched.size() + 16, 0);
+    Expect(!RecoverWithJournal(grown, journal), "stale journal of file with different size is dropped");
+    Expect(ReadTestFile(kCndFile) == grown, "stale journal leaves file untouched");
+
+    /* Interrupted patch is rolled back before the file is patched again */
+    WriteTestFile(kCndFile, patched);
+    WriteTestFile(GetPatchJournalPath(kCndFile), journal);
+    Expect(ReplaceMaterials({ MakeMaterial(MaterialName(2), 0xEF) }, kCndFile, 0, CndPatchMode::InPlace), "patch after interrupted patch succeeds");
+    Expect(!TestFileExists(GetPatchJournalPath(kCndFile)), "patch after interrupted patch leaves no journal");
+    {
+        InputFileStream ifs(kCndFile);
+        const auto mats = LoadMaterials(ifs);
+        Expect(mats.size() == 4 && (*mats.at(1).mipmaps().at(0).at(0).bitmap())[0] != 0xAB, "interrupted patch is rolled back");
+        Expect(mats.size() == 4 && (*mats.at(2).mipmaps().at(0).at(0).bitmap())[0] == 0xEF, "new patch is applied after roll back");
+    }
+
+    std::remove(kCndFile.c_str());
+    return TestResult();
+}
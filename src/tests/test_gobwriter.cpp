@@ -0,0 +1,81 @@
+#include <cstdio>
+#include <exception>
+#include <string>
+#include <vector>
+
+#include "libim/gob.h"
+#include "testutils.h"
+
+namespace {
+
+    const std::string kGobFile     = "test_gobwriter.gob";
+    const std::string kMissingFile = "test_gobwriter_missing.bin";
+
+    /* Writes GOB file with entries a.txt and b.txt */
+    void MakeGob()
+    {
+        const std::string a = "first entry";
+        const std::string b = "second entry";
+        GobWriter gob(kGobFile, GobWriter::Mode::Create, false);
+        gob.addEntry("a.txt", reinterpret_cast<const byte_t*>(a.data()), a.size());
+        gob.addEntry("b.txt", reinterpret_cast<const byte_t*>(b.data()), b.size());
+        gob.commit(false);
+    }
+
+    /* Adds missing file to writer, returns true if it failed */
+    bool AddMissingFile(GobWriter& gob)
+    {
+        try {
+            gob.addFile("missing.bin", kMissingFile);
+        }
+        catch(const std::exception&) {
+            return true;
+        }
+        return false;
+    }
+}
+
+int main()
+{
+    std::remove(kMissingFile.c_str());
+    MakeGob();
+    const auto original = ReadTestFile(kGobFile);
+    Expect(!original.empty(), "GOB file is created");
+    Expect(!TestFileExists(kGobFile + ".tmp"), "temporary file is renamed on commit");
+    Expect(GobWriter(kGobFile).entries().size() == 2, "created GOB file has 2 entries");
+    Expect(GobWriter(kGobFile).unusedSize() == 0, "created GOB file has no unused bytes");
+
+    /* Failed create keeps existing file */
+    {
+        GobWriter gob(kGobFile, GobWriter::Mode::Create, false);
+        Expect(AddMissingFile(gob), "adding missing file to new GOB file fails");
+    }
+    Expect(ReadTestFile(kGobFile) == original, "failed create leaves existing GOB file untouched");
+    Expect(!TestFileExists(kGobFile + ".tmp"), "failed create removes temporary file");
+
+    /* Failed update keeps committed directory */
+    {
+        const std::string c = "third entry";
+        GobWriter gob(kGobFile, GobWriter::Mode::Update, false);
+        gob.addEntry("c.txt", reinterpret_cast<const byte_t*>(c.data()), c.size());
+        gob.removeEntry("a.txt");
+        Expect(AddMissingFile(gob), "adding missing file to existing GOB file fails");
+    }
+    {
+        GobWriter gob(kGobFile);
+        Expect(gob.entries().size() == 2, "failed update keeps entries of GOB file");
+        Expect(gob.findEntry("a.txt") != nullptr && gob.findEntry("c.txt") == nullptr, "failed update keeps committed directory");
+    }
+
+    /* Committed update replaces directory */
+    {
+        const std::string c = "third entry";
+        GobWriter gob(kGobFile, GobWriter::Mode::Update, false);
+        gob.addEntry("c.txt", reinterpret_cast<const byte_t*>(c.data()), c.size());
+        gob.commit(false);
+    }
+    Expect(GobWriter(kGobFile).entries().size() == 3, "committed update adds entry");
+
+    std::remove(kGobFile.c_str());
+    return TestResult();
+}
@@ -0,0 +1,54 @@
+#ifndef LIBIM_TESTUTILS_H
+#define LIBIM_TESTUTILS_H
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+/* Minimal helpers shared by test executables. Each test counts failed checks and returns TestResult() from main. */
+
+inline int& FailedChecks()
+{
+    static int nFailed = 0;
+    return nFailed;
+}
+
+inline void Expect(bool cond, const char* what)
+{
+    if(!cond)
+    {
+        std::cerr << "FAILED: " << what << "\n";
+        FailedChecks()++;
+    }
+}
+
+inline int TestResult()
+{
+    if(FailedChecks() > 0)
+    {
+        std::cerr << FailedChecks() << " check(s) failed\n";
+        return 1;
+    }
+    return 0;
+}
+
+inline std::vector<char> ReadTestFile(const std::string& path)
+{
+    std::ifstream ifs(path, std::ios::binary);
+    return std::vector<char>(std::istreambuf_iterator<char>(ifs), std::istreambuf_iterator<char>());
+}
+
+inline void WriteTestFile(const std::string& path, const std::vector<char>& data)
+{
+    std::ofstream ofs(path, std::ios::binary | std::ios::trunc);
+    ofs.write(data.data(), std::streamsize(data.size()));
+}
+
+inline bool TestFileExists(const std::string& path)
+{
+    return std::ifstream(path).good();
+}
+
+#endif // LIBIM_TESTUTILS_H